@@ -13,6 +13,10 @@ public class HexArena : ModuleRules
 		PrivateDependencyModuleNames.AddRange(new string[] {  });
 
 		PublicDependencyModuleNames.AddRange(new string[] { "GameplayAbilities", "GameplayTags", "GameplayTasks" });
+
+		// Montages, dissolve, HUD updates, shells, impact and tracer effects, scope capture and crosshair traces
+		// are compiled out of the dedicated server target
+		PublicDefinitions.Add(Target.Type == TargetType.Server ? "WITH_COSMETICS=0" : "WITH_COSMETICS=1");
 		// Uncomment if you are using Slate UI
 		// PrivateDependencyModuleNames.AddRange(new string[] { "Slate", "SlateCore" });
 		
@@ -6,4 +6,10 @@
 
 #define ECC_SkeletalMesh ECollisionChannel::ECC_GameTraceChannel1
 #define ECC_HitBox ECollisionChannel::ECC_GameTraceChannel2
-#define ECC_PickupPhysics ECollisionChannel::ECC_GameTraceChannel2
\ No newline at end of file
+#define ECC_PickupPhysics ECollisionChannel::ECC_GameTraceChannel2
+
+DECLARE_STATS_GROUP(TEXT("HexArena Rewind"), STATGROUP_HARewind, STATCAT_Advanced);
+DECLARE_STATS_GROUP(TEXT("HexArena Pools"), STATGROUP_HAPools, STATCAT_Advanced);
+DECLARE_STATS_GROUP(TEXT("HexArena Bullets"), STATGROUP_HABullets, STATCAT_Advanced);
+DECLARE_STATS_GROUP(TEXT("HexArena FX"), STATGROUP_HAFX, STATCAT_Advanced);
+DECLARE_STATS_GROUP(TEXT("HexArena Net"), STATGROUP_HANet, STATCAT_Advanced);
@@ -118,7 +118,7 @@ void UHAAnimInstance::OnWeaponChanged(ABaseWeapon* Weapon)
 	}
 
 	EquippedWeapon = Weapon;
-	IKProperties = EquippedWeapon->WeaponData.IKProperties;
+	IKProperties = EquippedWeapon->GetWeaponData().IKProperties;
 	RightHandModifier = IKProperties.RightHandModifier;
 	LeftHandModifier = IKProperties.LeftHandModifier;
 	UE_LOG(LogTemp, Warning, TEXT("Weapon Changed!"));
@@ -28,8 +28,11 @@
 #include "Pickups/AmmoPickup.h"
 #include "Pickups/Interactable.h"
 #include "Pickups/LootBox.h"
+#include "Pickups/WeaponPickup.h"
 #include "PlayerStart/TeamPlayerStart.h"
 #include "Kismet/GameplayStatics.h"
+#include "Subsystems/HADataRegistry.h"
+#include "Subsystems/HARewindSubsystem.h"
 
 AHABaseCharacter::AHABaseCharacter(const FObjectInitializer& ObjInit)
 	:Super(ObjInit.SetDefaultSubobjectClass<UHAMovementComponent>(ACharacter::CharacterMovementComponentName))
@@ -164,6 +167,8 @@ AHABaseCharacter::AHABaseCharacter(const FObjectInitializer& ObjInit)
 	FootRBox->HitBoxType = EHitBoxType::EHBT_Limbs;
 	HitBoxes.Add(FName("FootRBox"), FootRBox);
 
+	// Head first, the rewind checks box 0 alone for headshot priority
+	HitBoxArray.Add(HeadBox);
 	for (auto Box : HitBoxes)
 	{
 		if (Box.Value)
@@ -174,15 +179,11 @@ AHABaseCharacter::AHABaseCharacter(const FObjectInitializer& ObjInit)
 			Box.Value->SetCollisionResponseToChannel(ECC_WorldDynamic, ECollisionResponse::ECR_Block);
 			Box.Value->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
 		}
+		if (Box.Value != HeadBox)
+		{
+			HitBoxArray.Add(Box.Value);
+		}
 	}
-
-	static ConstructorHelpers::FObjectFinder<UDataTable> TeamColorsObject(TEXT("DataTable'/Game/Blueprints/Character/Materials/DT_TeamColors.DT_TeamColors'"));
-	if (TeamColorsObject.Succeeded())
-	{
-		TeamColorsDT = TeamColorsObject.Object;
-	}
-
-	SetTeamColor(TeamName);
 }
 
 void AHABaseCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
@@ -191,6 +192,8 @@ void AHABaseCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& Out
 
 	DOREPLIFETIME_CONDITION(AHABaseCharacter, OverlappingPickup, COND_OwnerOnly);
 	DOREPLIFETIME(AHABaseCharacter, bDisableCombat);
+	// Only shooters rewind, the owner never targets itself
+	DOREPLIFETIME_CONDITION(AHABaseCharacter, RewindFrame, COND_SimulatedOnly);
 }
 
 void AHABaseCharacter::BeginPlay()
@@ -198,6 +201,12 @@ void AHABaseCharacter::BeginPlay()
 	Super::BeginPlay();
 
 	HAPlayerController = GetPlayerController();
+
+	// The team may have been set on possession already
+	if (TeamColorsId == INDEX_NONE)
+	{
+		SetTeamColor(TeamName);
+	}
 }
 
 void AHABaseCharacter::PostInitializeComponents()
@@ -442,8 +451,10 @@ void AHABaseCharacter::PlayFireMontage(bool bAiming)
 	}
 }
 
+// Compiled out of dedicated servers, hit boxes of a dead character take no more hits so rewind never needs its pose
 void AHABaseCharacter::PlayDeathMontage()
 {
+#if WITH_COSMETICS
 	UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance();
 	if (AnimInstance && DeathMontage)
 	{
@@ -451,6 +462,7 @@ void AHABaseCharacter::PlayDeathMontage()
 		FName SectionName("DeathHeadshot");
 		AnimInstance->Montage_JumpToSection(SectionName);
 	}
+#endif
 }
 
 
@@ -549,9 +561,10 @@ void AHABaseCharacter::ServerEquipButtonPressed_Implementation()
 
 void AHABaseCharacter::EquipWeaponHandle(AInteractable* Pickup)
 {
-	if (Inventory)
+	AWeaponPickup* OverlappingWeapon = Cast<AWeaponPickup>(Pickup);
+	if (Inventory && OverlappingWeapon)
 	{
-		Inventory->PickupWeapon(Cast<ABaseWeapon>(OverlappingPickup));
+		Inventory->PickupWeapon(OverlappingWeapon->GetWeapon());
 	}
 }
 
@@ -702,15 +715,17 @@ void AHABaseCharacter::Death(bool bPlayerLeftGame /*= false*/)
 void AHABaseCharacter::MulticastDeath_Implementation(bool bPlayerLeftGame /*= false*/)
 {
 	bLeftGame = bPlayerLeftGame;
+#if WITH_COSMETICS
 	if(HAPlayerController)
 	{
 		HAPlayerController->SetHUDWeaponAmmo(0);
 	}
+#endif
 	bDeath = true;
 	PlayDeathMontage();
 	//Start Dissolving effect if it is set
 	
-	SetDissolveMaterials(TeamName);
+	SetDissolveMaterials();
 	StartDissolve();
 
 	//Disable character movement
@@ -783,32 +798,52 @@ void AHABaseCharacter::ServerLeaveGame_Implementation()
 
 void AHABaseCharacter::SetTeamColor(FName Team)
 {
-	if(TeamColorsDT)
+	const UHADataRegistry* Registry = UHADataRegistry::Get(this);
+	TeamColorsId = Registry ? Registry->FindTeamColorsId(Team) : INDEX_NONE;
+
+	// Team materials are only cosmetic
+	if(TeamColorsId != INDEX_NONE && UHADataRegistry::WantsCosmetics(this))
 	{
-		TeamColors = *TeamColorsDT->FindRow<FTeamColorsData>(Team, "");
+		TeamColorsAssetsHandle = Registry->LoadTeamColorsAssets(TeamColorsId, this, FStreamableDelegate::CreateUObject(this, &AHABaseCharacter::OnTeamColorsAssetsLoaded));
+	}
+}
 
-		GetMesh()->SetMaterial(0, TeamColors.BodyMaterialInstance);
-		GetMesh()->SetMaterial(1, TeamColors.ArmMaterialInstance);
-		GetMesh()->SetMaterial(2, TeamColors.UpperarmMaterialInstance);
+void AHABaseCharacter::OnTeamColorsAssetsLoaded()
+{
+	const UHADataRegistry* Registry = UHADataRegistry::Get(this);
+	if (Registry == nullptr || !Registry->IsValidTeamColorsId(TeamColorsId)) return;
 
-		if (IsLocallyControlled() && ClientMesh)
-		{
-			ClientMesh->SetMaterial(0, TeamColors.BodyMaterialInstance);
-			ClientMesh->SetMaterial(1, TeamColors.ArmMaterialInstance);
-			ClientMesh->SetMaterial(2, TeamColors.UpperarmMaterialInstance);
-		}
+	const FTeamColorsData& TeamColors = Registry->GetTeamColors(TeamColorsId);
+
+	GetMesh()->SetMaterial(0, TeamColors.BodyMaterialInstance.Get());
+	GetMesh()->SetMaterial(1, TeamColors.ArmMaterialInstance.Get());
+	GetMesh()->SetMaterial(2, TeamColors.UpperarmMaterialInstance.Get());
+
+	if (IsLocallyControlled() && ClientMesh)
+	{
+		ClientMesh->SetMaterial(0, TeamColors.BodyMaterialInstance.Get());
+		ClientMesh->SetMaterial(1, TeamColors.ArmMaterialInstance.Get());
+		ClientMesh->SetMaterial(2, TeamColors.UpperarmMaterialInstance.Get());
 	}
 }
 
-void AHABaseCharacter::SetDissolveMaterials(FName Team)
+void AHABaseCharacter::SetDissolveMaterials()
 {
-	if (TeamColorsDT)
+#if WITH_COSMETICS
+	const UHADataRegistry* Registry = UHADataRegistry::Get(this);
+	if (Registry && Registry->IsValidTeamColorsId(TeamColorsId))
 	{
-		TeamColors = *TeamColorsDT->FindRow<FTeamColorsData>(Team, "");
+		const FTeamColorsData& TeamColors = Registry->GetTeamColors(TeamColorsId);
 
-		DynamicBodyDissolveMaterialInstance = UMaterialInstanceDynamic::Create(TeamColors.BodyDissolveMaterialInstance, this);
-		DynamicArmDissolveMaterialInstance = UMaterialInstanceDynamic::Create(TeamColors.ArmDissolveMaterialInstance, this);
-		DynamicUpperarmDissolveMaterialInstance = UMaterialInstanceDynamic::Create(TeamColors.UpperarmDissolveMaterialInstance, this);
+		// Streamed in with the team materials, never on dedicated servers
+		UMaterialInstance* BodyDissolveMaterial = TeamColors.BodyDissolveMaterialInstance.Get();
+		UMaterialInstance* ArmDissolveMaterial = TeamColors.ArmDissolveMaterialInstance.Get();
+		UMaterialInstance* UpperarmDissolveMaterial = TeamColors.UpperarmDissolveMaterialInstance.Get();
+		if (BodyDissolveMaterial == nullptr || ArmDissolveMaterial == nullptr || UpperarmDissolveMaterial == nullptr) return;
+
+		DynamicBodyDissolveMaterialInstance = UMaterialInstanceDynamic::Create(BodyDissolveMaterial, this);
+		DynamicArmDissolveMaterialInstance = UMaterialInstanceDynamic::Create(ArmDissolveMaterial, this);
+		DynamicUpperarmDissolveMaterialInstance = UMaterialInstanceDynamic::Create(UpperarmDissolveMaterial, this);
 
 		if (DynamicBodyDissolveMaterialInstance && DynamicArmDissolveMaterialInstance && DynamicUpperarmDissolveMaterialInstance)
 		{
@@ -833,6 +868,7 @@ void AHABaseCharacter::SetDissolveMaterials(FName Team)
 			DynamicUpperarmDissolveMaterialInstance->SetScalarParameterValue(TEXT("Glow"), 200.f);
 		}
 	}
+#endif
 }
 
 void AHABaseCharacter::UpdateDissolveMaterial(float DissolveValue)
@@ -854,12 +890,14 @@ void AHABaseCharacter::UpdateDissolveMaterial(float DissolveValue)
 
 void AHABaseCharacter::StartDissolve()
 {
+#if WITH_COSMETICS
 	DissolveTrack.BindDynamic(this, &AHABaseCharacter::UpdateDissolveMaterial);
 	if(DissolveCurve && DissolveTimeline)
 	{
 		DissolveTimeline->AddInterpFloat(DissolveCurve, DissolveTrack);
 		DissolveTimeline->Play();
 	}
+#endif
 }
 
 /*
@@ -926,6 +964,31 @@ void AHABaseCharacter::OnRep_OverlappingPickup(AInteractable* LastPickup)
 	}
 }
 
+void AHABaseCharacter::OnRep_RewindFrame(int32 LastRewindFrame)
+{
+	PreviousRewindFrame = LastRewindFrame;
+	RewindFrameReceivedTime = GetWorld()->GetTimeSeconds();
+}
+
+FRewindFrame AHABaseCharacter::GetRenderedRewindFrame() const
+{
+	FRewindFrame Rendered;
+	Rendered.Frame = RewindFrame;
+	if (RewindFrame == INDEX_NONE || PreviousRewindFrame == INDEX_NONE || PreviousRewindFrame >= RewindFrame) return Rendered;
+
+	// Simulated proxies smooth the mesh from the previous snapshot to the newest one, hit boxes follow the mesh
+	const UCharacterMovementComponent* Movement = GetCharacterMovement();
+	const float SmoothTime = Movement && Movement->NetworkSmoothingMode != ENetworkSmoothingMode::Disabled ? Movement->NetworkSimulatedSmoothLocationTime : 0.f;
+	const float SmoothAlpha = SmoothTime > 0.f ? FMath::Clamp((GetWorld()->GetTimeSeconds() - RewindFrameReceivedTime) / SmoothTime, 0.f, 1.f) : 1.f;
+
+	// Offset from the previous frame only, absolute frame numbers outgrow float precision on long running servers
+	const float FrameOffset = (RewindFrame - PreviousRewindFrame) * SmoothAlpha;
+	const int32 WholeFrames = FMath::FloorToInt(FrameOffset);
+	Rendered.Frame = PreviousRewindFrame + WholeFrames;
+	Rendered.Alpha = static_cast<uint8>(FMath::Clamp(FMath::RoundToInt((FrameOffset - WholeFrames) * 255.f), 0, 255));
+	return Rendered;
+}
+
 bool AHABaseCharacter::IsWeaponEquipped()
 {
 	return (Combat && Combat->EquippedWeapon);
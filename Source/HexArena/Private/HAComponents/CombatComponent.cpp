@@ -16,7 +16,83 @@
 #include "HAComponents/Inventory.h"
 #include "TimerManager.h"
 #include "HAComponents/HAMovementComponent.h"
+#include "Subsystems/HARewindSubsystem.h"
+#include "HAComponents/LagCompensationComponent.h"
+#include "Weapon/WeaponSpread.h"
+#include "Engine/NetConnection.h"
+#include "HexArena/HexArena.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Fire Events Sent"), STAT_HAFireEventsSent, STATGROUP_HANet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Fire Events Filtered"), STAT_HAFireEventsFiltered, STATGROUP_HANet);
+
+static TAutoConsoleVariable<int32> CVarMaxFireEventAge(
+	TEXT("HA.Net.MaxFireEventAge"),
+	30,
+	TEXT("Server frames a fire event may be behind the rendered shooter before simulated proxies skip it"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarMaxUnackedShots(
+	TEXT("HA.Net.MaxUnackedShots"),
+	16,
+	TEXT("Shots a client keeps resending until the server acknowledges them, older ones are given up as lost"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarFireStreamResendInterval(
+	TEXT("HA.Net.FireStreamResendInterval"),
+	0.05f,
+	TEXT("Seconds between resends of unacknowledged shots while no new shot is fired"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarFireFanOut(
+	TEXT("HA.Net.FireFanOut"),
+	1,
+	TEXT("Which clients get fire events of other players.\n0: every client the shooter replicates to, 1: clients close enough to see or hear the shot"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarFireEventHearDistance(
+	TEXT("HA.Net.FireEventHearDistance"),
+	3000.f,
+	TEXT("Clients this close to a shot get its fire event whichever way they look"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarFireEventSightDistance(
+	TEXT("HA.Net.FireEventSightDistance"),
+	8000.f,
+	TEXT("Clients this close to a shot get its fire event when the shooter is in front of them, further ones only get the firing state"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarFiringStateHold(
+	TEXT("HA.Net.FiringStateHold"),
+	0.5f,
+	TEXT("Seconds the replicated firing state stays set after the last shot, so it changes at most once per burst"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarAimSpreadRecoveryTime(
+	TEXT("HA.Net.AimSpreadRecoveryTime"),
+	0.5f,
+	TEXT("Seconds after the server stopped aiming a shooter that its shots may still claim aimed or recovering spread"),
+	ECVF_Default);
+
+// Hip spread taken off at full aim weight
+static constexpr float AimSpreadFactor = 2.f;
+
+namespace HAFireFanOut
+{
+	static bool IsRelevant(const APlayerController* Viewer, const FVector& Origin)
+	{
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		Viewer->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+		const FVector ToOrigin = Origin - ViewLocation;
+		const float DistanceSquared = ToOrigin.SizeSquared();
+		if (DistanceSquared <= FMath::Square(CVarFireEventHearDistance.GetValueOnGameThread())) return true;
+		if (DistanceSquared > FMath::Square(CVarFireEventSightDistance.GetValueOnGameThread())) return false;
 
+		// Past hearing range a shot is only worth its muzzle flash and tracer when it is on screen
+		return FVector::DotProduct(ViewRotation.Vector(), ToOrigin.GetSafeNormal()) > 0.5f;
+	}
+}
 
 UCombatComponent::UCombatComponent()
 {
@@ -53,15 +129,25 @@ void UCombatComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActo
 
 	if(Character && Character->IsLocallyControlled())
 	{
-		FHitResult HitResult;
-		TraceUnderCrosshairs(HitResult);
-		HitTarget = !HitResult.ImpactPoint.IsZero() ? HitResult.ImpactPoint : HitResult.TraceEnd;
 		if(!bAiming && EquippedWeapon)
 		{
 			CalculateHipSpread(DeltaTime);
 		}
+#if WITH_COSMETICS
+		// Needs a viewport and a HUD, dedicated servers have neither
+		FHitResult HitResult;
+		TraceUnderCrosshairs(HitResult);
+		HitTarget = !HitResult.ImpactPoint.IsZero() ? HitResult.ImpactPoint : HitResult.TraceEnd;
 		SetHUDCrosshairs();
 		InterpFOV(DeltaTime);
+#endif
+
+		// The last stream may have been lost, keep sending until the server acknowledges it
+		if (!Character->HasAuthority() && UnackedShots.Shots.Num() > 0 &&
+			GetWorld()->GetTimeSeconds() - LastFireStreamSendTime >= CVarFireStreamResendInterval.GetValueOnGameThread())
+		{
+			SendFireStream();
+		}
 	}
 	
 }
@@ -80,11 +166,11 @@ void UCombatComponent::SetHUDCrosshairs()
 			if(EquippedWeapon)
 			{
 				
-				HUDPackage.CrosshairsCenter = EquippedWeapon->WeaponData.CrosshairsCenter;
-				HUDPackage.CrosshairsLeft = EquippedWeapon->WeaponData.CrosshairsLeft;
-				HUDPackage.CrosshairsRight = EquippedWeapon->WeaponData.CrosshairsRight;
-				HUDPackage.CrosshairsTop = EquippedWeapon->WeaponData.CrosshairsTop;
-				HUDPackage.CrosshairsBottom = EquippedWeapon->WeaponData.CrosshairsBottom;
+				HUDPackage.CrosshairsCenter = EquippedWeapon->GetWeaponData().CrosshairsCenter.Get();
+				HUDPackage.CrosshairsLeft = EquippedWeapon->GetWeaponData().CrosshairsLeft.Get();
+				HUDPackage.CrosshairsRight = EquippedWeapon->GetWeaponData().CrosshairsRight.Get();
+				HUDPackage.CrosshairsTop = EquippedWeapon->GetWeaponData().CrosshairsTop.Get();
+				HUDPackage.CrosshairsBottom = EquippedWeapon->GetWeaponData().CrosshairsBottom.Get();
 			}		
 			else
 			{
@@ -123,17 +209,17 @@ void UCombatComponent::CalculateHipSpread(float DeltaTime)
 
 	if (bAiming)
 	{
-		CrosshairInAimFactor = FMath::FInterpTo(CrosshairInAimFactor, ADSWeight * 2.f, DeltaTime, 30.f);
+		CrosshairInAimFactor = FMath::FInterpTo(CrosshairInAimFactor, ADSWeight * AimSpreadFactor, DeltaTime, 30.f);
 	}
 	else
 	{
-		CrosshairInAimFactor = FMath::FInterpTo(CrosshairInAimFactor, ADSWeight * 2.f, DeltaTime, 30.f);
+		CrosshairInAimFactor = FMath::FInterpTo(CrosshairInAimFactor, ADSWeight * AimSpreadFactor, DeltaTime, 30.f);
 	}
 
 	CrosshairShootingFactor = FMath::FInterpTo(CrosshairShootingFactor, 0.f, DeltaTime, 30.f);
 
 	HipSpread = 
-		EquippedWeapon->WeaponData.HipScatter +
+		EquippedWeapon->GetWeaponData().HipScatter +
 		CrosshairVelocityFactor +
 		CrosshairInAirFactor -
 		CrosshairInAimFactor +
@@ -148,6 +234,8 @@ void UCombatComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& Out
 	//DOREPLIFETIME(UCombatComponent, ADSWeight);
 	DOREPLIFETIME(UCombatComponent, CombatState);
 	DOREPLIFETIME_CONDITION(UCombatComponent, CarriedAmmo, COND_OwnerOnly); // To inventory
+	DOREPLIFETIME_CONDITION(UCombatComponent, AckedShotSequence, COND_OwnerOnly);
+	DOREPLIFETIME_CONDITION(UCombatComponent, bFiring, COND_SkipOwner);
 }
 
 /*
@@ -157,6 +245,10 @@ void UCombatComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& Out
 void UCombatComponent::TimelineProgress(const float Value)
 {
 	ADSWeight = Value;
+	if (Value > 0.f)
+	{
+		LastAimedTime = GetWorld()->GetTimeSeconds();
+	}
 }
 
 void UCombatComponent::InterpFOV(float DeltaTime)
@@ -260,6 +352,8 @@ void UCombatComponent::FireButtonPressed(bool bPressed)
 
 	if(bFireButtonPressed)
 	{
+		TriggerSeed = static_cast<uint16>(FMath::Rand());
+		TriggerShotIndex = 0;
 		Fire();
 	}
 }
@@ -269,9 +363,25 @@ void UCombatComponent::Fire()
 	if(CanFire())
 	{
 		bCanFire = false;
-		HitTarget = !bAiming ? EquippedWeapon->TraceEndWithcSpread(HitTarget, HipSpread) : HitTarget;
-		ServerFire(HitTarget);
-		if(!Character->HasAuthority()) LocalFire(HitTarget);
+		FFireShot Shot;
+		Shot.AimTarget = HitTarget;
+		Shot.TriggerSeed = TriggerSeed;
+		Shot.ShotIndex = static_cast<uint8>(FMath::Min(TriggerShotIndex++, 255));
+		Shot.bAiming = bAiming;
+		Shot.Spread = FWeaponSpread::QuantizeSpread(bAiming ? 0.f : HipSpread);
+
+		const int32 ShotSequence = NextShotSequence++;
+		if (Character->HasAuthority())
+		{
+			AuthorityFire(ShotSequence, Shot);
+		}
+		else
+		{
+			EquippedWeapon->AddPendingShot(ShotSequence);
+			LocalFire(EquippedWeapon->GetShotTarget(Shot), Shot, ShotSequence);
+			QueueShot(ShotSequence, Shot);
+			SendFireStream();
+		}
 		if(EquippedWeapon)
 		{
 			CrosshairShootingFactor = 1.f;
@@ -288,7 +398,7 @@ void UCombatComponent::StartFireTimer()
 		FireTimer,
 		this,
 		&UCombatComponent::FireTimerFinished,
-		EquippedWeapon->FireDelay
+		EquippedWeapon->GetFireDelay()
 	);
 }
 
@@ -296,31 +406,162 @@ void UCombatComponent::FireTimerFinished()
 {
 	if (EquippedWeapon == nullptr) return;
 	bCanFire = true;
-	if (bFireButtonPressed && EquippedWeapon->WeaponData.bAutomatic)
+	if (bFireButtonPressed && EquippedWeapon->GetWeaponData().bAutomatic)
 	{
 		Fire();
 	}
 }
 
-void UCombatComponent::ServerFire_Implementation(const FVector_NetQuantize& TraceHitTarget)
+void UCombatComponent::QueueShot(int32 ShotSequence, const FFireShot& Shot)
 {
-	MulticastFire(TraceHitTarget);
+	UnackedShots.AddShot(ShotSequence, Shot, FMath::Max(CVarMaxUnackedShots.GetValueOnGameThread(), 1));
 }
 
-void UCombatComponent::MulticastFire_Implementation(const FVector_NetQuantize& TraceHitTarget)
+void UCombatComponent::SendFireStream()
 {
-	if(Character && Character->IsLocallyControlled() && !Character->HasAuthority()) return;
-	LocalFire(TraceHitTarget);
+	LastFireStreamSendTime = GetWorld()->GetTimeSeconds();
+	ServerFireStream(UnackedShots);
 }
 
-void UCombatComponent::LocalFire(const FVector_NetQuantize& TraceHitTarget)
+void UCombatComponent::OnRep_AckedShotSequence()
 {
-	if (EquippedWeapon == nullptr) return;
+	UnackedShots.Acknowledge(AckedShotSequence);
+}
+
+void UCombatComponent::ServerFireStream_Implementation(const FFireStream& FireStream)
+{
+	// After a long loss the stream starts past the last processed shot, the shots in between are given up as lost
+	if (!ServerShotQueue.Receive(FireStream, FMath::Max(CVarMaxUnackedShots.GetValueOnGameThread(), 1), AckedShotSequence)) return;
+
+	ReleaseServerShots();
+}
+
+void UCombatComponent::ReleaseServerShots()
+{
+	// Shots bunched up by the network are spread back out to the fire rate of the weapon
+	while (ServerShotQueue.Shots.Num() > 0)
+	{
+		const float FireDelay = EquippedWeapon ? EquippedWeapon->GetFireDelay() : 0.f;
+		const float WaitTime = LastAuthorityFireTime + FireDelay - GetWorld()->GetTimeSeconds();
+		if (LastAuthorityFireTime >= 0.f && WaitTime > 0.f)
+		{
+			Character->GetWorldTimerManager().SetTimer(ServerShotTimer, this, &UCombatComponent::ReleaseServerShots, WaitTime);
+			return;
+		}
+
+		const TPair<int32, FFireShot> QueuedShot = ServerShotQueue.Shots[0];
+		ServerShotQueue.Shots.RemoveAt(0, 1, false);
+		AuthorityFire(QueuedShot.Key, QueuedShot.Value);
+	}
+}
+
+void UCombatComponent::AuthorityFire(int32 ShotSequence, const FFireShot& Shot)
+{
+	// Rejected shots are processed as well, the client stops resending them
+	AckedShotSequence = ShotSequence;
+	if (!CanAuthorityFire()) return;
+
+	// Rebuilt from the shot input, the client only sends where it aimed. Spread tighter than the server allows is widened
+	FFireShot ServerShot = Shot;
+	ServerShot.Spread = FMath::Max(Shot.Spread, GetMinShotSpread(Shot));
+	const FVector_NetQuantize TraceHitTarget = EquippedWeapon->GetShotTarget(ServerShot);
+	if (!LocalFire(TraceHitTarget, ServerShot, ShotSequence)) return;
+
+	LastAuthorityFireTime = GetWorld()->GetTimeSeconds();
+	if (!Character->IsLocallyControlled() && Character->GetLagCompensation())
+	{
+		// Hits the owner reports for this shot are traced from here
+		Character->GetLagCompensation()->ShotFired(ShotSequence, EquippedWeapon, EquippedWeapon->GetMuzzleLocation(), TraceHitTarget, ABaseWeapon::GetFireSeed(ServerShot));
+	}
+	FanOutFireEvent(EquippedWeapon->MakeFireEvent(TraceHitTarget, ServerShot));
+	EquippedWeapon->AckShot(ShotSequence);
+
+	bFiring = true;
+	Character->GetWorldTimerManager().SetTimer(FiringStateTimer, this, &UCombatComponent::FiringStateExpired, CVarFiringStateHold.GetValueOnGameThread());
+}
+
+void UCombatComponent::FanOutFireEvent(const FFireEvent& FireEvent)
+{
+	if (Character == nullptr) return;
+
+	const bool bFilter = CVarFireFanOut.GetValueOnGameThread() != 0;
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		AHAPlayerController* Viewer = Cast<AHAPlayerController>(It->Get());
+		// The listen server fired in AuthorityFire, the shooter fired locally
+		if (Viewer == nullptr || Viewer->IsLocalController() || Viewer == Character->Controller) continue;
+
+		// The shooter could not be resolved on a client without its channel
+		UNetConnection* Connection = Viewer->GetNetConnection();
+		if (Connection == nullptr || Connection->FindActorChannelRef(Character) == nullptr) continue;
+
+		if (bFilter && !HAFireFanOut::IsRelevant(Viewer, FireEvent.Origin))
+		{
+			INC_DWORD_STAT(STAT_HAFireEventsFiltered);
+			continue;
+		}
+
+		INC_DWORD_STAT(STAT_HAFireEventsSent);
+		Viewer->ClientFireEvent(Character, FireEvent);
+	}
+}
+
+void UCombatComponent::FiringStateExpired()
+{
+	bFiring = false;
+}
+
+void UCombatComponent::OnRep_Firing()
+{
+	if (Character == nullptr) return;
+
+	if (!bFiring)
+	{
+		Character->GetWorldTimerManager().ClearTimer(DistantFireTimer);
+		return;
+	}
+
+	const float FireDelay = EquippedWeapon ? FMath::Max(EquippedWeapon->GetFireDelay(), 0.05f) : 0.1f;
+	Character->GetWorldTimerManager().SetTimer(DistantFireTimer, this, &UCombatComponent::DistantFireTimerFinished, FireDelay, true, 0.f);
+}
+
+void UCombatComponent::DistantFireTimerFinished()
+{
+	if (EquippedWeapon == nullptr || CombatState != ECombatState::ECS_Unoccupide) return;
+
+	// Clients getting fire events already play every shot
+	const float FireDelay = FMath::Max(EquippedWeapon->GetFireDelay(), 0.05f);
+	if (LastFireEventTime >= 0.f && GetWorld()->GetTimeSeconds() - LastFireEventTime < FireDelay * 2.f) return;
+
+	EquippedWeapon->PlayFireAnimation();
+}
+
+void UCombatComponent::SimulatedFire(const FFireEvent& FireEvent)
+{
+	LastFireEventTime = GetWorld()->GetTimeSeconds();
+	if (EquippedWeapon == nullptr || static_cast<uint8>(EquippedWeapon->GetWeaponType()) != FireEvent.WeaponType) return;
+
+	// Events queued behind a hitch would all play at once, shots older than the rendered shooter are skipped
+	const FRewindFrame RenderedFrame = Character->GetRenderedRewindFrame();
+	if (RenderedFrame.IsValid() && FireEvent.ServerFrame != INDEX_NONE && RenderedFrame.Frame - FireEvent.ServerFrame > CVarMaxFireEventAge.GetValueOnGameThread()) return;
+
+	if (CombatState == ECombatState::ECS_Unoccupide)
+	{
+		Character->PlayFireMontage(bAiming);
+		EquippedWeapon->FireFromEvent(FireEvent);
+	}
+}
+
+bool UCombatComponent::LocalFire(const FVector_NetQuantize& TraceHitTarget, const FFireShot& Shot, int32 ShotSequence)
+{
+	if (EquippedWeapon == nullptr) return false;
 	if (Character && CombatState == ECombatState::ECS_Unoccupide)
 	{
 		Character->PlayFireMontage(bAiming);
-		EquippedWeapon->Fire(TraceHitTarget);
+		EquippedWeapon->FireShot(TraceHitTarget, Shot, ShotSequence);
+		return true;
 	}
+	return false;
 }
 
 /*
@@ -444,6 +685,7 @@ void UCombatComponent::HandleReload()
 {
 	if (Character)
 	{
+		// Kept on dedicated servers, its notify finishes the reload and it moves the hit box bones rewind captures
 		Character->PlayReloadMontage();
 	}
 }
@@ -486,5 +728,25 @@ bool UCombatComponent::CanFire()
 	return !EquippedWeapon->IsEmpty() && bCanFire && CombatState == ECombatState::ECS_Unoccupide;
 }
 
+bool UCombatComponent::CanAuthorityFire()
+{
+	if(EquippedWeapon == nullptr) return false;
+	return !EquippedWeapon->IsEmpty() && CombatState == ECombatState::ECS_Unoccupide;
+}
+
+uint8 UCombatComponent::GetMinShotSpread(const FFireShot& Shot) const
+{
+	if(EquippedWeapon == nullptr) return 0;
+
+	// The aim state of the server lags the shooter's, while it aims or recovers the shot's own aim state counts
+	const float HipScatter = EquippedWeapon->GetWeaponData().HipScatter;
+	const bool bAimRecent = bAiming || (LastAimedTime >= 0.f && GetWorld()->GetTimeSeconds() - LastAimedTime <= CVarAimSpreadRecoveryTime.GetValueOnGameThread());
+	if(!bAimRecent) return FWeaponSpread::QuantizeSpread(HipScatter);
+	if(Shot.bAiming) return 0;
+
+	// HipSpread dips below the scatter by up to the full aim factor while aiming recovers
+	return FWeaponSpread::QuantizeSpread(FMath::Max(HipScatter - AimSpreadFactor, 0.f));
+}
+
 
 
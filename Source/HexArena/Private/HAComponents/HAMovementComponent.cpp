@@ -66,10 +66,10 @@ void UHAMovementComponent::OnWeaponChanged(ABaseWeapon* Weapon)
 	if(Weapon)
 	{
 		UE_LOG(LogTemp, Warning, TEXT("Movement component: WeaponChanged"));
-		CurrentWalkSpeed = Weapon->WeaponData.BaseWalkSpeed;
-		CurrentCrouchWalkSpeed = Weapon->WeaponData.BaseCrouchSpeed;
-		CurrentRunMultiplyer = Weapon->WeaponData.RunMultiplyer;
-		CurrentAimSpeedMultiplyer = Weapon->WeaponData.ADSMultiplyer;
+		CurrentWalkSpeed = Weapon->GetWeaponData().BaseWalkSpeed;
+		CurrentCrouchWalkSpeed = Weapon->GetWeaponData().BaseCrouchSpeed;
+		CurrentRunMultiplyer = Weapon->GetWeaponData().RunMultiplyer;
+		CurrentAimSpeedMultiplyer = Weapon->GetWeaponData().ADSMultiplyer;
 		SetSpeed(HAOwnerCharacter->IsAiming());
 	}
 	else
@@ -0,0 +1,323 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HAComponents/HitBoxHistory.h"
+#include "HAComponents/HitBoxComponent.h"
+
+/**
+ * Quantization
+ */
+
+static constexpr float OffsetToQuantized = 32767.f / FHitBoxHistory::MaxBoxOffset;
+static constexpr float QuantizedToOffset = FHitBoxHistory::MaxBoxOffset / 32767.f;
+
+// Smallest three components of a unit quaternion are within +-1/sqrt(2)
+static constexpr float QuatComponentRange = 0.70710678f;
+static constexpr uint32 QuatComponentMax = 1023;
+
+// Quantized steps of one rotation component still treated as the same pose
+static constexpr int32 SamePoseRotationSteps = 2;
+
+// Dot product of root rotations still treated as the same pose, about half a degree
+static constexpr float SamePoseRootRotationDot = 0.99999f;
+
+static FORCEINLINE int16 QuantizeOffset(float Value)
+{
+	return static_cast<int16>(FMath::Clamp(FMath::RoundToInt(Value * OffsetToQuantized), -32767, 32767));
+}
+
+// 2 bits index of the dropped largest component, then 10 bits for each of the other three
+static uint32 CompressQuat(const FQuat4f& InQuat)
+{
+	const FQuat4f Quat = InQuat.GetNormalized();
+	const float Components[4] = { Quat.X, Quat.Y, Quat.Z, Quat.W };
+
+	uint32 Largest = 0;
+	for (uint32 Index = 1; Index < 4; Index++)
+	{
+		if (FMath::Abs(Components[Index]) > FMath::Abs(Components[Largest]))
+		{
+			Largest = Index;
+		}
+	}
+
+	// q and -q are the same rotation, the dropped component is always rebuilt positive
+	const float Sign = Components[Largest] < 0.f ? -1.f : 1.f;
+
+	uint32 Packed = Largest;
+	uint32 Shift = 2;
+	for (uint32 Index = 0; Index < 4; Index++)
+	{
+		if (Index == Largest) continue;
+
+		const float Normalized = (Components[Index] * Sign / QuatComponentRange) * 0.5f + 0.5f;
+		const uint32 Quantized = static_cast<uint32>(FMath::Clamp(FMath::RoundToInt(Normalized * QuatComponentMax), 0, static_cast<int32>(QuatComponentMax)));
+		Packed |= Quantized << Shift;
+		Shift += 10;
+	}
+	return Packed;
+}
+
+static FORCEINLINE VectorRegister4Float DecompressQuat(uint32 Packed)
+{
+	const uint32 Largest = Packed & 3;
+
+	float Components[4];
+	float SumSquared = 0.f;
+	uint32 Shift = 2;
+	for (uint32 Index = 0; Index < 4; Index++)
+	{
+		if (Index == Largest) continue;
+
+		const float Normalized = static_cast<float>((Packed >> Shift) & QuatComponentMax) / QuatComponentMax;
+		Components[Index] = (Normalized * 2.f - 1.f) * QuatComponentRange;
+		SumSquared += Components[Index] * Components[Index];
+		Shift += 10;
+	}
+	Components[Largest] = FMath::Sqrt(FMath::Max(0.f, 1.f - SumSquared));
+
+	return VectorNormalizeQuaternion(MakeVectorRegisterFloat(Components[0], Components[1], Components[2], Components[3]));
+}
+
+static FORCEINLINE bool IsSameRotation(uint32 A, uint32 B)
+{
+	if ((A & 3) != (B & 3)) return false;
+
+	for (uint32 Shift = 2; Shift < 32; Shift += 10)
+	{
+		const int32 ComponentA = (A >> Shift) & QuatComponentMax;
+		const int32 ComponentB = (B >> Shift) & QuatComponentMax;
+		if (FMath::Abs(ComponentA - ComponentB) > SamePoseRotationSteps) return false;
+	}
+	return true;
+}
+
+/**
+ * History
+ */
+
+void FHitBoxHistory::Init(int32 InCapacity, int32 InNumBoxes)
+{
+	Capacity = FMath::Max(InCapacity, 2);
+	NumBoxes = InNumBoxes;
+	NumEntries = 0;
+
+	ServerFrames.Reset();
+	RootLocations.Reset();
+	RootRotations.Reset();
+	BoxOffsets.Reset();
+	BoxRotations.Reset();
+	Extents.Reset();
+	Rings.Reset();
+	ServerFrameSlots.Reset();
+}
+
+void FHitBoxHistory::SetNumEntries(int32 InNumEntries)
+{
+	if (InNumEntries <= NumEntries) return;
+
+	// Entries are laid out one after another, growing never moves existing histories around
+	ServerFrames.SetNumZeroed(InNumEntries * Capacity);
+	RootLocations.SetNumZeroed(InNumEntries * Capacity);
+	RootRotations.SetNumZeroed(InNumEntries * Capacity);
+	BoxOffsets.SetNumZeroed(InNumEntries * Capacity * NumBoxes);
+	BoxRotations.SetNumZeroed(InNumEntries * Capacity * NumBoxes);
+	Extents.SetNumZeroed(InNumEntries * NumBoxes);
+	Rings.SetNum(InNumEntries);
+	ServerFrameSlots.SetNum(InNumEntries * Capacity);
+	NumEntries = InNumEntries;
+}
+
+void FHitBoxHistory::ResetEntry(int32 Entry, const TArray<UHitBoxComponent*>& HitBoxes)
+{
+	if (!Rings.IsValidIndex(Entry) || HitBoxes.Num() != NumBoxes) return;
+
+	Rings[Entry] = FEntryRing();
+	for (int32 Index = Entry * Capacity; Index < (Entry + 1) * Capacity; Index++)
+	{
+		ServerFrameSlots[Index] = FServerFrameSlot();
+	}
+
+	FVector3f* EntryExtents = Extents.GetData() + Entry * NumBoxes;
+	for (int32 BoxIndex = 0; BoxIndex < NumBoxes; BoxIndex++)
+	{
+		EntryExtents[BoxIndex] = HitBoxes[BoxIndex] ? FVector3f(HitBoxes[BoxIndex]->GetScaledBoxExtent()) : FVector3f::ZeroVector;
+	}
+}
+
+bool FHitBoxHistory::IsSamePose(int32 Slot, const FVector3f& RootLocation, const FQuat4f& RootRotation, const FQuantizedBoxOffset* Offsets, const uint32* Rotations, float MoveThreshold) const
+{
+	if (FVector3f::DistSquared(RootLocations[Slot], RootLocation) > FMath::Square(MoveThreshold)) return false;
+	if (FMath::Abs(RootRotations[Slot] | RootRotation) < SamePoseRootRotationDot) return false;
+
+	const int32 OffsetThreshold = FMath::CeilToInt(MoveThreshold * OffsetToQuantized);
+	const FQuantizedBoxOffset* StoredOffsets = BoxOffsets.GetData() + Slot * NumBoxes;
+	const uint32* StoredRotations = BoxRotations.GetData() + Slot * NumBoxes;
+	for (int32 BoxIndex = 0; BoxIndex < NumBoxes; BoxIndex++)
+	{
+		const bool bMoved =
+			FMath::Abs(StoredOffsets[BoxIndex].X - Offsets[BoxIndex].X) > OffsetThreshold ||
+			FMath::Abs(StoredOffsets[BoxIndex].Y - Offsets[BoxIndex].Y) > OffsetThreshold ||
+			FMath::Abs(StoredOffsets[BoxIndex].Z - Offsets[BoxIndex].Z) > OffsetThreshold ||
+			!IsSameRotation(StoredRotations[BoxIndex], Rotations[BoxIndex]);
+
+		if (bMoved) return false;
+	}
+	return true;
+}
+
+void FHitBoxHistory::CaptureEntry(int32 Entry, int32 ServerFrame, const FTransform& RootTransform, const TArray<UHitBoxComponent*>& HitBoxes, float MoveThreshold)
+{
+	if (Entry >= NumEntries || HitBoxes.Num() != NumBoxes) return;
+
+	const FVector RootLocation = RootTransform.GetLocation();
+	const FQuat RootRotation = RootTransform.GetRotation();
+	const FQuat InverseRootRotation = RootRotation.Inverse();
+
+	TArray<FQuantizedBoxOffset, TInlineAllocator<32>> Offsets;
+	TArray<uint32, TInlineAllocator<32>> Rotations;
+	Offsets.SetNumZeroed(NumBoxes);
+	Rotations.SetNumZeroed(NumBoxes);
+	for (int32 BoxIndex = 0; BoxIndex < NumBoxes; BoxIndex++)
+	{
+		const UHitBoxComponent* Box = HitBoxes[BoxIndex];
+		if (Box == nullptr) continue;
+
+		const FTransform& BoxTransform = Box->GetComponentTransform();
+		const FVector Offset = InverseRootRotation.RotateVector(BoxTransform.GetLocation() - RootLocation);
+		Offsets[BoxIndex].X = QuantizeOffset(Offset.X);
+		Offsets[BoxIndex].Y = QuantizeOffset(Offset.Y);
+		Offsets[BoxIndex].Z = QuantizeOffset(Offset.Z);
+		Rotations[BoxIndex] = CompressQuat(FQuat4f(InverseRootRotation * BoxTransform.GetRotation()));
+	}
+
+	FEntryRing& Ring = Rings[Entry];
+
+	if (Ring.NumFrames > 0 && MoveThreshold > 0.f)
+	{
+		const int32 NewestSlot = ToSlot(Entry, Ring.NumFrames - 1);
+		if (IsSamePose(NewestSlot, FVector3f(RootLocation), FQuat4f(RootRotation), Offsets.GetData(), Rotations.GetData(), MoveThreshold))
+		{
+			// Still pose is kept as two frames, when it started and the one standing in for every server frame since
+			if (Ring.bNewestIsHold)
+			{
+				ServerFrameSlots[Entry * Capacity + ServerFrame % Capacity] = { ServerFrame, NewestSlot };
+				return;
+			}
+			Ring.bNewestIsHold = true;
+		}
+		else
+		{
+			Ring.bNewestIsHold = false;
+		}
+	}
+
+	int32 Slot;
+	if (Ring.NumFrames < Capacity)
+	{
+		Slot = ToSlot(Entry, Ring.NumFrames);
+		++Ring.NumFrames;
+	}
+	else
+	{
+		Slot = ToSlot(Entry, 0);
+		Ring.Oldest = (Ring.Oldest + 1) % Capacity;
+	}
+
+	ServerFrames[Slot] = ServerFrame;
+	ServerFrameSlots[Entry * Capacity + ServerFrame % Capacity] = { ServerFrame, Slot };
+	RootLocations[Slot] = FVector3f(RootLocation);
+	RootRotations[Slot] = FQuat4f(RootRotation);
+	FMemory::Memcpy(BoxOffsets.GetData() + Slot * NumBoxes, Offsets.GetData(), NumBoxes * sizeof(FQuantizedBoxOffset));
+	FMemory::Memcpy(BoxRotations.GetData() + Slot * NumBoxes, Rotations.GetData(), NumBoxes * sizeof(uint32));
+}
+
+int32 FHitBoxHistory::FindFrame(int32 Entry, int32 ServerFrame) const
+{
+	if (!Rings.IsValidIndex(Entry) || ServerFrame < 0) return INDEX_NONE;
+
+	const FServerFrameSlot& FrameSlot = ServerFrameSlots[Entry * Capacity + ServerFrame % Capacity];
+	if (FrameSlot.ServerFrame != ServerFrame) return INDEX_NONE;
+
+	// Slot was reused by a later frame since
+	if (ServerFrames[FrameSlot.Slot] > ServerFrame) return INDEX_NONE;
+
+	return ToFrame(Entry, FrameSlot.Slot);
+}
+
+void FHitBoxHistory::DecompressFrame(int32 Entry, int32 Frame, FVector3f* OutLocations, FQuat4f* OutRotations) const
+{
+	const int32 Slot = ToSlot(Entry, Frame);
+	const VectorRegister4Float RootLocation = VectorLoadFloat3(&RootLocations[Slot].X);
+	const VectorRegister4Float RootRotation = VectorLoad(&RootRotations[Slot].X);
+	const FQuantizedBoxOffset* Offsets = BoxOffsets.GetData() + Slot * NumBoxes;
+	const uint32* Rotations = BoxRotations.GetData() + Slot * NumBoxes;
+
+	for (int32 BoxIndex = 0; BoxIndex < NumBoxes; BoxIndex++)
+	{
+		const VectorRegister4Float Offset = MakeVectorRegisterFloat(
+			Offsets[BoxIndex].X * QuantizedToOffset,
+			Offsets[BoxIndex].Y * QuantizedToOffset,
+			Offsets[BoxIndex].Z * QuantizedToOffset,
+			0.f);
+		VectorStoreFloat3(VectorAdd(RootLocation, VectorQuaternionRotateVector(RootRotation, Offset)), &OutLocations[BoxIndex].X);
+		VectorStore(VectorQuaternionMultiply2(RootRotation, DecompressQuat(Rotations[BoxIndex])), &OutRotations[BoxIndex].X);
+	}
+}
+
+void FHitBoxHistory::InterpBetweenFrames(int32 Entry, int32 OlderFrame, int32 YoungerFrame, float Alpha, FVector3f* OutLocations, FQuat4f* OutRotations) const
+{
+	DecompressFrame(Entry, OlderFrame, OutLocations, OutRotations);
+	if (OlderFrame == YoungerFrame) return;
+
+	TArray<FVector3f, TInlineAllocator<32>> YoungerLocations;
+	TArray<FQuat4f, TInlineAllocator<32>> YoungerRotations;
+	YoungerLocations.SetNumUninitialized(NumBoxes);
+	YoungerRotations.SetNumUninitialized(NumBoxes);
+	DecompressFrame(Entry, YoungerFrame, YoungerLocations.GetData(), YoungerRotations.GetData());
+
+	const VectorRegister4Float VAlpha = VectorSetFloat1(FMath::Clamp(Alpha, 0.f, 1.f));
+
+	for (int32 BoxIndex = 0; BoxIndex < NumBoxes; BoxIndex++)
+	{
+		const VectorRegister4Float OlderLocation = VectorLoadFloat3(&OutLocations[BoxIndex].X);
+		const VectorRegister4Float YoungerLocation = VectorLoadFloat3(&YoungerLocations[BoxIndex].X);
+		const VectorRegister4Float Location = VectorMultiplyAdd(VectorSubtract(YoungerLocation, OlderLocation), VAlpha, OlderLocation);
+		VectorStoreFloat3(Location, &OutLocations[BoxIndex].X);
+
+		const VectorRegister4Float OlderRotation = VectorLoad(&OutRotations[BoxIndex].X);
+		const VectorRegister4Float YoungerRotation = VectorLoad(&YoungerRotations[BoxIndex].X);
+		const VectorRegister4Float Rotation = VectorNormalizeQuaternion(VectorLerpQuat(OlderRotation, YoungerRotation, VAlpha));
+		VectorStore(Rotation, &OutRotations[BoxIndex].X);
+	}
+}
+
+bool FHitBoxHistory::GetPoseAtFrame(int32 Entry, int32 ServerFrame, float Alpha, FVector3f* OutLocations, FQuat4f* OutRotations) const
+{
+	const int32 OlderFrame = FindFrame(Entry, ServerFrame);
+	if (OlderFrame == INDEX_NONE) return false;
+
+	// Newest server frame, or both server frames share one still pose
+	const int32 YoungerFrame = FindFrame(Entry, ServerFrame + 1);
+	if (YoungerFrame == INDEX_NONE || YoungerFrame == OlderFrame || Alpha <= 0.f)
+	{
+		DecompressFrame(Entry, OlderFrame, OutLocations, OutRotations);
+		return true;
+	}
+
+	InterpBetweenFrames(Entry, OlderFrame, YoungerFrame, Alpha, OutLocations, OutRotations);
+	return true;
+}
+
+SIZE_T FHitBoxHistory::GetAllocatedSize() const
+{
+	return
+		ServerFrames.GetAllocatedSize() +
+		RootLocations.GetAllocatedSize() +
+		RootRotations.GetAllocatedSize() +
+		BoxOffsets.GetAllocatedSize() +
+		BoxRotations.GetAllocatedSize() +
+		Extents.GetAllocatedSize() +
+		Rings.GetAllocatedSize() +
+		ServerFrameSlots.GetAllocatedSize();
+}
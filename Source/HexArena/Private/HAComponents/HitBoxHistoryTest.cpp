@@ -0,0 +1,231 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HAComponents/HitBoxHistory.h"
+#include "HAComponents/HitBoxComponent.h"
+#include "Misc/AutomationTest.h"
+#include "UObject/Package.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * FHitBoxHistory tests
+ * Boxes are never registered, captures only read their component transforms.
+ */
+
+namespace HitBoxHistoryTest
+{
+	static constexpr int32 NumBoxes = 3;
+
+	// Half a quantization step of a box offset, with room for float error of world space locations
+	static constexpr float LocationTolerance = 0.5f * FHitBoxHistory::MaxBoxOffset / 32767.f + 0.005f;
+
+	// Half a step on each of the three 10 bit components is about a seventh of a degree
+	static constexpr float RotationTolerance = 0.005f;
+
+	static TArray<UHitBoxComponent*> MakeBoxes()
+	{
+		TArray<UHitBoxComponent*> Boxes;
+		for (int32 BoxIndex = 0; BoxIndex < NumBoxes; BoxIndex++)
+		{
+			UHitBoxComponent* Box = NewObject<UHitBoxComponent>(GetTransientPackage());
+			Box->SetBoxExtent(FVector(10.f + BoxIndex, 20.f, 30.f), false);
+			Boxes.Add(Box);
+		}
+		return Boxes;
+	}
+
+	// Places Box at Offset from the root, rotated by LocalRotation relative to it
+	static void PlaceBox(UHitBoxComponent* Box, const FTransform& Root, const FVector& Offset, const FQuat& LocalRotation)
+	{
+		Box->SetWorldLocationAndRotation(Root.TransformPosition(Offset), Root.GetRotation() * LocalRotation, false, nullptr, ETeleportType::TeleportPhysics);
+	}
+
+	static void PlacePose(const TArray<UHitBoxComponent*>& Boxes, const FTransform& Root, float Lean)
+	{
+		PlaceBox(Boxes[0], Root, FVector(0.f, 0.f, 90.f + Lean), FQuat(FRotator(Lean, 0.f, 0.f)));
+		PlaceBox(Boxes[1], Root, FVector(20.f + Lean, -15.f, 40.f), FQuat(FRotator(10.f, 35.f + Lean, -20.f)));
+		PlaceBox(Boxes[2], Root, FVector(-5.f, 15.f, -60.f), FQuat(FRotator(-70.f, 120.f, 45.f + Lean)));
+	}
+
+	static float AngularDistance(const FQuat4f& A, const FQuat& B)
+	{
+		return static_cast<float>(FQuat(A).AngularDistance(B));
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHitBoxHistoryCompressionTest, "HexArena.Rewind.HitBoxHistory.Compression", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FHitBoxHistoryCompressionTest::RunTest(const FString& Parameters)
+{
+	using namespace HitBoxHistoryTest;
+
+	const TArray<UHitBoxComponent*> Boxes = MakeBoxes();
+	FHitBoxHistory History;
+	History.Init(8, NumBoxes);
+	History.SetNumEntries(1);
+	History.ResetEntry(0, Boxes);
+
+	TestEqual(TEXT("Extents are stored"), FVector(History.GetExtents(0)[1]), Boxes[1]->GetScaledBoxExtent());
+
+	const FTransform Root(FRotator(0.f, 73.f, 0.f), FVector(1234.f, -567.f, 89.f));
+	PlacePose(Boxes, Root, 0.f);
+	// Past the largest offset quantization can represent, clamped to it
+	PlaceBox(Boxes[2], Root, FVector(FHitBoxHistory::MaxBoxOffset + 44.f, 15.f, -60.f), FQuat(FRotator(-70.f, 120.f, 45.f)));
+
+	History.CaptureEntry(0, 0, Root, Boxes, 0.f);
+	TestEqual(TEXT("Frame is stored"), History.Num(0), 1);
+
+	FVector3f Locations[NumBoxes];
+	FQuat4f Rotations[NumBoxes];
+	History.DecompressFrame(0, 0, Locations, Rotations);
+
+	for (int32 BoxIndex = 0; BoxIndex < NumBoxes - 1; BoxIndex++)
+	{
+		const FTransform& BoxTransform = Boxes[BoxIndex]->GetComponentTransform();
+		TestTrue(FString::Printf(TEXT("Box %d location within a quantization step"), BoxIndex),
+			FVector(Locations[BoxIndex]).Equals(BoxTransform.GetLocation(), LocationTolerance));
+		TestTrue(FString::Printf(TEXT("Box %d rotation within a quantization step"), BoxIndex),
+			AngularDistance(Rotations[BoxIndex], BoxTransform.GetRotation()) < RotationTolerance);
+	}
+
+	const FVector ClampedLocation = Root.TransformPosition(FVector(FHitBoxHistory::MaxBoxOffset, 15.f, -60.f));
+	TestTrue(TEXT("Offset past MaxBoxOffset is clamped"), FVector(Locations[2]).Equals(ClampedLocation, LocationTolerance));
+	TestTrue(TEXT("Rotation of a clamped box is kept"), AngularDistance(Rotations[2], Boxes[2]->GetComponentQuat()) < RotationTolerance);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHitBoxHistoryHoldTest, "HexArena.Rewind.HitBoxHistory.HoldFrames", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FHitBoxHistoryHoldTest::RunTest(const FString& Parameters)
+{
+	using namespace HitBoxHistoryTest;
+
+	const TArray<UHitBoxComponent*> Boxes = MakeBoxes();
+	FHitBoxHistory History;
+	History.Init(8, NumBoxes);
+	History.SetNumEntries(1);
+	History.ResetEntry(0, Boxes);
+
+	const FTransform Root(FRotator(0.f, 10.f, 0.f), FVector(100.f, 200.f, 0.f));
+	PlacePose(Boxes, Root, 0.f);
+	for (int32 ServerFrame = 0; ServerFrame < 6; ServerFrame++)
+	{
+		History.CaptureEntry(0, ServerFrame, Root, Boxes, 1.f);
+	}
+
+	TestEqual(TEXT("Still pose is stored as two frames"), History.Num(0), 2);
+	TestEqual(TEXT("First server frame keeps its own frame"), History.FindFrame(0, 0), 0);
+	for (int32 ServerFrame = 1; ServerFrame < 6; ServerFrame++)
+	{
+		TestEqual(FString::Printf(TEXT("Server frame %d maps to the hold frame"), ServerFrame), History.FindFrame(0, ServerFrame), 1);
+	}
+
+	// Moving within the threshold is still the same pose
+	const FTransform NudgedRoot(Root.GetRotation(), Root.GetLocation() + FVector(0.5f, 0.f, 0.f));
+	PlacePose(Boxes, NudgedRoot, 0.f);
+	History.CaptureEntry(0, 6, NudgedRoot, Boxes, 1.f);
+	TestEqual(TEXT("Pose within MoveThreshold is held"), History.Num(0), 2);
+
+	PlacePose(Boxes, Root, 5.f);
+	History.CaptureEntry(0, 7, Root, Boxes, 1.f);
+	TestEqual(TEXT("Moved pose is stored"), History.Num(0), 3);
+	TestEqual(TEXT("Moved pose has its own frame"), History.FindFrame(0, 7), 2);
+	TestEqual(TEXT("Hold frame keeps the server frame it started at"), History.GetServerFrame(0, 1), 1);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHitBoxHistoryFindFrameTest, "HexArena.Rewind.HitBoxHistory.FindFrame", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FHitBoxHistoryFindFrameTest::RunTest(const FString& Parameters)
+{
+	using namespace HitBoxHistoryTest;
+
+	static constexpr int32 Capacity = 4;
+
+	const TArray<UHitBoxComponent*> Boxes = MakeBoxes();
+	FHitBoxHistory History;
+	History.Init(Capacity, NumBoxes);
+	History.SetNumEntries(2);
+	History.ResetEntry(0, Boxes);
+	History.ResetEntry(1, Boxes);
+
+	TestEqual(TEXT("Empty entry misses"), History.FindFrame(0, 0), INDEX_NONE);
+
+	// Moves every frame, each one is stored and the ring wraps
+	const FTransform Root(FVector(0.f, 0.f, 100.f));
+	for (int32 ServerFrame = 0; ServerFrame < Capacity + 2; ServerFrame++)
+	{
+		PlacePose(Boxes, Root, 10.f * ServerFrame);
+		History.CaptureEntry(0, ServerFrame, Root, Boxes, 1.f);
+	}
+
+	TestEqual(TEXT("Ring holds Capacity frames"), History.Num(0), Capacity);
+	TestEqual(TEXT("Overwritten server frame misses"), History.FindFrame(0, 0), INDEX_NONE);
+	TestEqual(TEXT("Overwritten server frame misses"), History.FindFrame(0, 1), INDEX_NONE);
+	TestEqual(TEXT("Oldest kept server frame is frame 0"), History.FindFrame(0, 2), 0);
+	TestEqual(TEXT("Newest server frame is the last frame"), History.FindFrame(0, Capacity + 1), Capacity - 1);
+	TestEqual(TEXT("Future server frame misses"), History.FindFrame(0, Capacity + 2), INDEX_NONE);
+	TestEqual(TEXT("Server frame sharing a lookup slot misses"), History.FindFrame(0, Capacity * 2 + 1), INDEX_NONE);
+	TestEqual(TEXT("Negative server frame misses"), History.FindFrame(0, -1), INDEX_NONE);
+	TestEqual(TEXT("Other entry misses"), History.FindFrame(1, Capacity + 1), INDEX_NONE);
+	TestEqual(TEXT("Invalid entry misses"), History.FindFrame(2, 0), INDEX_NONE);
+
+	FVector3f Locations[NumBoxes];
+	FQuat4f Rotations[NumBoxes];
+	TestFalse(TEXT("No pose at an overwritten server frame"), History.GetPoseAtFrame(0, 1, 0.5f, Locations, Rotations));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHitBoxHistoryInterpTest, "HexArena.Rewind.HitBoxHistory.Interpolation", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FHitBoxHistoryInterpTest::RunTest(const FString& Parameters)
+{
+	using namespace HitBoxHistoryTest;
+
+	const TArray<UHitBoxComponent*> Boxes = MakeBoxes();
+	FHitBoxHistory History;
+	History.Init(8, NumBoxes);
+	History.SetNumEntries(1);
+	History.ResetEntry(0, Boxes);
+
+	const FTransform OlderRoot(FRotator(0.f, 0.f, 0.f), FVector(0.f, 0.f, 100.f));
+	const FTransform YoungerRoot(FRotator(0.f, 90.f, 0.f), FVector(100.f, 0.f, 100.f));
+	PlacePose(Boxes, OlderRoot, 0.f);
+	History.CaptureEntry(0, 10, OlderRoot, Boxes, 1.f);
+	PlacePose(Boxes, YoungerRoot, 0.f);
+	History.CaptureEntry(0, 11, YoungerRoot, Boxes, 1.f);
+
+	FVector3f Older[NumBoxes];
+	FVector3f Younger[NumBoxes];
+	FQuat4f Rotations[NumBoxes];
+	History.DecompressFrame(0, 0, Older, Rotations);
+	History.DecompressFrame(0, 1, Younger, Rotations);
+
+	FVector3f Locations[NumBoxes];
+	for (const float Alpha : { 0.f, 0.25f, 0.5f, 1.f })
+	{
+		TestTrue(TEXT("Pose between captured frames"), History.GetPoseAtFrame(0, 10, Alpha, Locations, Rotations));
+		for (int32 BoxIndex = 0; BoxIndex < NumBoxes; BoxIndex++)
+		{
+			const FVector3f Expected = FMath::Lerp(Older[BoxIndex], Younger[BoxIndex], Alpha);
+			TestTrue(FString::Printf(TEXT("Box %d location is lerped at %.2f"), BoxIndex, Alpha), Locations[BoxIndex].Equals(Expected, LocationTolerance));
+		}
+	}
+
+	// Root box has no local rotation, halfway is halfway through the root turn
+	History.GetPoseAtFrame(0, 10, 0.5f, Locations, Rotations);
+	TestTrue(TEXT("Rotation is slerped halfway"), AngularDistance(Rotations[0], FQuat(FRotator(0.f, 45.f, 0.f))) < RotationTolerance);
+
+	// Newest server frame has nothing to interpolate towards
+	FVector3f Newest[NumBoxes];
+	TestTrue(TEXT("Pose at the newest server frame"), History.GetPoseAtFrame(0, 11, 0.5f, Newest, Rotations));
+	TestTrue(TEXT("Newest server frame is not interpolated"), Newest[0].Equals(Younger[0], LocationTolerance));
+
+	return true;
+}
+
+#endif
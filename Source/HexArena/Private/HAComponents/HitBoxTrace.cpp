@@ -0,0 +1,138 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HAComponents/HitBoxTrace.h"
+
+static bool SegmentHitsSphere(const FVector3f& Start, const FVector3f& End, const FVector3f& Center, float RadiusSquared)
+{
+	const FVector3f Delta = End - Start;
+	const float LengthSquared = Delta.SizeSquared();
+	const float T = LengthSquared > SMALL_NUMBER ? FMath::Clamp(FVector3f::DotProduct(Center - Start, Delta) / LengthSquared, 0.f, 1.f) : 0.f;
+	return FVector3f::DistSquared(Start + Delta * T, Center) <= RadiusSquared;
+}
+
+bool FHitBoxTrace::SegmentHitsBox(const VectorRegister4Float& Start, const VectorRegister4Float& Delta, const VectorRegister4Float& Radius, const FHitBoxTracePose& Pose, int32 BoxIndex, float& OutT)
+{
+	const VectorRegister4Float Center = VectorLoadFloat3(&Pose.Locations[BoxIndex].X);
+	const VectorRegister4Float Rotation = VectorLoad(&Pose.Rotations[BoxIndex].X);
+	const VectorRegister4Float Extent = VectorAdd(VectorLoadFloat3(&Pose.Extents[BoxIndex].X), Radius);
+
+	// Into box space, where the box is axis aligned around the origin
+	const VectorRegister4Float LocalStart = VectorQuaternionInverseRotateVector(Rotation, VectorSubtract(Start, Center));
+	VectorRegister4Float LocalDelta = VectorQuaternionInverseRotateVector(Rotation, Delta);
+
+	// Segment parallel to a slab would divide by zero
+	const VectorRegister4Float Epsilon = VectorSetFloat1(KINDA_SMALL_NUMBER);
+	LocalDelta = VectorSelect(VectorCompareLT(VectorAbs(LocalDelta), Epsilon), Epsilon, LocalDelta);
+	const VectorRegister4Float InvDelta = VectorReciprocalAccurate(LocalDelta);
+
+	const VectorRegister4Float T1 = VectorMultiply(VectorSubtract(VectorNegate(Extent), LocalStart), InvDelta);
+	const VectorRegister4Float T2 = VectorMultiply(VectorSubtract(Extent, LocalStart), InvDelta);
+
+	alignas(16) float Near[4];
+	alignas(16) float Far[4];
+	VectorStoreAligned(VectorMin(T1, T2), Near);
+	VectorStoreAligned(VectorMax(T1, T2), Far);
+
+	const float Enter = FMath::Max3(Near[0], Near[1], Near[2]);
+	const float Exit = FMath::Min3(Far[0], Far[1], Far[2]);
+	if (Enter > Exit || Exit < 0.f || Enter > 1.f) return false;
+
+	OutT = FMath::Max(Enter, 0.f);
+	return true;
+}
+
+bool FHitBoxTrace::TraceBallistic(const FHitBoxTraceParams& Params, const FHitBoxTracePose& Pose, int32 FirstBox, int32 NumBoxesToTest, FHitBoxTraceResult& OutResult)
+{
+	const int32 LastBox = FMath::Min(FirstBox + NumBoxesToTest, Pose.NumBoxes);
+	if (FirstBox < 0 || FirstBox >= LastBox || Params.SimFrequency <= 0.f) return false;
+
+	// Broadphase, a sphere around every tested box. Most segments of the arc are far from the character
+	FVector3f BoundsMin(MAX_flt);
+	FVector3f BoundsMax(-MAX_flt);
+	for (int32 BoxIndex = FirstBox; BoxIndex < LastBox; BoxIndex++)
+	{
+		const FVector3f Reach(Pose.Extents[BoxIndex].Size() + Params.Radius);
+		BoundsMin = BoundsMin.ComponentMin(Pose.Locations[BoxIndex] - Reach);
+		BoundsMax = BoundsMax.ComponentMax(Pose.Locations[BoxIndex] + Reach);
+	}
+	const FVector3f BoundsCenter = (BoundsMin + BoundsMax) * 0.5f;
+	const float BoundsRadiusSquared = ((BoundsMax - BoundsMin) * 0.5f).SizeSquared();
+
+	const VectorRegister4Float Radius = VectorSetFloat1(Params.Radius);
+	const FVector3f Gravity(0.f, 0.f, Params.GravityZ);
+	const float SubstepDeltaTime = 1.f / Params.SimFrequency;
+
+	FVector3f Location = Params.Start;
+	FVector3f Velocity = Params.Velocity;
+	float CurrentTime = 0.f;
+
+	while (CurrentTime < Params.MaxSimTime)
+	{
+		// Same integration as PredictProjectilePath, exact for constant gravity
+		const float DeltaTime = FMath::Min(Params.MaxSimTime - CurrentTime, SubstepDeltaTime);
+		const FVector3f NewVelocity = Velocity + Gravity * DeltaTime;
+		const FVector3f NewLocation = Location + (Velocity + NewVelocity) * (0.5f * DeltaTime);
+
+		if (SegmentHitsSphere(Location, NewLocation, BoundsCenter, BoundsRadiusSquared))
+		{
+			const VectorRegister4Float Start = VectorLoadFloat3(&Location.X);
+			const VectorRegister4Float Delta = VectorSubtract(VectorLoadFloat3(&NewLocation.X), Start);
+
+			float BestT = MAX_flt;
+			int32 BestBox = INDEX_NONE;
+			for (int32 BoxIndex = FirstBox; BoxIndex < LastBox; BoxIndex++)
+			{
+				float T;
+				if (SegmentHitsBox(Start, Delta, Radius, Pose, BoxIndex, T) && T < BestT)
+				{
+					BestT = T;
+					BestBox = BoxIndex;
+				}
+			}
+
+			if (BestBox != INDEX_NONE)
+			{
+				OutResult.BoxIndex = BestBox;
+				OutResult.Time = CurrentTime + DeltaTime * BestT;
+				OutResult.Location = Location + (NewLocation - Location) * BestT;
+				return true;
+			}
+		}
+
+		Location = NewLocation;
+		Velocity = NewVelocity;
+		CurrentTime += DeltaTime;
+	}
+
+	return false;
+}
+
+bool FHitBoxTrace::TraceSegment(const FVector3f& Start, const FVector3f& End, float Radius, const FHitBoxTracePose& Pose, int32 FirstBox, int32 NumBoxesToTest, FHitBoxTraceResult& OutResult)
+{
+	const int32 LastBox = FMath::Min(FirstBox + NumBoxesToTest, Pose.NumBoxes);
+	if (FirstBox < 0 || FirstBox >= LastBox) return false;
+
+	const VectorRegister4Float VStart = VectorLoadFloat3(&Start.X);
+	const VectorRegister4Float VDelta = VectorSubtract(VectorLoadFloat3(&End.X), VStart);
+	const VectorRegister4Float VRadius = VectorSetFloat1(Radius);
+
+	float BestT = MAX_flt;
+	int32 BestBox = INDEX_NONE;
+	for (int32 BoxIndex = FirstBox; BoxIndex < LastBox; BoxIndex++)
+	{
+		float T;
+		if (SegmentHitsBox(VStart, VDelta, VRadius, Pose, BoxIndex, T) && T < BestT)
+		{
+			BestT = T;
+			BestBox = BoxIndex;
+		}
+	}
+
+	if (BestBox == INDEX_NONE) return false;
+
+	OutResult.BoxIndex = BestBox;
+	OutResult.Time = BestT;
+	OutResult.Location = Start + (End - Start) * BestT;
+	return true;
+}
@@ -95,19 +95,10 @@ void UInventory::SetPrimaryWeapon(ABaseWeapon* WeaponToSet)
 		PrimaryWeapon = nullptr;
 		Combat->SetWeapon(PrimaryWeapon);
 
-		if (Controller)
-		{
-			Controller->SetHUDAmmoOfType(0);
-			Controller->SetHUDWeaponAmmo(0);
-		}
+		SetHUDAmmo();
 		return;
 	}
 
-	for (auto Attachment : WeaponToSet->GetAttachments())
-	{
-		Attachment->SetOwner(GetOwner());
-	}
-
 	PrimaryWeapon = WeaponToSet;
 	PrimaryWeapon->SetWeaponState(EWeaponState::EWS_Equipped);
 	Combat->SetWeapon(PrimaryWeapon);
@@ -150,11 +141,6 @@ void UInventory::SetSecondaryWeapon(ABaseWeapon* WeaponToSet)
 	SecondaryWeapon->SetWeaponState(EWeaponState::EWS_Inventory);
 	AttachToSecondaryWeaponSocket(WeaponToSet);
 	SecondaryWeapon->SetOwner(Character);
-
-	for (auto Attachment : WeaponToSet->GetAttachments())
-	{
-		Attachment->SetOwner(nullptr);
-	}
 }
 
 void UInventory::OnRep_SecondaryWeapon()
@@ -274,8 +260,8 @@ void UInventory::Reload()
 		int32 ToReload = AmountToReload();
 		UE_LOG(LogTemp, Warning, TEXT("ToReload = % d"), ToReload);
 		PrimaryWeapon->AddAmmo(ToReload);
-		UpdateAmmoValue(PrimaryWeapon->WeaponData.AmmoType, -ToReload);
-		Controller->SetHUDAmmoOfType(GetEquippedWeaponCarriedAmmo());
+		UpdateAmmoValue(PrimaryWeapon->GetWeaponData().AmmoType, -ToReload);
+		SetHUDAmmo(PrimaryWeapon->GetAmmo(), GetEquippedWeaponCarriedAmmo());
 		Combat->CarriedAmmo = GetEquippedWeaponCarriedAmmo();
 	}
 }
@@ -292,7 +278,7 @@ int32 UInventory::AmountToReload()
 int32 UInventory::GetEquippedWeaponCarriedAmmo()
 {
 	if(!PrimaryWeapon) return 0;
-	switch (PrimaryWeapon->WeaponData.AmmoType)
+	switch (PrimaryWeapon->GetWeaponData().AmmoType)
 	{
 	case EAmmoType::EAT_Light:
 		return CurrentLightAmmo;
@@ -320,12 +306,14 @@ int32 UInventory::GetEquippedWeaponCarriedAmmo()
 
 void UInventory::SetHUDAmmo(int32 WeaponAmmo /*= 0*/, int32 CarriedAmmo /*= 0*/)
 {
+#if WITH_COSMETICS
 	Controller = Controller == nullptr ? Cast <AHAPlayerController>(Character->Controller) : Controller;
 	if (Controller)
 	{
 		Controller->SetHUDAmmoOfType(CarriedAmmo);
 		Controller->SetHUDWeaponAmmo(WeaponAmmo);
 	}
+#endif
 }
 
 /**
@@ -368,7 +356,7 @@ void UInventory::AttachToRightHandSocket(AActor* ActorToAttach)
 
 void UInventory::OnRep_LightAmmo()
 {
-	if(PrimaryWeapon && Combat && PrimaryWeapon->WeaponData.AmmoType == EAmmoType::EAT_Light)
+	if(PrimaryWeapon && Combat && PrimaryWeapon->GetWeaponData().AmmoType == EAmmoType::EAT_Light)
 	{
 		Combat->CarriedAmmo = CurrentLightAmmo;
 	}
@@ -376,7 +364,7 @@ void UInventory::OnRep_LightAmmo()
 
 void UInventory::OnRep_RifleAmmo()
 {
-	if (PrimaryWeapon && Combat && PrimaryWeapon->WeaponData.AmmoType == EAmmoType::EAT_Rifle)
+	if (PrimaryWeapon && Combat && PrimaryWeapon->GetWeaponData().AmmoType == EAmmoType::EAT_Rifle)
 	{
 		Combat->CarriedAmmo = CurrentRifleAmmo;
 	}
@@ -384,7 +372,7 @@ void UInventory::OnRep_RifleAmmo()
 
 void UInventory::OnRep_ShotgunAmmo()
 {
-	if (PrimaryWeapon && Combat && PrimaryWeapon->WeaponData.AmmoType == EAmmoType::EAT_Shotgun)
+	if (PrimaryWeapon && Combat && PrimaryWeapon->GetWeaponData().AmmoType == EAmmoType::EAT_Shotgun)
 	{
 		Combat->CarriedAmmo = CurrentShotgunAmmo;
 	}
@@ -392,7 +380,7 @@ void UInventory::OnRep_ShotgunAmmo()
 
 void UInventory::OnRep_SniperAmmo()
 {
-	if (PrimaryWeapon && Combat && PrimaryWeapon->WeaponData.AmmoType == EAmmoType::EAT_Sniper)
+	if (PrimaryWeapon && Combat && PrimaryWeapon->GetWeaponData().AmmoType == EAmmoType::EAT_Sniper)
 	{
 		Combat->CarriedAmmo = CurrentSniperAmmo;
 	}
@@ -400,7 +388,7 @@ void UInventory::OnRep_SniperAmmo()
 
 void UInventory::OnRep_LauncherAmmo()
 {
-	if (PrimaryWeapon && Combat && PrimaryWeapon->WeaponData.AmmoType == EAmmoType::EAT_Launcher)
+	if (PrimaryWeapon && Combat && PrimaryWeapon->GetWeaponData().AmmoType == EAmmoType::EAT_Launcher)
 	{
 		Combat->CarriedAmmo = CurrentLauncherAmmo;
 	}
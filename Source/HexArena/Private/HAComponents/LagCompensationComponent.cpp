@@ -3,78 +3,113 @@
 
 #include "HAComponents/LagCompensationComponent.h"
 #include "Character/HABaseCharacter.h"
+#include "Subsystems/HARewindSubsystem.h"
 #include "Components/BoxComponent.h"
 #include "DrawDebugHelpers.h"
 #include "Kismet/GameplayStaticsTypes.h"
 #include "Kismet/GameplayStatics.h"
 #include "Weapon/BaseWeapon.h"
+#include "Weapon/HitScanWeapon.h"
+#include "Weapon/ProjectileWeapon.h"
+#include "Weapon/ShotgunWeapon.h"
 #include "../HexArena.h"
 #include "Weapon/HitBoxTypes.h"
+#include "HAComponents/HitBoxTrace.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shotgun Score Requests"), STAT_HARewindShotgunRequests, STATGROUP_HARewind);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shotgun Pellets"), STAT_HARewindShotgunPellets, STATGROUP_HARewind);
+
+static TAutoConsoleVariable<int32> CVarSSRDrawDebug(
+	TEXT("HA.SSR.DrawDebug"),
+	0,
+	TEXT("Draw rewound hit boxes and projectile paths of server side rewind.\n0: off, 1: on"),
+	ECVF_Cheat);
+
+static TAutoConsoleVariable<int32> CVarSSRCompareWithPhysics(
+	TEXT("HA.SSR.CompareWithPhysics"),
+	0,
+	TEXT("Confirm projectile hits with the physics scene as well and log when it disagrees with the analytic trace.\n0: off, 1: on"),
+	ECVF_Cheat);
+
+// Fired shots and pending score requests kept per shooter, a fire stream window of shots with room for the fire rate queue
+static constexpr int32 MaxTrackedShots = 32;
+
+static bool ShouldDrawSSRDebug()
+{
+#if ENABLE_DRAW_DEBUG
+	return CVarSSRDrawDebug.GetValueOnGameThread() != 0;
+#else
+	return false;
+#endif
+}
 
 ULagCompensationComponent::ULagCompensationComponent()
 {
-	PrimaryComponentTick.bCanEverTick = true;
+	// History is captured by UHARewindSubsystem for all characters at once
+	PrimaryComponentTick.bCanEverTick = false;
 }
 
 // Called when the game starts
 void ULagCompensationComponent::BeginPlay()
 {
 	Super::BeginPlay();
-}
 
-void ULagCompensationComponent::SaveFramePackage(FFramePackage& Package)
-{
 	Character = Character == nullptr ? Cast<AHABaseCharacter>(GetOwner()) : Character;
-	if(Character)
+	// History is only needed where score requests are confirmed
+	if (Character == nullptr || !Character->HasAuthority()) return;
+
+	RewindSubsystem = GetWorld()->GetSubsystem<UHARewindSubsystem>();
+	if (RewindSubsystem)
 	{
-		Package.Time = GetWorld()->GetTimeSeconds();
-		for(auto& BoxPair : Character->HitBoxes)
-		{
-			FBoxParams BoxInformation;
-			BoxInformation.Location = BoxPair.Value->GetComponentLocation();
-			BoxInformation.Rotation = BoxPair.Value->GetComponentRotation();
-			BoxInformation.BoxExtent = BoxPair.Value->GetScaledBoxExtent();
-			Package.HitBoxParams.Add(BoxPair.Key, BoxInformation);
-		}
+		HistoryEntry = RewindSubsystem->RegisterCharacter(Character, MaxRecordTime, RecordRate);
 	}
 }
 
-FFramePackage ULagCompensationComponent::InterpBetweenFrames(const FFramePackage& OlderFrame, const FFramePackage& YoungerFrame, float HitTime)
+void ULagCompensationComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	const float Distance = YoungerFrame.Time - OlderFrame.Time;
-	const float InterpFraction = FMath::Clamp((HitTime - OlderFrame.Time) / Distance, 0.f, 1.f);
-
-	FFramePackage InterpFramePackage;
-	InterpFramePackage.Time = HitTime;
-
-	for (auto& YoungerPair : YoungerFrame.HitBoxParams)
+	if (RewindSubsystem)
 	{
-		const FName& BoxParamName = YoungerPair.Key;
-
-		const FBoxParams& OlderBox = OlderFrame.HitBoxParams[BoxParamName];
-		const FBoxParams& YoungerBox = YoungerFrame.HitBoxParams[BoxParamName];
-
-		FBoxParams InterpBoxParams;
+		RewindSubsystem->UnregisterCharacter(HistoryEntry);
+		HistoryEntry = INDEX_NONE;
+	}
 
-		InterpBoxParams.Location = FMath::VInterpTo(OlderBox.Location, YoungerBox.Location, 1.f, InterpFraction);
-		InterpBoxParams.Rotation = FMath::RInterpTo(OlderBox.Rotation, YoungerBox.Rotation, 1.f, InterpFraction);
-		InterpBoxParams.BoxExtent = YoungerBox.BoxExtent;
+	Super::EndPlay(EndPlayReason);
+}
 
-		InterpFramePackage.HitBoxParams.Add(BoxParamName, InterpBoxParams);
+bool ULagCompensationComponent::MakeFramePackage(const FHitBoxHistory& History, int32 Entry, const FRewindFrame& RewindFrame, FFramePackage& OutPackage)
+{
+	const int32 NumBoxes = History.GetNumBoxes();
+	TArray<FVector3f, TInlineAllocator<32>> Locations;
+	TArray<FQuat4f, TInlineAllocator<32>> Rotations;
+	Locations.SetNumUninitialized(NumBoxes);
+	Rotations.SetNumUninitialized(NumBoxes);
+	// Decompresses and interpolates between the stored frames around RewindFrame
+	if (!History.GetPoseAtFrame(Entry, RewindFrame.Frame, RewindFrame.GetAlpha(), Locations.GetData(), Rotations.GetData())) return false;
+
+	const FVector3f* Extents = History.GetExtents(Entry);
+
+	// Server time is no longer part of the rewind, only kept for debugging
+	OutPackage.Time = GetWorld()->GetTimeSeconds();
+	OutPackage.HitBoxParams.SetNum(NumBoxes);
+	for (int32 BoxIndex = 0; BoxIndex < NumBoxes; BoxIndex++)
+	{
+		FBoxParams& BoxParams = OutPackage.HitBoxParams[BoxIndex];
+		BoxParams.Location = FVector(Locations[BoxIndex]);
+		BoxParams.Rotation = FQuat(Rotations[BoxIndex]).Rotator();
+		BoxParams.BoxExtent = FVector(Extents[BoxIndex]);
 	}
-
-	return InterpFramePackage;
+	return true;
 }
 
 void ULagCompensationComponent::ShowFramePackage(const FFramePackage& Package, FColor Color)
 {
-	for (auto& BoxInfo : Package.HitBoxParams)
+	for (const FBoxParams& BoxInfo : Package.HitBoxParams)
 	{
 		DrawDebugBox(
 			GetWorld(),
-			BoxInfo.Value.Location,
-			BoxInfo.Value.BoxExtent,
-			FQuat(BoxInfo.Value.Rotation),
+			BoxInfo.Location,
+			BoxInfo.BoxExtent,
+			FQuat(BoxInfo.Rotation),
 			Color,
 			false,
 			4.f
@@ -82,60 +117,26 @@ void ULagCompensationComponent::ShowFramePackage(const FFramePackage& Package, F
 	}
 }
 
-FFramePackage ULagCompensationComponent::GetFrameToCheck(AHABaseCharacter* HitCharacter, float HitTime)
+FFramePackage ULagCompensationComponent::GetFrameToCheck(AHABaseCharacter* HitCharacter, const FRewindFrame& RewindFrame)
 {
 	bool bReturn =
+		RewindSubsystem == nullptr ||
 		HitCharacter == nullptr ||
 		HitCharacter->GetLagCompensation() == nullptr ||
-		HitCharacter->GetLagCompensation()->FrameHistroy.GetHead() == nullptr ||
-		HitCharacter->GetLagCompensation()->FrameHistroy.GetTail() == nullptr;
+		HitCharacter->GetLagCompensation()->HistoryEntry == INDEX_NONE;
 
 	if (bReturn) return FFramePackage();
 	// Frame package to verify hit
 	FFramePackage FrameToCheck;
-	bool bShouldInterpolate = true;
-	// Frame history of the HitCharacter
-	const TDoubleLinkedList<FFramePackage>& History = HitCharacter->GetLagCompensation()->FrameHistroy;
-	const float OldestHistoryTime = History.GetTail()->GetValue().Time;
-	const float NewestHistoryTime = History.GetHead()->GetValue().Time;
+	// Frame history of all characters, HitCharacter is addressed by its entry
+	const FHitBoxHistory& History = RewindSubsystem->GetHistory();
+	const int32 Entry = HitCharacter->GetLagCompensation()->HistoryEntry;
 
-	if (OldestHistoryTime > HitTime)
+	if (!MakeFramePackage(History, Entry, RewindFrame, FrameToCheck))
 	{
+		// Too far back in time
 		return FFramePackage();
 	}
-	if (OldestHistoryTime == HitTime)
-	{
-		FrameToCheck = History.GetTail()->GetValue();
-		bShouldInterpolate = false;
-	}
-	if (NewestHistoryTime <= HitTime)
-	{
-		FrameToCheck = History.GetHead()->GetValue();
-		bShouldInterpolate = false;
-	}
-
-	TDoubleLinkedList<FFramePackage>::TDoubleLinkedListNode* Younger = History.GetHead();
-	TDoubleLinkedList<FFramePackage>::TDoubleLinkedListNode* Older = Younger;
-
-	while (Older->GetValue().Time > HitTime)
-	{
-		if (Older->GetNextNode() == nullptr) break;
-		Older = Older->GetNextNode();
-
-		if (Older->GetValue().Time > HitTime)
-		{
-			Younger = Older;
-		}
-	}
-	if (Older->GetValue().Time == HitTime)
-	{
-		FrameToCheck = Older->GetValue();
-		bShouldInterpolate = false;
-	}
-	if (bShouldInterpolate)
-	{
-		FrameToCheck = InterpBetweenFrames(Older->GetValue(), Younger->GetValue(), HitTime);
-	}
 
 	FrameToCheck.Character = HitCharacter;
 	return FrameToCheck;
@@ -145,16 +146,16 @@ FFramePackage ULagCompensationComponent::GetFrameToCheck(AHABaseCharacter* HitCh
 void ULagCompensationComponent::CacheBoxPositions(AHABaseCharacter* HitCharacter, FFramePackage& OutFramePackage)
 {
 	if(HitCharacter == nullptr) return;
-	for (auto& HitBoxPair : HitCharacter->HitBoxes)
+	OutFramePackage.HitBoxParams.SetNum(HitCharacter->HitBoxArray.Num());
+	for (int32 BoxIndex = 0; BoxIndex < HitCharacter->HitBoxArray.Num(); BoxIndex++)
 	{
-		if(HitBoxPair.Value !=nullptr)
+		const UHitBoxComponent* HitBox = HitCharacter->HitBoxArray[BoxIndex];
+		if(HitBox != nullptr)
 		{
-			FBoxParams BoxParams;
-			BoxParams.Location = HitBoxPair.Value->GetComponentLocation();
-			BoxParams.Rotation = HitBoxPair.Value->GetComponentRotation();
-			BoxParams.BoxExtent = HitBoxPair.Value->GetScaledBoxExtent();
-			OutFramePackage.HitBoxParams.Add(HitBoxPair.Key, BoxParams);
-
+			FBoxParams& BoxParams = OutFramePackage.HitBoxParams[BoxIndex];
+			BoxParams.Location = HitBox->GetComponentLocation();
+			BoxParams.Rotation = HitBox->GetComponentRotation();
+			BoxParams.BoxExtent = HitBox->GetScaledBoxExtent();
 		}
 	}
 }
@@ -162,30 +163,31 @@ void ULagCompensationComponent::CacheBoxPositions(AHABaseCharacter* HitCharacter
 
 void ULagCompensationComponent::MoveBoxes(AHABaseCharacter* HitCharacter, const FFramePackage& Package)
 {
-	if(HitCharacter == nullptr) return;
-	for (auto& HitBoxPair : HitCharacter->HitBoxes)
+	if(HitCharacter == nullptr || Package.HitBoxParams.Num() != HitCharacter->HitBoxArray.Num()) return;
+	for (int32 BoxIndex = 0; BoxIndex < HitCharacter->HitBoxArray.Num(); BoxIndex++)
 	{
-		if (HitBoxPair.Value != nullptr)
+		UHitBoxComponent* HitBox = HitCharacter->HitBoxArray[BoxIndex];
+		if (HitBox != nullptr)
 		{
-			HitBoxPair.Value->SetWorldLocation(Package.HitBoxParams[HitBoxPair.Key].Location);
-			HitBoxPair.Value->SetWorldRotation(Package.HitBoxParams[HitBoxPair.Key].Rotation);
-			HitBoxPair.Value->SetBoxExtent(Package.HitBoxParams[HitBoxPair.Key].BoxExtent);
-
+			HitBox->SetWorldLocation(Package.HitBoxParams[BoxIndex].Location);
+			HitBox->SetWorldRotation(Package.HitBoxParams[BoxIndex].Rotation);
+			HitBox->SetBoxExtent(Package.HitBoxParams[BoxIndex].BoxExtent);
 		}
 	}
 }
 
 void ULagCompensationComponent::ResetHitBoxes(AHABaseCharacter* HitCharacter, const FFramePackage& Package)
 {
-	if (HitCharacter == nullptr) return;
-	for (auto& HitBoxPair : HitCharacter->HitBoxes)
+	if (HitCharacter == nullptr || Package.HitBoxParams.Num() != HitCharacter->HitBoxArray.Num()) return;
+	for (int32 BoxIndex = 0; BoxIndex < HitCharacter->HitBoxArray.Num(); BoxIndex++)
 	{
-		if (HitBoxPair.Value != nullptr)
+		UHitBoxComponent* HitBox = HitCharacter->HitBoxArray[BoxIndex];
+		if (HitBox != nullptr)
 		{
-			HitBoxPair.Value->SetWorldLocation(Package.HitBoxParams[HitBoxPair.Key].Location);
-			HitBoxPair.Value->SetWorldRotation(Package.HitBoxParams[HitBoxPair.Key].Rotation);
-			HitBoxPair.Value->SetBoxExtent(Package.HitBoxParams[HitBoxPair.Key].BoxExtent);
-			HitBoxPair.Value->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+			HitBox->SetWorldLocation(Package.HitBoxParams[BoxIndex].Location);
+			HitBox->SetWorldRotation(Package.HitBoxParams[BoxIndex].Rotation);
+			HitBox->SetBoxExtent(Package.HitBoxParams[BoxIndex].BoxExtent);
+			HitBox->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 		}
 	}
 }
@@ -198,13 +200,81 @@ void ULagCompensationComponent::EnableCharacterMeshCollision(AHABaseCharacter* H
 	}
 }
 
-bool ULagCompensationComponent::CheckIfBoxHitted(AHABaseCharacter* HitCharacter, FPredictProjectilePathParams& PathParams, FPredictProjectilePathResult& PathResult, FName BoxName)
+FServerSideRewindResult ULagCompensationComponent::ProjectileConfirmHitAnalytic(AHABaseCharacter* HitCharacter, const FVector_NetQuantize& TraceStart, const FVector_NetQuantize100& Initialvelocity, const FRewindFrame& RewindFrame)
 {
-	return false;
+	FServerSideRewindResult SSRResult;
+	SSRResult.bHitConfirmed = false;
+	SSRResult.HittedBox = EHitBoxType::EBHT_NoHit;
+
+	bool bReturn =
+		RewindSubsystem == nullptr ||
+		HitCharacter == nullptr ||
+		HitCharacter->GetLagCompensation() == nullptr ||
+		HitCharacter->GetLagCompensation()->HistoryEntry == INDEX_NONE;
+
+	if (bReturn) return SSRResult;
+
+	const FHitBoxHistory& History = RewindSubsystem->GetHistory();
+	const int32 Entry = HitCharacter->GetLagCompensation()->HistoryEntry;
+
+	const int32 NumBoxes = History.GetNumBoxes();
+	TArray<FVector3f, TInlineAllocator<32>> Locations;
+	TArray<FQuat4f, TInlineAllocator<32>> Rotations;
+	Locations.SetNumUninitialized(NumBoxes);
+	Rotations.SetNumUninitialized(NumBoxes);
+	if (!History.GetPoseAtFrame(Entry, RewindFrame.Frame, RewindFrame.GetAlpha(), Locations.GetData(), Rotations.GetData())) return SSRResult;
+
+	FHitBoxTracePose Pose;
+	Pose.Locations = Locations.GetData();
+	Pose.Rotations = Rotations.GetData();
+	Pose.Extents = History.GetExtents(Entry);
+	Pose.NumBoxes = NumBoxes;
+
+	FHitBoxTraceParams TraceParams;
+	TraceParams.Start = FVector3f(TraceStart);
+	TraceParams.Velocity = FVector3f(Initialvelocity);
+	TraceParams.GravityZ = GetWorld()->GetGravityZ();
+	TraceParams.Radius = PathProjectileRadius;
+	TraceParams.SimFrequency = PathSimFrequency;
+	TraceParams.MaxSimTime = MaxRecordTime;
+
+	// Head box is checked alone first, it wins even if the arc crosses another box before it
+	FHitBoxTraceResult TraceResult;
+	const bool bHit =
+		FHitBoxTrace::TraceBallistic(TraceParams, Pose, 0, 1, TraceResult) ||
+		FHitBoxTrace::TraceBallistic(TraceParams, Pose, 0, NumBoxes, TraceResult);
+
+	if (bHit && HitCharacter->HitBoxArray.IsValidIndex(TraceResult.BoxIndex) && HitCharacter->HitBoxArray[TraceResult.BoxIndex])
+	{
+		SSRResult.bHitConfirmed = true;
+		SSRResult.HittedBox = HitCharacter->HitBoxArray[TraceResult.BoxIndex]->HitBoxType;
+	}
+
+#if ENABLE_DRAW_DEBUG
+	if (ShouldDrawSSRDebug())
+	{
+		for (int32 BoxIndex = 0; BoxIndex < NumBoxes; BoxIndex++)
+		{
+			const FColor Color = bHit && BoxIndex == TraceResult.BoxIndex ? FColor::Red : FColor::Green;
+			DrawDebugBox(GetWorld(), FVector(Locations[BoxIndex]), FVector(Pose.Extents[BoxIndex]), FQuat(Rotations[BoxIndex]), Color, false, 4.f);
+		}
+		if (bHit)
+		{
+			DrawDebugSphere(GetWorld(), FVector(TraceResult.Location), PathProjectileRadius, 8, FColor::Red, false, 4.f);
+		}
+	}
+#endif
+
+	return SSRResult;
 }
 
-FServerSideRewindResult ULagCompensationComponent::ProjectileConfirmHit(const FFramePackage& Package, AHABaseCharacter* HitCharacter, const FVector_NetQuantize& TraceStart, const FVector_NetQuantize100& Initialvelocity, float HitTime)
+FServerSideRewindResult ULagCompensationComponent::ProjectileConfirmHit(const FFramePackage& Package, AHABaseCharacter* HitCharacter, const FVector_NetQuantize& TraceStart, const FVector_NetQuantize100& Initialvelocity, const FRewindFrame& RewindFrame)
 {
+	FServerSideRewindResult SSRResult;
+	SSRResult.bHitConfirmed = false;
+	SSRResult.HittedBox = EHitBoxType::EBHT_NoHit;
+	if (HitCharacter == nullptr || Package.HitBoxParams.Num() == 0) return SSRResult;
+
 	FFramePackage CurrentFrame;
 	CacheBoxPositions(HitCharacter, CurrentFrame);
 	MoveBoxes(HitCharacter, Package);
@@ -219,18 +289,16 @@ FServerSideRewindResult ULagCompensationComponent::ProjectileConfirmHit(const FF
 	PathParams.MaxSimTime = MaxRecordTime;
 	PathParams.LaunchVelocity = Initialvelocity;
 	PathParams.StartLocation = TraceStart;
-	PathParams.SimFrequency = 15.f;
-	PathParams.ProjectileRadius = 5.f;
+	PathParams.SimFrequency = PathSimFrequency;
+	PathParams.ProjectileRadius = PathProjectileRadius;
 	PathParams.TraceChannel = ECC_HitBox;
 	PathParams.ActorsToIgnore.Add(GetOwner());
 	PathParams.DrawDebugTime = 5.f;
-	PathParams.DrawDebugType = EDrawDebugTrace::ForDuration;
+	PathParams.DrawDebugType = ShouldDrawSSRDebug() ? EDrawDebugTrace::ForDuration : EDrawDebugTrace::None;
 
 	FPredictProjectilePathResult PathResult;
 	UGameplayStatics::PredictProjectilePath(this, PathParams, PathResult);
 
-	FServerSideRewindResult SSRResult;
-
 	if (PathResult.HitResult.bBlockingHit) // Check hit box
 	{
 		if (PathResult.HitResult.Component.IsValid())
@@ -238,7 +306,10 @@ FServerSideRewindResult ULagCompensationComponent::ProjectileConfirmHit(const FF
 			UHitBoxComponent* Box = Cast<UHitBoxComponent>(PathResult.HitResult.Component);
 			if (Box)
 			{
-				DrawDebugBox(GetWorld(), Box->GetComponentLocation(), Box->GetScaledBoxExtent(), FQuat(Box->GetComponentRotation()), FColor::Red, false, 8.f);
+				if (ShouldDrawSSRDebug())
+				{
+					DrawDebugBox(GetWorld(), Box->GetComponentLocation(), Box->GetScaledBoxExtent(), FQuat(Box->GetComponentRotation()), FColor::Red, false, 8.f);
+				}
 				SSRResult.bHitConfirmed = true;
 				SSRResult.HittedBox = Box->HitBoxType;
 			}
@@ -269,7 +340,10 @@ FServerSideRewindResult ULagCompensationComponent::ProjectileConfirmHit(const FF
 				UHitBoxComponent* Box = Cast<UHitBoxComponent>(PathResult.HitResult.Component);
 				if (Box)
 				{
-					DrawDebugBox(GetWorld(), Box->GetComponentLocation(), Box->GetScaledBoxExtent(), FQuat(Box->GetComponentRotation()), FColor::Blue, false, 8.f);
+					if (ShouldDrawSSRDebug())
+					{
+						DrawDebugBox(GetWorld(), Box->GetComponentLocation(), Box->GetScaledBoxExtent(), FQuat(Box->GetComponentRotation()), FColor::Blue, false, 8.f);
+					}
 					SSRResult.bHitConfirmed = true;
 					SSRResult.HittedBox = Box->HitBoxType;
 				}
@@ -287,84 +361,225 @@ FServerSideRewindResult ULagCompensationComponent::ProjectileConfirmHit(const FF
 	return SSRResult;
 }
 
-void ULagCompensationComponent::ProjectileServerScoreRequest_Implementation(AHABaseCharacter* HitCharacter, const FVector_NetQuantize& TraceStart, const FVector_NetQuantize100& Initialvelocity, float HitTime)
+void ULagCompensationComponent::ProjectileServerScoreRequest_Implementation(AHABaseCharacter* HitCharacter, const FVector_NetQuantize& TraceStart, const FVector_NetQuantize100& Initialvelocity, const FRewindFrame& RewindFrame)
+{
+	if (RewindSubsystem == nullptr || Character == nullptr || HitCharacter == nullptr || HitCharacter->GetLagCompensation() == nullptr) return;
+
+	// Only weapons that fire projectiles on the server may report projectile hits
+	AProjectileWeapon* Weapon = Cast<AProjectileWeapon>(Character->GetEquippedWeapon());
+	if (Weapon == nullptr) return;
+
+	// Physics comparison moves hit boxes in the scene, only possible right here on the game thread
+	if (CVarSSRCompareWithPhysics.GetValueOnGameThread() != 0)
+	{
+		FServerSideRewindResult Confirm = ProjectileServerSideRewind(HitCharacter, TraceStart, Initialvelocity, RewindFrame);
+		if (Confirm.bHitConfirmed)
+		{
+			UGameplayStatics::ApplyDamage(
+				HitCharacter,
+				GetHitBoxDamage(Weapon->GetWeaponData(), Confirm.HittedBox),
+				Character->Controller,
+				Weapon,
+				UDamageType::StaticClass()
+			);
+		}
+		return;
+	}
+
+	FScoreRequest Request;
+	Request.Type = EScoreRequestType::Projectile;
+	Request.Shooter = Character;
+	Request.Weapon = Weapon;
+	Request.HitCharacters.Add(HitCharacter);
+	Request.Entries.Add(HitCharacter->GetLagCompensation()->GetHistoryEntry());
+	Request.RewindFrames.Add(RewindFrame);
+	Request.TraceStart = TraceStart;
+
+	Request.ProjectileParams.Start = FVector3f(TraceStart);
+	Request.ProjectileParams.Velocity = FVector3f(Initialvelocity);
+	Request.ProjectileParams.GravityZ = GetWorld()->GetGravityZ();
+	Request.ProjectileParams.Radius = PathProjectileRadius;
+	Request.ProjectileParams.SimFrequency = PathSimFrequency;
+	Request.ProjectileParams.MaxSimTime = MaxRecordTime;
+
+	RewindSubsystem->QueueScoreRequest(MoveTemp(Request));
+}
+
+void ULagCompensationComponent::HitScanServerScoreRequest_Implementation(AHABaseCharacter* HitCharacter, const FRewindFrame& RewindFrame, int32 ShotSequence)
+{
+	if (HitCharacter == nullptr) return;
+
+	FShotScoreRequest Request;
+	Request.ShotSequence = ShotSequence;
+	Request.HitCharacters.Add(HitCharacter);
+	Request.RewindFrames.Add(RewindFrame);
+	ReceiveScoreRequest(MoveTemp(Request));
+}
+
+void ULagCompensationComponent::ShotgunServerScoreRequest_Implementation(const TArray<AHABaseCharacter*>& HitCharacters, const TArray<FRewindFrame>& RewindFrames, int32 ShotSequence, uint8 NumPellets)
 {
-	FServerSideRewindResult Confirm = ProjectileServerSideRewind(HitCharacter, TraceStart, Initialvelocity, HitTime);
+	if (RewindFrames.Num() != HitCharacters.Num() || HitCharacters.Num() == 0 || HitCharacters.Num() > NumPellets) return;
 
-	if(Character && HitCharacter && Confirm.bHitConfirmed && Character->GetEquippedWeapon())
+	FShotScoreRequest Request;
+	Request.ShotSequence = ShotSequence;
+	Request.NumPellets = NumPellets;
+	for (int32 VictimIndex = 0; VictimIndex < HitCharacters.Num(); VictimIndex++)
 	{
+		Request.HitCharacters.Add(HitCharacters[VictimIndex]);
+		Request.RewindFrames.Add(RewindFrames[VictimIndex]);
+	}
+	ReceiveScoreRequest(MoveTemp(Request));
+}
 
-		float DamageToCause = 0.f;
+void ULagCompensationComponent::ShotFired(int32 ShotSequence, ABaseWeapon* Weapon, const FVector& TraceStart, const FVector& ShotTarget, int32 Seed)
+{
+	LastFiredSequence = ShotSequence;
+	if (FiredShots.Num() >= MaxTrackedShots)
+	{
+		FiredShots.RemoveAt(0, 1, false);
+	}
 
-		FWeaponData EquippedWeaponData = Character->GetEquippedWeapon()->WeaponData;
+	FFiredShot& Shot = FiredShots.AddDefaulted_GetRef();
+	Shot.ShotSequence = ShotSequence;
+	Shot.Weapon = Weapon;
+	Shot.TraceStart = TraceStart;
+	Shot.ShotTarget = ShotTarget;
+	Shot.Seed = Seed;
 
-		switch (Confirm.HittedBox)
+	// Shots are fired in sequence order, requests for older ones belong to shots the server rejected or never got
+	for (int32 Index = 0; Index < PendingScoreRequests.Num();)
+	{
+		const FShotScoreRequest& Request = PendingScoreRequests[Index];
+		if (Request.ShotSequence > ShotSequence)
 		{
-		case EHitBoxType::EHBT_Head:
-			DamageToCause = EquippedWeaponData.BaseDamage * EquippedWeaponData.HeadMultiplyer;
-			break;
-
-		case EHitBoxType::EHBT_Neck:
-			DamageToCause = EquippedWeaponData.BaseDamage * EquippedWeaponData.NeckMultiplyer;
-			break;
-	
-		case EHitBoxType::EHBT_Chest:
-			DamageToCause = EquippedWeaponData.BaseDamage * EquippedWeaponData.ChestMultiplyer;
-			break;
-
-		case EHitBoxType::EHBT_Stomach:
-			DamageToCause = EquippedWeaponData.BaseDamage * EquippedWeaponData.StomachMultiplyer;
-			break;
-
-		case EHitBoxType::EHBT_Limbs:
-			DamageToCause = EquippedWeaponData.BaseDamage * EquippedWeaponData.LimbsMultiplyer;
-			break;
+			Index++;
+			continue;
 		}
 
-		UE_LOG(LogTemp, Warning, TEXT("Applying damage with SSR on PSSR: %s to %s"), *this->GetName(), *HitCharacter->GetName());
-
-		UGameplayStatics::ApplyDamage(
-			HitCharacter,
-			DamageToCause,
-			Character->Controller,
-			Character->GetEquippedWeapon(),
-			UDamageType::StaticClass()
-		);
+		if (Request.ShotSequence == ShotSequence)
+		{
+			Shot.bScored = true;
+			QueueShotScoreRequest(Request, Shot);
+		}
+		PendingScoreRequests.RemoveAt(Index, 1, false);
 	}
 }
 
-FServerSideRewindResult ULagCompensationComponent::ProjectileServerSideRewind(AHABaseCharacter* HitCharacter, const FVector_NetQuantize& TraceStart, const FVector_NetQuantize100& InitialVelocity, float HitTime)
+void ULagCompensationComponent::ReceiveScoreRequest(FShotScoreRequest&& Request)
 {
-	FFramePackage FrameToCheck = GetFrameToCheck(HitCharacter, HitTime);
-	return ProjectileConfirmHit(FrameToCheck, HitCharacter, TraceStart, InitialVelocity, HitTime);
+	if (RewindSubsystem == nullptr || Character == nullptr) return;
+
+	if (Request.ShotSequence <= LastFiredSequence)
+	{
+		// One request per fired shot, the client's muzzle and aim are never trusted
+		FFiredShot* Shot = FiredShots.FindByPredicate([&Request](const FFiredShot& FiredShot) { return FiredShot.ShotSequence == Request.ShotSequence; });
+		if (Shot && !Shot->bScored)
+		{
+			Shot->bScored = true;
+			QueueShotScoreRequest(Request, *Shot);
+		}
+		return;
+	}
+
+	// The fire stream of the shot is still on its way or queued behind the fire rate
+	const int32 ShotSequence = Request.ShotSequence;
+	if (PendingScoreRequests.ContainsByPredicate([ShotSequence](const FShotScoreRequest& Pending) { return Pending.ShotSequence == ShotSequence; })) return;
+
+	// Requests arrive in sequence order, after a long loss the oldest ones belong to shots the client gave up on
+	if (PendingScoreRequests.Num() >= MaxTrackedShots)
+	{
+		PendingScoreRequests.RemoveAt(0, 1, false);
+	}
+	PendingScoreRequests.Add(MoveTemp(Request));
 }
 
-// Called every frame
-void ULagCompensationComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+void ULagCompensationComponent::QueueShotScoreRequest(const FShotScoreRequest& Request, const FFiredShot& Shot)
 {
-	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	ABaseWeapon* Weapon = Shot.Weapon.Get();
+	if (RewindSubsystem == nullptr || Character == nullptr || Weapon == nullptr) return;
+
+	FScoreRequest ScoreRequest;
+	ScoreRequest.Shooter = Character;
+	ScoreRequest.Weapon = Weapon;
+	ScoreRequest.TraceStart = Shot.TraceStart;
+
+	if (AShotgunWeapon* Shotgun = Cast<AShotgunWeapon>(Weapon))
+	{
+		// Pellets are rebuilt with the server's own weapon from the shot it fired
+		if (Request.NumPellets != Shotgun->GetNumberOfPellets()) return;
 
-	if(FrameHistroy.Num() <= 1)
+		INC_DWORD_STAT(STAT_HARewindShotgunRequests);
+		ScoreRequest.Type = EScoreRequestType::Shotgun;
+		Shotgun->GetPelletTraceEnds(Shot.TraceStart, Shot.ShotTarget, Shot.Seed, Request.NumPellets, ScoreRequest.TraceEnds);
+		INC_DWORD_STAT_BY(STAT_HARewindShotgunPellets, ScoreRequest.TraceEnds.Num());
+	}
+	else if (Weapon->IsA<AHitScanWeapon>() && Request.NumPellets == 0 && Request.HitCharacters.Num() == 1)
 	{
-		FFramePackage ThisFrame;
-		SaveFramePackage(ThisFrame);
-		FrameHistroy.AddHead(ThisFrame);
+		ScoreRequest.Type = EScoreRequestType::HitScan;
+		ScoreRequest.TraceEnds.Add(Shot.ShotTarget);
 	}
 	else
 	{
-		float HistoryLenght = FrameHistroy.GetHead()->GetValue().Time - FrameHistroy.GetTail()->GetValue().Time;
+		// Only weapons that fire hitscan on the server may report hitscan hits, shotguns report whole blasts
+		return;
+	}
 
-		while (HistoryLenght>MaxRecordTime)
-		{
-			FrameHistroy.RemoveNode(FrameHistroy.GetTail());
-			HistoryLenght = FrameHistroy.GetHead()->GetValue().Time - FrameHistroy.GetTail()->GetValue().Time;
-		}
-		FFramePackage ThisFrame;
-		SaveFramePackage(ThisFrame);
-		FrameHistroy.AddHead(ThisFrame);
-		//ShowFramePackage(ThisFrame, FColor::Green);
+	for (int32 VictimIndex = 0; VictimIndex < Request.HitCharacters.Num(); VictimIndex++)
+	{
+		AHABaseCharacter* HitCharacter = Request.HitCharacters[VictimIndex].Get();
+		if (HitCharacter == nullptr || HitCharacter->GetLagCompensation() == nullptr) continue;
+
+		ScoreRequest.HitCharacters.Add(HitCharacter);
+		ScoreRequest.Entries.Add(HitCharacter->GetLagCompensation()->GetHistoryEntry());
+		ScoreRequest.RewindFrames.Add(Request.RewindFrames[VictimIndex]);
+	}
+	if (ScoreRequest.HitCharacters.Num() == 0) return;
+
+	// Pellets are confirmed against every victim at once, each pellet stops at the nearest one
+	RewindSubsystem->QueueScoreRequest(MoveTemp(ScoreRequest));
+}
+
+float ULagCompensationComponent::GetHitBoxDamage(const FWeaponData& WeaponData, EHitBoxType HitBoxType)
+{
+	switch (HitBoxType)
+	{
+	case EHitBoxType::EHBT_Head:
+		return WeaponData.BaseDamage * WeaponData.HeadMultiplyer;
+
+	case EHitBoxType::EHBT_Neck:
+		return WeaponData.BaseDamage * WeaponData.NeckMultiplyer;
+
+	case EHitBoxType::EHBT_Chest:
+		return WeaponData.BaseDamage * WeaponData.ChestMultiplyer;
+
+	case EHitBoxType::EHBT_Stomach:
+		return WeaponData.BaseDamage * WeaponData.StomachMultiplyer;
+
+	case EHitBoxType::EHBT_Limbs:
+		return WeaponData.BaseDamage * WeaponData.LimbsMultiplyer;
 	}
+	return 0.f;
 }
 
+FServerSideRewindResult ULagCompensationComponent::ProjectileServerSideRewind(AHABaseCharacter* HitCharacter, const FVector_NetQuantize& TraceStart, const FVector_NetQuantize100& InitialVelocity, const FRewindFrame& RewindFrame)
+{
+	FServerSideRewindResult Confirm = ProjectileConfirmHitAnalytic(HitCharacter, TraceStart, InitialVelocity, RewindFrame);
+
+	if (CVarSSRCompareWithPhysics.GetValueOnGameThread() != 0)
+	{
+		FFramePackage FrameToCheck = GetFrameToCheck(HitCharacter, RewindFrame);
+		FServerSideRewindResult PhysicsConfirm = ProjectileConfirmHit(FrameToCheck, HitCharacter, TraceStart, InitialVelocity, RewindFrame);
 
+		if (PhysicsConfirm.bHitConfirmed != Confirm.bHitConfirmed || PhysicsConfirm.HittedBox != Confirm.HittedBox)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("SSR mismatch on %s at frame %d + %f: analytic %s, physics %s"),
+				HitCharacter ? *HitCharacter->GetName() : TEXT("None"),
+				RewindFrame.Frame,
+				RewindFrame.GetAlpha(),
+				*UEnum::GetValueAsString(Confirm.HittedBox),
+				*UEnum::GetValueAsString(PhysicsConfirm.HittedBox));
+		}
+	}
 
+	return Confirm;
+}
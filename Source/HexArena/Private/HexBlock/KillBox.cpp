@@ -6,6 +6,8 @@
 #include <Character/HABaseCharacter.h>
 #include "Kismet/GameplayStatics.h"
 #include "Pickups/BasePickup.h"
+#include "Pickups/WeaponPickup.h"
+#include "Weapon/BaseWeapon.h"
 #include <Engine/EngineTypes.h>
 
 AKillBox::AKillBox()
@@ -33,6 +35,17 @@ void AKillBox::OnKillBoxOverlap(UPrimitiveComponent* OverlappedComponent, AActor
 		return;
 	}
 
+	// The weapon hands its pickup back to the pool when it ends play
+	AWeaponPickup* WeaponPickup = Cast<AWeaponPickup>(OtherActor);
+	if (WeaponPickup)
+	{
+		if (WeaponPickup->GetWeapon())
+		{
+			WeaponPickup->GetWeapon()->Destroy(true);
+		}
+		return;
+	}
+
 	ABasePickup* Pickup = Cast<ABasePickup>(OtherActor);
 	if(Pickup)
 	{
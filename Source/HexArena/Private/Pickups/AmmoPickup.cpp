@@ -5,6 +5,8 @@
 #include "Components/SphereComponent.h"
 #include "Components/WidgetComponent.h"
 #include "Pickups/BasePickup.h"
+#include "Subsystems/HADataRegistry.h"
+#include "Net/UnrealNetwork.h"
 #include "../HexArena.h"
 
 AAmmoPickup::AAmmoPickup()
@@ -25,37 +27,75 @@ AAmmoPickup::AAmmoPickup()
 	bAutoPickup = true;
 
 	PickupType = EPickupTypes::EPT_Ammo;
+}
 
-	static ConstructorHelpers::FObjectFinder<UDataTable> LootDTObject(TEXT("DataTable'/Game/Blueprints/Pickups/DT_AmmoPickups.DT_AmmoPickups'"));
-	if (LootDTObject.Succeeded())
-	{
-		AmmoTable = LootDTObject.Object;
-	}
+void AAmmoPickup::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AAmmoPickup, AmmoPickupId);
 }
 
 void AAmmoPickup::BeginPlay()
 {
 	Super::BeginPlay();
-	SetAmmoDataByName(AmmoName);
+
+	// Clients apply the id when it replicates
+	if (HasAuthority())
+	{
+		// Level placed pickups are authored by name, loot boxes set the id before spawning finishes
+		if (AmmoPickupId == MAX_uint8)
+		{
+			SetAmmoDataByName(AmmoName);
+		}
+		ApplyAmmoPickupId();
+	}
 }
 
 void AAmmoPickup::SetAmmoDataByName(FName NewName)
 {
-	if (HasAuthority())
+	if (const UHADataRegistry* Registry = UHADataRegistry::Get(this))
 	{
-		MulticastSetAmmoDataByName(NewName);
+		SetAmmoPickupId(Registry->FindAmmoPickupId(NewName));
 	}
 }
 
-void AAmmoPickup::MulticastSetAmmoDataByName_Implementation(FName NewName)
+void AAmmoPickup::SetAmmoPickupId(int32 NewAmmoPickupId)
 {
-	AmmoName = NewName;
-	if (AmmoTable)
+	if (!HasAuthority()) return;
+
+	const UHADataRegistry* Registry = UHADataRegistry::Get(this);
+	if (Registry == nullptr || !Registry->IsValidAmmoPickupId(NewAmmoPickupId) || NewAmmoPickupId >= MAX_uint8)
 	{
-		AmmoPickupData = *AmmoTable->FindRow<FAmmoPickupData>(AmmoName, "");
+		UE_LOG(LogTemp, Warning, TEXT("%s has no ammo pickup data with id %d"), *GetName(), NewAmmoPickupId);
+		return;
 	}
 
-	StaticMeshComponent->SetStaticMesh(AmmoPickupData.Mesh);
+	AmmoPickupId = static_cast<uint8>(NewAmmoPickupId);
+	if (HasActorBegunPlay())
+	{
+		ApplyAmmoPickupId();
+	}
+}
+
+void AAmmoPickup::OnRep_AmmoPickupId()
+{
+	ApplyAmmoPickupId();
+}
+
+void AAmmoPickup::ApplyAmmoPickupId()
+{
+	const UHADataRegistry* Registry = UHADataRegistry::Get(this);
+	if (Registry == nullptr || !Registry->IsValidAmmoPickupId(AmmoPickupId)) return;
+
+	AmmoName = Registry->GetAmmoPickupName(AmmoPickupId);
+	AmmoPickupData = Registry->GetAmmoPickup(AmmoPickupId);
+	AmmoPickupAssetsHandle = Registry->LoadAmmoPickupAssets(AmmoPickupId, this, FStreamableDelegate::CreateUObject(this, &AAmmoPickup::OnAmmoPickupAssetsLoaded));
+}
+
+void AAmmoPickup::OnAmmoPickupAssetsLoaded()
+{
+	StaticMeshComponent->SetStaticMesh(AmmoPickupData.Mesh.Get());
 }
 
 
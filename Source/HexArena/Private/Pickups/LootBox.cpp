@@ -7,6 +7,8 @@
 #include "../HexArena.h"
 #include "Weapon/BaseWeapon.h"
 #include "Pickups/AmmoPickup.h"
+#include "Pickups/WeaponPickup.h"
+#include "Subsystems/HADataRegistry.h"
 
 ALootBox::ALootBox()
 {
@@ -29,12 +31,6 @@ ALootBox::ALootBox()
 	PickupWidget->SetupAttachment(LootBoxComponent);
 
 	PickupWidget->SetVisibility(false);
-
-	static ConstructorHelpers::FObjectFinder<UDataTable> LootDTObject(TEXT("DataTable'/Game/Blueprints/Pickups/DT_Loot.DT_Loot'"));
-	if (LootDTObject.Succeeded())
-	{
-		LootTable = LootDTObject.Object;
-	}
 }
 
 void ALootBox::BeginPlay()
@@ -94,18 +90,12 @@ void ALootBox::GenerateLoot()
 	LootBoxComponent->MarkRenderStateDirty();
 	EnableCustomDepth(true);
 
-	if(LootTable)
+	const UHADataRegistry* Registry = UHADataRegistry::Get(this);
+	if(Registry && Registry->GetNumLoot() > 0)
 	{
-		TArray<FName> RowNames = LootTable->GetRowNames();
 		for (int32 Pickups = 0; Pickups < MaxLootCount; Pickups++)
 		{
-			int32 RandomNameIndex = FMath::RandRange(0, RowNames.Num()-1);
-			FLootData* TempLootRow = LootTable->FindRow<FLootData>(RowNames[RandomNameIndex], "");
-
-			if (TempLootRow)
-			{
-				Loot.Add(TempLootRow);
-			}
+			Loot.Add(FMath::RandRange(0, Registry->GetNumLoot() - 1));
 		}
 	}
 
@@ -123,21 +113,29 @@ void ALootBox::CreateLootItems()
 {
 	
 	UWorld* World = GetWorld();
-	if(!World) return; 
+	const UHADataRegistry* Registry = UHADataRegistry::Get(this);
+	if(!World || !Registry) return; 
 
 	for(int32 I = 0; I<Loot.Num(); I++)
 	{
-		if(Loot[I]->PickupType == EPickupTypes::EPT_Weapon)
+		const FLootData& LootData = Registry->GetLoot(Loot[I]);
+		const int32 PickupId = Registry->GetLootPickupId(Loot[I]);
+		if (PickupId == INDEX_NONE) continue;
+
+		if(LootData.PickupType == EPickupTypes::EPT_Weapon)
 		{
-			ABaseWeapon* BaseWeapon = World->SpawnActorDeferred<ABaseWeapon>(Loot[I]->LootClass, this->GetTransform());
-			BaseWeapon->SetWeaponDataByName(Loot[I]->LootName);
+			ABaseWeapon* BaseWeapon = World->SpawnActorDeferred<ABaseWeapon>(LootData.LootClass, this->GetTransform());
+			BaseWeapon->SetWeaponId(PickupId);
 			BaseWeapon->FinishSpawning(this->GetTransform());
-			BaseWeapon->AddImpulse(FVector((50.f - I * 50.f), 100, 200), NAME_None, true);
+			if (AWeaponPickup* WeaponPickup = BaseWeapon->GetPickup())
+			{
+				WeaponPickup->AddImpulse(FVector((50.f - I * 50.f), 100, 200), NAME_None, true);
+			}
 		}
-		else if(Loot[I]->PickupType == EPickupTypes::EPT_Ammo)
+		else if(LootData.PickupType == EPickupTypes::EPT_Ammo)
 		{
-			AAmmoPickup* AmmoPickup = World->SpawnActorDeferred<AAmmoPickup>(Loot[I]->LootClass, this->GetTransform());
-			AmmoPickup->SetAmmoDataByName(Loot[I]->LootName);
+			AAmmoPickup* AmmoPickup = World->SpawnActorDeferred<AAmmoPickup>(LootData.LootClass, this->GetTransform());
+			AmmoPickup->SetAmmoPickupId(PickupId);
 			AmmoPickup->FinishSpawning(this->GetTransform());
 			AmmoPickup->AddImpulse(FVector((50.f - I * 50.f), 100, 150), NAME_None, true);
 		}
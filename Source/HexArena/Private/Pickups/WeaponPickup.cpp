@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Pickups/WeaponPickup.h"
+#include "Components/SphereComponent.h"
+#include "Weapon/BaseWeapon.h"
+#include "Net/UnrealNetwork.h"
+
+AWeaponPickup::AWeaponPickup()
+{
+	bReplicates = true;
+	SetReplicatingMovement(true);
+
+	PickupType = EPickupTypes::EPT_Weapon;
+}
+
+void AWeaponPickup::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AWeaponPickup, Weapon);
+}
+
+void AWeaponPickup::BeginPlay()
+{
+	Super::BeginPlay();
+
+	SetPickupActive(Weapon != nullptr);
+}
+
+void AWeaponPickup::ActivateFromPool(ABaseWeapon* NewWeapon)
+{
+	if (NewWeapon == nullptr) return;
+
+	// Channels of pooled pickups are closed, the first update reopens them
+	SetNetDormancy(DORM_Awake);
+
+	Weapon = NewWeapon;
+	SetActorTransform(Weapon->GetActorTransform(), false, nullptr, ETeleportType::ResetPhysics);
+	SetPickupActive(true);
+	AttachWeapon();
+}
+
+void AWeaponPickup::DeactivateToPool()
+{
+	// The weapon is attached to its new owner by now
+	Weapon = nullptr;
+	SetPickupActive(false);
+
+	SetNetDormancy(DORM_DormantAll);
+}
+
+void AWeaponPickup::OnRep_Weapon()
+{
+	SetPickupActive(Weapon != nullptr);
+	AttachWeapon();
+}
+
+void AWeaponPickup::SetPickupActive(bool bActive)
+{
+	SetActorHiddenInGame(!bActive);
+
+	PhysicsMeshComponent->SetCollisionEnabled(bActive ? ECollisionEnabled::PhysicsOnly : ECollisionEnabled::NoCollision);
+	PhysicsMeshComponent->SetSimulatePhysics(bActive);
+	PhysicsMeshComponent->SetEnableGravity(bActive);
+
+	AreaSphere->SetCollisionEnabled(bActive ? ECollisionEnabled::QueryAndPhysics : ECollisionEnabled::NoCollision);
+	if (!bActive)
+	{
+		ShowPickupWidget(false);
+	}
+}
+
+void AWeaponPickup::AttachWeapon()
+{
+	// Replication may bring the pickup after the weapon was picked up again
+	if (Weapon == nullptr || Weapon->GetOwner() != nullptr) return;
+
+	Weapon->AttachToComponent(PhysicsMeshComponent, FAttachmentTransformRules::SnapToTargetNotIncludingScale);
+}
@@ -561,6 +561,13 @@ void AHAPlayerController::ClientReportServerTime_Implementation(float TimeOfClie
 	ClientServerDeltaTime = CurrentServerTime - GetWorld()->GetTimeSeconds();
 }
 
+void AHAPlayerController::ClientFireEvent_Implementation(AHABaseCharacter* Shooter, const FFireEvent& FireEvent)
+{
+	// Null when the shooter's channel closed while the event was in flight
+	if (Shooter == nullptr || Shooter->IsLocallyControlled() || Shooter->GetCombat() == nullptr) return;
+	Shooter->GetCombat()->SimulatedFire(FireEvent);
+}
+
 void AHAPlayerController::SetNumericValueInTextBlock(float Value, UTextBlock* TextBlock)
 {
 	HAHUD = HAHUD == nullptr ? Cast<AHAHUD>(GetHUD()) : HAHUD;
@@ -20,6 +20,7 @@ void AHaPlayerState::AddToScore(float ScoreAmount)
 {
 	Kills += ScoreAmount;
 	SetScore(Kills);
+#if WITH_COSMETICS
 	Character = Character == nullptr ? Cast<AHABaseCharacter>(GetPawn()) : Character;
 	if (Character)
 	{
@@ -29,6 +30,7 @@ void AHaPlayerState::AddToScore(float ScoreAmount)
 			Controller->SetHUDKills(GetScore());
 		}
 	}
+#endif
 }
 
 void AHaPlayerState::OnRep_Score()
@@ -48,6 +50,7 @@ void AHaPlayerState::OnRep_Score()
 void AHaPlayerState::AddToDeaths(int32 DeathsAmount)
 {
 	Defeats += DeathsAmount;
+#if WITH_COSMETICS
 	Character = Character == nullptr ? Cast<AHABaseCharacter>(GetPawn()) : Character;
 	if (Character)
 	{
@@ -58,6 +61,7 @@ void AHaPlayerState::AddToDeaths(int32 DeathsAmount)
 			UE_LOG(LogTemp, Warning, TEXT("Add to deaths Server"));
 		}
 	}
+#endif
 }
 
 void AHaPlayerState::OnRep_Defeats()
@@ -0,0 +1,118 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/HAAttachmentSubsystem.h"
+#include "Attachments/BaseAttachment.h"
+#include "Components/StaticMeshComponent.h"
+#include "GameFramework/WorldSettings.h"
+#include "Engine/Engine.h"
+#include "HexArena/HexArena.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Live Attachments"), STAT_HAAttachmentsLive, STATGROUP_HAPools);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Attachment Components"), STAT_HAAttachmentsCreated, STATGROUP_HAPools);
+
+bool UHAAttachmentSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+#if !WITH_COSMETICS
+	return false;
+#else
+	return Super::ShouldCreateSubsystem(Outer) && !IsRunningDedicatedServer();
+#endif
+}
+
+bool UHAAttachmentSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UHAAttachmentSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// Dedicated servers in PIE share the process with clients, so only the net mode tells them apart
+	bEnabled = InWorld.GetNetMode() != NM_DedicatedServer;
+}
+
+void UHAAttachmentSubsystem::Deinitialize()
+{
+	int32 NumCreated = LiveAttachments.Num();
+	for (const TPair<UClass*, FAttachmentComponentPool>& Pool : Pools)
+	{
+		NumCreated += Pool.Value.Free.Num();
+	}
+	DEC_DWORD_STAT_BY(STAT_HAAttachmentsLive, LiveAttachments.Num());
+	DEC_DWORD_STAT_BY(STAT_HAAttachmentsCreated, NumCreated);
+
+	bEnabled = false;
+	Pools.Empty();
+	LiveAttachments.Empty();
+
+	Super::Deinitialize();
+}
+
+UHAAttachmentSubsystem* UHAAttachmentSubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull);
+	UHAAttachmentSubsystem* AttachmentSubsystem = World ? World->GetSubsystem<UHAAttachmentSubsystem>() : nullptr;
+	return AttachmentSubsystem && AttachmentSubsystem->bEnabled ? AttachmentSubsystem : nullptr;
+}
+
+UStaticMeshComponent* UHAAttachmentSubsystem::AcquireAttachment(TSubclassOf<ABaseAttachment> AttachmentClass, UStaticMesh* Mesh, USceneComponent* Parent, FName Socket)
+{
+	if (AttachmentClass == nullptr || Parent == nullptr) return nullptr;
+
+	UStaticMeshComponent* AttachmentComponent = nullptr;
+	FAttachmentComponentPool& Pool = Pools.FindOrAdd(AttachmentClass);
+	while (AttachmentComponent == nullptr && Pool.Free.Num() > 0)
+	{
+		AttachmentComponent = Pool.Free.Pop(false);
+		if (!IsValid(AttachmentComponent))
+		{
+			AttachmentComponent = nullptr;
+			DEC_DWORD_STAT(STAT_HAAttachmentsCreated);
+		}
+	}
+
+	if (AttachmentComponent == nullptr)
+	{
+		// The mesh component of the class defaults carries what its blueprint set up, materials and custom depth stencil included
+		const ABaseAttachment* AttachmentDefaults = AttachmentClass->GetDefaultObject<ABaseAttachment>();
+		UWorld* World = GetWorld();
+		UObject* Outer = World->GetWorldSettings() ? static_cast<UObject*>(World->GetWorldSettings()) : static_cast<UObject*>(World);
+		AttachmentComponent = NewObject<UStaticMeshComponent>(Outer, NAME_None, RF_Transient, AttachmentDefaults->AttachmentMesh);
+		// Cosmetic, traces hit the weapon
+		AttachmentComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		INC_DWORD_STAT(STAT_HAAttachmentsCreated);
+	}
+
+	if (Mesh)
+	{
+		AttachmentComponent->SetStaticMesh(Mesh);
+	}
+	AttachmentComponent->AttachToComponent(Parent, FAttachmentTransformRules::SnapToTargetNotIncludingScale, Socket);
+	if (!AttachmentComponent->IsRegistered())
+	{
+		AttachmentComponent->RegisterComponentWithWorld(GetWorld());
+	}
+
+	LiveAttachments.Add(AttachmentComponent, AttachmentClass);
+	INC_DWORD_STAT(STAT_HAAttachmentsLive);
+	return AttachmentComponent;
+}
+
+void UHAAttachmentSubsystem::ReleaseAttachment(UStaticMeshComponent* AttachmentComponent)
+{
+	UClass* AttachmentClass = nullptr;
+	if (!LiveAttachments.RemoveAndCopyValue(AttachmentComponent, AttachmentClass)) return;
+
+	DEC_DWORD_STAT(STAT_HAAttachmentsLive);
+	if (!IsValid(AttachmentComponent))
+	{
+		DEC_DWORD_STAT(STAT_HAAttachmentsCreated);
+		return;
+	}
+
+	AttachmentComponent->DetachFromComponent(FDetachmentTransformRules::KeepRelativeTransform);
+	AttachmentComponent->UnregisterComponent();
+	Pools.FindOrAdd(AttachmentClass).Free.Add(AttachmentComponent);
+}
@@ -0,0 +1,189 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/HABulletSubsystem.h"
+#include "Weapon/ProjectileBullet.h"
+#include "Containers/Ticker.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+/**
+ * Bullet benchmark
+ * Synthetic players fire at a fixed rate for a few seconds, through UHABulletSubsystem or one projectile actor per round.
+ * Runs over real frames since actors only move when the world ticks, game thread time is sampled every frame.
+ */
+
+namespace HABulletBenchmark
+{
+	struct FSettings
+	{
+		int32 NumPlayers = 100;
+		float Seconds = 10.f;
+		// Rounds per second of each player
+		float FireRate = 10.f;
+		bool bActors = false;
+	};
+
+	struct FRun
+	{
+		FSettings Settings;
+		TWeakObjectPtr<UWorld> World;
+		FTSTicker::FDelegateHandle TickerHandle;
+		FRandomStream Stream;
+		float ElapsedTime = 0.f;
+		float ShotsOwed = 0.f;
+		int32 PeakInFlight = 0;
+		TArray<double> GameThreadMilliseconds;
+		TArray<TWeakObjectPtr<AActor>> SpawnedActors;
+	};
+
+	// Only one run at a time, the frames would be shared otherwise
+	static TSharedPtr<FRun> ActiveRun;
+
+	// Seconds skipped before sampling, spawning the first rounds hitches
+	static constexpr float WarmupTime = 1.f;
+
+	static double Percentile(TArray<double>& Samples, float Fraction)
+	{
+		if (Samples.Num() == 0) return 0.0;
+		Samples.Sort();
+		return Samples[FMath::Clamp(FMath::FloorToInt((Samples.Num() - 1) * Fraction), 0, Samples.Num() - 1)];
+	}
+
+	// Players stand on a grid high above the level and fire level, so rounds fly their full lifetime like misses
+	static void FireRound(FRun& Run, UWorld* World, int32 Player)
+	{
+		const FVector Location(1000.f * (Player % 10), 1000.f * (Player / 10), 50000.f);
+		const FVector Direction = FRotator(0.f, Run.Stream.FRandRange(0.f, 360.f), 0.f).Vector();
+
+		if (Run.Settings.bActors)
+		{
+			FActorSpawnParameters SpawnParams;
+			SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+			AProjectile* Projectile = World->SpawnActor<AProjectile>(AProjectileBullet::StaticClass(), FTransform(Direction.Rotation(), Location), SpawnParams);
+			if (Projectile)
+			{
+				Projectile->SetLifeSpan(5.f);
+				Run.SpawnedActors.Add(Projectile);
+			}
+			return;
+		}
+
+		if (UHABulletSubsystem* Bullets = World->GetSubsystem<UHABulletSubsystem>())
+		{
+			FBulletSpawnParams Params;
+			Params.BulletClass = AProjectileBullet::StaticClass();
+			Params.Location = Location;
+			Params.Direction = Direction;
+			Params.Flags = EBulletFlags::ApplyDamage;
+			Bullets->FireBullet(Params);
+		}
+	}
+
+	static int32 NumInFlight(FRun& Run, UWorld* World)
+	{
+		if (Run.Settings.bActors)
+		{
+			Run.SpawnedActors.RemoveAllSwap([](const TWeakObjectPtr<AActor>& Actor) { return !Actor.IsValid(); }, false);
+			return Run.SpawnedActors.Num();
+		}
+
+		const UHABulletSubsystem* Bullets = World->GetSubsystem<UHABulletSubsystem>();
+		return Bullets ? Bullets->GetNumBullets() : 0;
+	}
+
+	static void Finish(FRun& Run)
+	{
+		for (const TWeakObjectPtr<AActor>& Actor : Run.SpawnedActors)
+		{
+			if (Actor.IsValid())
+			{
+				Actor->Destroy();
+			}
+		}
+
+		const FString Row = FString::Printf(TEXT("%s,%d,%.1f,%d,%d,%.3f,%.3f"),
+			Run.Settings.bActors ? TEXT("actors") : TEXT("data"),
+			Run.Settings.NumPlayers,
+			Run.Settings.FireRate,
+			Run.PeakInFlight,
+			Run.GameThreadMilliseconds.Num(),
+			Percentile(Run.GameThreadMilliseconds, 0.5f),
+			Percentile(Run.GameThreadMilliseconds, 0.99f));
+		UE_LOG(LogTemp, Display, TEXT("BulletBenchmark %s"), *Row);
+
+		const FString Csv = FString(TEXT("Path,Players,FireRate,PeakInFlight,Frames,P50GameThreadMs,P99GameThreadMs\n")) + Row + TEXT("\n");
+		const FString FileName = FPaths::ProfilingDir() / TEXT("BulletBenchmark") / FString::Printf(TEXT("BulletBenchmark-%s.csv"), *FDateTime::Now().ToString());
+		if (FFileHelper::SaveStringToFile(Csv, *FileName))
+		{
+			UE_LOG(LogTemp, Display, TEXT("BulletBenchmark written to %s"), *IFileManager::Get().ConvertToAbsolutePathForExternalAppForWrite(*FileName));
+		}
+	}
+
+	static bool Tick(float DeltaTime)
+	{
+		TSharedPtr<FRun> Run = ActiveRun;
+		UWorld* World = Run.IsValid() ? Run->World.Get() : nullptr;
+		if (World == nullptr)
+		{
+			ActiveRun.Reset();
+			return false;
+		}
+
+		Run->ElapsedTime += DeltaTime;
+		if (Run->ElapsedTime > WarmupTime)
+		{
+			// Previous frame, the current one is still running
+			Run->GameThreadMilliseconds.Add(FPlatformTime::ToMilliseconds(GGameThreadTime));
+		}
+
+		if (Run->ElapsedTime > Run->Settings.Seconds + WarmupTime)
+		{
+			Finish(*Run);
+			ActiveRun.Reset();
+			return false;
+		}
+
+		Run->ShotsOwed += Run->Settings.NumPlayers * Run->Settings.FireRate * DeltaTime;
+		const int32 NumShots = FMath::FloorToInt(Run->ShotsOwed);
+		Run->ShotsOwed -= NumShots;
+		for (int32 Shot = 0; Shot < NumShots; ++Shot)
+		{
+			FireRound(*Run, World, Run->Stream.RandRange(0, Run->Settings.NumPlayers - 1));
+		}
+
+		Run->PeakInFlight = FMath::Max(Run->PeakInFlight, NumInFlight(*Run, World));
+		return true;
+	}
+
+	static void Execute(const TArray<FString>& Args, UWorld* World)
+	{
+		if (World == nullptr || World->GetNetMode() == NM_Client) return;
+		if (ActiveRun.IsValid())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("BulletBenchmark already running"));
+			return;
+		}
+
+		FSettings Settings;
+		if (Args.IsValidIndex(0)) Settings.NumPlayers = FMath::Max(FCString::Atoi(*Args[0]), 1);
+		if (Args.IsValidIndex(1)) Settings.Seconds = FMath::Max(FCString::Atof(*Args[1]), 1.f);
+		if (Args.IsValidIndex(2)) Settings.FireRate = FMath::Max(FCString::Atof(*Args[2]), 0.1f);
+		if (Args.IsValidIndex(3)) Settings.bActors = Args[3] == TEXT("actors");
+
+		ActiveRun = MakeShared<FRun>();
+		ActiveRun->Settings = Settings;
+		ActiveRun->World = World;
+		// Fixed seed, both paths fire the same rounds
+		ActiveRun->Stream.Initialize(Settings.NumPlayers * 7919);
+		ActiveRun->TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&Tick));
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs BulletBenchmarkCommand(
+	TEXT("HA.Bullets.Benchmark"),
+	TEXT("Fires synthetic rounds for a few seconds and reports game thread frame time percentiles to the log and a CSV in the profiling directory.\n")
+	TEXT("HA.Bullets.Benchmark [Players=100] [Seconds=10] [FireRate=10] [data|actors]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&HABulletBenchmark::Execute),
+	ECVF_Cheat);
@@ -0,0 +1,348 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/HABulletSubsystem.h"
+#include "Character/HABaseCharacter.h"
+#include "HAComponents/LagCompensationComponent.h"
+#include "HAComponents/HitBoxComponent.h"
+#include "Weapon/BaseWeapon.h"
+#include "Weapon/Projectile.h"
+#include "Components/BoxComponent.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+#include "Particles/ParticleSystemComponent.h"
+#include "Sound/SoundCue.h"
+#include "Subsystems/HAFXSubsystem.h"
+#include "Async/ParallelFor.h"
+#include "Kismet/GameplayStatics.h"
+#include "HexArena/HexArena.h"
+
+DECLARE_CYCLE_STAT(TEXT("Simulate Bullets"), STAT_HABulletSimulate, STATGROUP_HABullets);
+DECLARE_CYCLE_STAT(TEXT("Sweep Bullets"), STAT_HABulletSweep, STATGROUP_HABullets);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Bullets In Flight"), STAT_HABulletsInFlight, STATGROUP_HABullets);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Bullet Steps"), STAT_HABulletSteps, STATGROUP_HABullets);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Bullet Hits"), STAT_HABulletHits, STATGROUP_HABullets);
+
+static TAutoConsoleVariable<int32> CVarBulletsEnabled(
+	TEXT("HA.Bullets.Enabled"),
+	0,
+	TEXT("Simulate projectile weapon rounds as data in UHABulletSubsystem instead of spawning projectile actors.\n0: actors, 1: data"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarBulletsStepRate(
+	TEXT("HA.Bullets.StepRate"),
+	60.f,
+	TEXT("Fixed simulation steps per second of bullets in flight"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarBulletsMaxStepsPerFrame(
+	TEXT("HA.Bullets.MaxStepsPerFrame"),
+	4,
+	TEXT("Most steps simulated in one frame, time owed past it is dropped so a hitch does not snowball"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarBulletsMaxFlightTime(
+	TEXT("HA.Bullets.MaxFlightTime"),
+	5.f,
+	TEXT("Seconds after which a bullet that hit nothing is removed"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarBulletsParallelSweeps(
+	TEXT("HA.Bullets.ParallelSweeps"),
+	1,
+	TEXT("Trace the bullets of a step from worker threads.\n0: game thread only, 1: parallel"),
+	ECVF_Default);
+
+void FHABulletTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Target && TickType != LEVELTICK_ViewportsOnly)
+	{
+		Target->Simulate(DeltaTime);
+	}
+}
+
+FString FHABulletTickFunction::DiagnosticMessage()
+{
+	return TEXT("FHABulletTickFunction[Simulate]");
+}
+
+bool UHABulletSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UHABulletSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// Same group projectile movement components ticked in, hit boxes are where the physics scene has them
+	SimulateTickFunction.bCanEverTick = true;
+	SimulateTickFunction.bStartWithTickEnabled = true;
+	SimulateTickFunction.TickGroup = TG_PrePhysics;
+	SimulateTickFunction.Target = this;
+	SimulateTickFunction.RegisterTickFunction(InWorld.PersistentLevel);
+}
+
+void UHABulletSubsystem::Deinitialize()
+{
+	if (SimulateTickFunction.IsTickFunctionRegistered())
+	{
+		SimulateTickFunction.UnRegisterTickFunction();
+	}
+
+	DEC_DWORD_STAT_BY(STAT_HABulletsInFlight, Positions.Num());
+	Positions.Empty();
+	Velocities.Empty();
+	Extents.Empty();
+	GravityZ.Empty();
+	SpawnTimes.Empty();
+	Flags.Empty();
+	Shooters.Empty();
+	Weapons.Empty();
+	BulletClasses.Empty();
+	TraceStarts.Empty();
+	InitialVelocities.Empty();
+	Tracers.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UHABulletSubsystem::IsEnabled()
+{
+	return CVarBulletsEnabled.GetValueOnGameThread() != 0;
+}
+
+int32 UHABulletSubsystem::FireBullet(const FBulletSpawnParams& Params)
+{
+	if (Params.BulletClass == nullptr) return INDEX_NONE;
+
+	EBulletFlags BulletFlags = Params.Flags;
+	if (GetWorld()->GetNetMode() == NM_DedicatedServer)
+	{
+		EnumRemoveFlags(BulletFlags, EBulletFlags::Cosmetic);
+	}
+	// Server copy of a remote client's rewind bullet, nothing to show or score
+	if (BulletFlags == EBulletFlags::None) return INDEX_NONE;
+
+	const AProjectile* DefaultProjectile = Params.BulletClass->GetDefaultObject<AProjectile>();
+	const UProjectileMovementComponent* DefaultMovement = DefaultProjectile->GetProjectileMovement();
+	const float GravityScale = DefaultMovement ? DefaultMovement->ProjectileGravityScale : 1.f;
+	const FVector Velocity = Params.Direction.GetSafeNormal() * DefaultProjectile->InitialSpeed;
+
+	const int32 Bullet = Positions.Add(Params.Location);
+	Velocities.Add(Velocity);
+	Extents.Add(DefaultProjectile->GetCollisionBox() ? DefaultProjectile->GetCollisionBox()->GetScaledBoxExtent() : FVector::ZeroVector);
+	GravityZ.Add(GetWorld()->GetGravityZ() * GravityScale);
+	SpawnTimes.Add(GetWorld()->GetTimeSeconds());
+	Flags.Add(BulletFlags);
+	Shooters.Add(Params.Shooter);
+	Weapons.Add(Params.Weapon);
+	BulletClasses.Add(Params.BulletClass);
+	TraceStarts.Add(Params.Location);
+	InitialVelocities.Add(Velocity);
+
+	UParticleSystemComponent* TracerComponent = nullptr;
+	UHAFXSubsystem* FXSubsystem = UHAFXSubsystem::Get(this);
+	if (EnumHasAnyFlags(BulletFlags, EBulletFlags::Cosmetic) && FXSubsystem)
+	{
+		TracerComponent = FXSubsystem->AcquireTracer(DefaultProjectile->GetTracer(), Params.Location, Velocity.Rotation());
+	}
+	Tracers.Add(TracerComponent);
+
+	INC_DWORD_STAT(STAT_HABulletsInFlight);
+	return Bullet;
+}
+
+void UHABulletSubsystem::Simulate(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_HABulletSimulate);
+
+	if (Positions.Num() == 0)
+	{
+		// Next bullet starts on a fresh step instead of catching up on idle time
+		StepAccumulator = 0.f;
+		return;
+	}
+
+	const float StepTime = 1.f / FMath::Max(CVarBulletsStepRate.GetValueOnGameThread(), 1.f);
+	const int32 MaxSteps = FMath::Max(CVarBulletsMaxStepsPerFrame.GetValueOnGameThread(), 1);
+
+	StepAccumulator += DeltaTime;
+	int32 NumSteps = FMath::FloorToInt(StepAccumulator / StepTime);
+	StepAccumulator -= NumSteps * StepTime;
+	if (NumSteps > MaxSteps)
+	{
+		NumSteps = MaxSteps;
+	}
+
+	for (int32 StepIndex = 0; StepIndex < NumSteps && Positions.Num() > 0; ++StepIndex)
+	{
+		Step(StepTime);
+	}
+
+	UpdateTracers();
+}
+
+void UHABulletSubsystem::Step(float StepTime)
+{
+	INC_DWORD_STAT(STAT_HABulletSteps);
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	const float MaxFlightTime = CVarBulletsMaxFlightTime.GetValueOnGameThread();
+	for (int32 Bullet = Positions.Num() - 1; Bullet >= 0; --Bullet)
+	{
+		if (Now - SpawnTimes[Bullet] > MaxFlightTime)
+		{
+			RemoveBullet(Bullet);
+		}
+	}
+
+	SweepBullets(StepTime);
+}
+
+void UHABulletSubsystem::SweepBullets(float StepTime)
+{
+	const int32 NumBullets = Positions.Num();
+	if (NumBullets == 0) return;
+
+	SweepEnds.SetNumUninitialized(NumBullets, false);
+	SweepIgnoredActors.SetNumUninitialized(NumBullets, false);
+	SweepHits.SetNum(NumBullets, false);
+	SweepBlocked.SetNumZeroed(NumBullets, false);
+
+	// Semi implicit Euler, same as the projectile movement component without sub stepping
+	for (int32 Bullet = 0; Bullet < NumBullets; ++Bullet)
+	{
+		Velocities[Bullet].Z += GravityZ[Bullet] * StepTime;
+		SweepEnds[Bullet] = Positions[Bullet] + Velocities[Bullet] * StepTime;
+		SweepIgnoredActors[Bullet] = Shooters[Bullet].Get();
+	}
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_HABulletSweep);
+
+		// Collision box of the projectile with its responses: world geometry and hit boxes
+		FCollisionObjectQueryParams ObjectParams;
+		ObjectParams.AddObjectTypesToQuery(ECC_WorldStatic);
+		ObjectParams.AddObjectTypesToQuery(ECC_HitBox);
+
+		const UWorld* World = GetWorld();
+		const bool bSingleThread = CVarBulletsParallelSweeps.GetValueOnGameThread() == 0;
+		ParallelFor(NumBullets, [&](int32 Bullet)
+		{
+			FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(HABulletSweep), false, SweepIgnoredActors[Bullet]);
+			SweepBlocked[Bullet] = World->SweepSingleByObjectType(
+				SweepHits[Bullet],
+				Positions[Bullet],
+				SweepEnds[Bullet],
+				Velocities[Bullet].ToOrientationQuat(),
+				ObjectParams,
+				FCollisionShape::MakeBox(Extents[Bullet]),
+				QueryParams);
+		}, bSingleThread);
+	}
+
+	// Hits go out on the game thread in bullet order, damage may kill a character other bullets of the step also hit
+	FinishedBullets.Reset();
+	for (int32 Bullet = 0; Bullet < NumBullets; ++Bullet)
+	{
+		if (SweepBlocked[Bullet])
+		{
+			HandleHit(Bullet, SweepHits[Bullet]);
+			FinishedBullets.Add(Bullet);
+		}
+		else
+		{
+			Positions[Bullet] = SweepEnds[Bullet];
+		}
+	}
+
+	// Descending, so the bullet swapped into a removed slot is never one still to remove
+	for (int32 Index = FinishedBullets.Num() - 1; Index >= 0; --Index)
+	{
+		RemoveBullet(FinishedBullets[Index]);
+	}
+}
+
+void UHABulletSubsystem::HandleHit(int32 Bullet, const FHitResult& Hit)
+{
+	INC_DWORD_STAT(STAT_HABulletHits);
+
+	AHABaseCharacter* Shooter = Shooters[Bullet].Get();
+	ABaseWeapon* Weapon = Weapons[Bullet].Get();
+
+	if (Shooter && Shooter->Controller && EnumHasAnyFlags(Flags[Bullet], EBulletFlags::ApplyDamage))
+	{
+		// Only characters take weapon damage, through the hit box that was hit
+		const UHitBoxComponent* HitBox = Cast<UHitBoxComponent>(Hit.GetComponent());
+		AHABaseCharacter* HitCharacter = Cast<AHABaseCharacter>(Hit.GetActor());
+		if (HitBox && HitCharacter && Weapon)
+		{
+			const float Damage = ULagCompensationComponent::GetHitBoxDamage(Weapon->GetWeaponData(), HitBox->HitBoxType);
+			UGameplayStatics::ApplyDamage(HitCharacter, Damage, Shooter->Controller, Weapon, UDamageType::StaticClass());
+		}
+	}
+	else if (Shooter && Shooter->IsLocallyControlled() && Shooter->GetLagCompensation() && EnumHasAnyFlags(Flags[Bullet], EBulletFlags::RequestSSR))
+	{
+		if (AHABaseCharacter* HitCharacter = Cast<AHABaseCharacter>(Hit.GetActor()))
+		{
+			Shooter->GetLagCompensation()->ProjectileServerScoreRequest(
+				HitCharacter,
+				TraceStarts[Bullet],
+				InitialVelocities[Bullet],
+				HitCharacter->GetRenderedRewindFrame()
+			);
+		}
+	}
+
+	if (EnumHasAnyFlags(Flags[Bullet], EBulletFlags::Cosmetic))
+	{
+		PlayImpactEffects(Bullet, Hit);
+	}
+}
+
+void UHABulletSubsystem::PlayImpactEffects(int32 Bullet, const FHitResult& Hit)
+{
+	UHAFXSubsystem* FXSubsystem = UHAFXSubsystem::Get(this);
+	if (FXSubsystem == nullptr) return;
+
+	const AProjectile* DefaultProjectile = BulletClasses[Bullet]->GetDefaultObject<AProjectile>();
+	FXSubsystem->PlayImpact(DefaultProjectile->GetImpactParticles(), DefaultProjectile->GetImpactSound(), FTransform(Velocities[Bullet].Rotation(), Hit.ImpactPoint));
+}
+
+void UHABulletSubsystem::UpdateTracers()
+{
+	// Extrapolated by the time owed to the next step, so tracers move every frame at any step rate
+	for (int32 Bullet = 0; Bullet < Tracers.Num(); ++Bullet)
+	{
+		if (Tracers[Bullet])
+		{
+			Tracers[Bullet]->SetWorldLocationAndRotation(Positions[Bullet] + Velocities[Bullet] * StepAccumulator, Velocities[Bullet].Rotation());
+		}
+	}
+}
+
+void UHABulletSubsystem::RemoveBullet(int32 Bullet)
+{
+	if (Tracers[Bullet])
+	{
+		if (UHAFXSubsystem* FXSubsystem = UHAFXSubsystem::Get(this))
+		{
+			FXSubsystem->ReleaseTracer(Tracers[Bullet]);
+		}
+	}
+
+	Positions.RemoveAtSwap(Bullet, 1, false);
+	Velocities.RemoveAtSwap(Bullet, 1, false);
+	Extents.RemoveAtSwap(Bullet, 1, false);
+	GravityZ.RemoveAtSwap(Bullet, 1, false);
+	SpawnTimes.RemoveAtSwap(Bullet, 1, false);
+	Flags.RemoveAtSwap(Bullet, 1, false);
+	Shooters.RemoveAtSwap(Bullet, 1, false);
+	Weapons.RemoveAtSwap(Bullet, 1, false);
+	BulletClasses.RemoveAtSwap(Bullet, 1, false);
+	TraceStarts.RemoveAtSwap(Bullet, 1, false);
+	InitialVelocities.RemoveAtSwap(Bullet, 1, false);
+	Tracers.RemoveAtSwap(Bullet, 1, false);
+
+	DEC_DWORD_STAT(STAT_HABulletsInFlight);
+}
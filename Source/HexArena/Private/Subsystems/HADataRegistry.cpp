@@ -0,0 +1,374 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/HADataRegistry.h"
+#include "Weapon/BaseWeapon.h"
+#include "Attachments/BaseAttachment.h"
+#include "Pickups/AmmoPickup.h"
+#include "Pickups/LootBox.h"
+#include "Character/HABaseCharacter.h"
+#include "Engine/GameInstance.h"
+#include "Engine/Engine.h"
+#include "Engine/AssetManager.h"
+#include "EngineUtils.h"
+#include "UObject/ConstructorHelpers.h"
+
+UHADataRegistry::UHADataRegistry()
+{
+	static ConstructorHelpers::FObjectFinder<UDataTable> WeaponDTObject(TEXT("DataTable'/Game/Blueprints/Weapon/WeaponDT.WeaponDT'"));
+	if (WeaponDTObject.Succeeded())
+	{
+		WeaponTable = WeaponDTObject.Object;
+	}
+
+	static ConstructorHelpers::FObjectFinder<UDataTable> AttachmentDTObject(TEXT("DataTable'/Game/Blueprints/Weapon/Attachment/DT_Attachments.DT_Attachments'"));
+	if (AttachmentDTObject.Succeeded())
+	{
+		AttachmentTable = AttachmentDTObject.Object;
+	}
+
+	static ConstructorHelpers::FObjectFinder<UDataTable> AmmoPickupDTObject(TEXT("DataTable'/Game/Blueprints/Pickups/DT_AmmoPickups.DT_AmmoPickups'"));
+	if (AmmoPickupDTObject.Succeeded())
+	{
+		AmmoPickupTable = AmmoPickupDTObject.Object;
+	}
+
+	static ConstructorHelpers::FObjectFinder<UDataTable> LootDTObject(TEXT("DataTable'/Game/Blueprints/Pickups/DT_Loot.DT_Loot'"));
+	if (LootDTObject.Succeeded())
+	{
+		LootTable = LootDTObject.Object;
+	}
+
+	static ConstructorHelpers::FObjectFinder<UDataTable> TeamColorsDTObject(TEXT("DataTable'/Game/Blueprints/Character/Materials/DT_TeamColors.DT_TeamColors'"));
+	if (TeamColorsDTObject.Succeeded())
+	{
+		TeamColorsTable = TeamColorsDTObject.Object;
+	}
+}
+
+void UHADataRegistry::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	BuildIndices();
+
+	WorldInitializedActorsHandle = FWorldDelegates::OnWorldInitializedActors.AddUObject(this, &UHADataRegistry::OnWorldInitializedActors);
+
+#if WITH_EDITOR
+	// Row pointers go stale when a table is edited or reimported
+	for (UDataTable* Table : { WeaponTable, AttachmentTable, AmmoPickupTable, LootTable, TeamColorsTable })
+	{
+		if (Table)
+		{
+			Table->OnDataTableChanged().AddUObject(this, &UHADataRegistry::OnTableChanged);
+		}
+	}
+#endif
+}
+
+void UHADataRegistry::Deinitialize()
+{
+	FWorldDelegates::OnWorldInitializedActors.Remove(WorldInitializedActorsHandle);
+	WorldPreloadHandle.Reset();
+
+#if WITH_EDITOR
+	for (UDataTable* Table : { WeaponTable, AttachmentTable, AmmoPickupTable, LootTable, TeamColorsTable })
+	{
+		if (Table)
+		{
+			Table->OnDataTableChanged().RemoveAll(this);
+		}
+	}
+#endif
+
+	Super::Deinitialize();
+}
+
+UHADataRegistry* UHADataRegistry::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull);
+	const UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+	return GameInstance ? GameInstance->GetSubsystem<UHADataRegistry>() : nullptr;
+}
+
+void UHADataRegistry::BuildIndices()
+{
+	Weapons.Build(WeaponTable);
+	Attachments.Build(AttachmentTable);
+	AmmoPickups.Build(AmmoPickupTable);
+	Loot.Build(LootTable);
+	TeamColors.Build(TeamColorsTable);
+
+	WeaponAttachmentIds.SetNum(Weapons.Num());
+	for (int32 WeaponId = 0; WeaponId < Weapons.Num(); ++WeaponId)
+	{
+		WeaponAttachmentIds[WeaponId].Reset();
+		for (const FName& AttachmentName : Weapons.Get(WeaponId).Attachments)
+		{
+			const int32 AttachmentId = Attachments.FindId(AttachmentName);
+			if (AttachmentId == INDEX_NONE)
+			{
+				UE_LOG(LogTemp, Warning, TEXT("Weapon %s names unknown attachment %s"), *Weapons.GetName(WeaponId).ToString(), *AttachmentName.ToString());
+				continue;
+			}
+			WeaponAttachmentIds[WeaponId].Add(AttachmentId);
+		}
+	}
+
+	WeaponStatsCache.Reset();
+
+	LootPickupIds.SetNum(Loot.Num());
+	for (int32 LootId = 0; LootId < Loot.Num(); ++LootId)
+	{
+		const FLootData& LootData = Loot.Get(LootId);
+		switch (LootData.PickupType)
+		{
+		case EPickupTypes::EPT_Weapon:
+			LootPickupIds[LootId] = Weapons.FindId(LootData.LootName);
+			break;
+		case EPickupTypes::EPT_Ammo:
+			LootPickupIds[LootId] = AmmoPickups.FindId(LootData.LootName);
+			break;
+		default:
+			LootPickupIds[LootId] = INDEX_NONE;
+			break;
+		}
+	}
+}
+
+TSharedRef<const FWeaponStats> UHADataRegistry::GetWeaponStats(int32 WeaponId, uint16 AttachmentMask)
+{
+	if (!Weapons.IsValidId(WeaponId)) return FWeaponStats::GetDefault();
+
+	const uint32 Key = (static_cast<uint32>(WeaponId) << 16) | AttachmentMask;
+	if (const TSharedRef<const FWeaponStats>* CachedStats = WeaponStatsCache.Find(Key))
+	{
+		return *CachedStats;
+	}
+
+	TArray<const FAttachmentData*> WeaponAttachments;
+	const TArray<int32>& AttachmentIds = WeaponAttachmentIds[WeaponId];
+	for (int32 AttachmentIndex = 0; AttachmentIndex < FMath::Min(AttachmentIds.Num(), 16); ++AttachmentIndex)
+	{
+		if (AttachmentMask & (1 << AttachmentIndex))
+		{
+			WeaponAttachments.Add(&Attachments.Get(AttachmentIds[AttachmentIndex]));
+		}
+	}
+
+	const TSharedRef<const FWeaponStats> Stats = MakeShared<FWeaponStats>(Weapons.Get(WeaponId), MoveTemp(WeaponAttachments));
+	WeaponStatsCache.Add(Key, Stats);
+	return Stats;
+}
+
+/**
+ * Assets
+ */
+
+bool UHADataRegistry::WantsCosmetics(const UObject* WorldContextObject)
+{
+#if !WITH_COSMETICS
+	return false;
+#else
+	const UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull);
+	return World ? World->GetNetMode() != NM_DedicatedServer : !IsRunningDedicatedServer();
+#endif
+}
+
+namespace HADataRegistryAssets
+{
+	template<typename AssetPtrType>
+	static void Add(const AssetPtrType& Asset, TArray<FSoftObjectPath>& OutAssets)
+	{
+		if (!Asset.IsNull())
+		{
+			OutAssets.AddUnique(Asset.ToSoftObjectPath());
+		}
+	}
+}
+
+void UHADataRegistry::GetWeaponAssets(int32 WeaponId, EHAAssetBundle Bundle, TArray<FSoftObjectPath>& OutAssets) const
+{
+	if (!Weapons.IsValidId(WeaponId)) return;
+
+	const FWeaponData& Weapon = Weapons.Get(WeaponId);
+	if (Bundle == EHAAssetBundle::Game)
+	{
+		HADataRegistryAssets::Add(Weapon.WeaponMesh, OutAssets);
+		HADataRegistryAssets::Add(Weapon.RecoilYawCurve, OutAssets);
+		HADataRegistryAssets::Add(Weapon.RecoilPitchCurve, OutAssets);
+		return;
+	}
+
+	HADataRegistryAssets::Add(Weapon.FireAnimation, OutAssets);
+	HADataRegistryAssets::Add(Weapon.BulletShellClass, OutAssets);
+	HADataRegistryAssets::Add(Weapon.CrosshairsCenter, OutAssets);
+	HADataRegistryAssets::Add(Weapon.CrosshairsLeft, OutAssets);
+	HADataRegistryAssets::Add(Weapon.CrosshairsRight, OutAssets);
+	HADataRegistryAssets::Add(Weapon.CrosshairsTop, OutAssets);
+	HADataRegistryAssets::Add(Weapon.CrosshairsBottom, OutAssets);
+	for (const int32 AttachmentId : WeaponAttachmentIds[WeaponId])
+	{
+		HADataRegistryAssets::Add(Attachments.Get(AttachmentId).AttachmentMesh, OutAssets);
+	}
+}
+
+void UHADataRegistry::GetAmmoPickupAssets(int32 AmmoPickupId, EHAAssetBundle Bundle, TArray<FSoftObjectPath>& OutAssets) const
+{
+	if (!AmmoPickups.IsValidId(AmmoPickupId) || Bundle != EHAAssetBundle::Client) return;
+
+	HADataRegistryAssets::Add(AmmoPickups.Get(AmmoPickupId).Mesh, OutAssets);
+}
+
+void UHADataRegistry::GetTeamColorsAssets(int32 TeamColorsId, EHAAssetBundle Bundle, TArray<FSoftObjectPath>& OutAssets) const
+{
+	if (!TeamColors.IsValidId(TeamColorsId) || Bundle != EHAAssetBundle::Client) return;
+
+	const FTeamColorsData& Colors = TeamColors.Get(TeamColorsId);
+	HADataRegistryAssets::Add(Colors.BodyMaterialInstance, OutAssets);
+	HADataRegistryAssets::Add(Colors.ArmMaterialInstance, OutAssets);
+	HADataRegistryAssets::Add(Colors.UpperarmMaterialInstance, OutAssets);
+	HADataRegistryAssets::Add(Colors.BodyDissolveMaterialInstance, OutAssets);
+	HADataRegistryAssets::Add(Colors.ArmDissolveMaterialInstance, OutAssets);
+	HADataRegistryAssets::Add(Colors.UpperarmDissolveMaterialInstance, OutAssets);
+}
+
+TSharedPtr<FStreamableHandle> UHADataRegistry::LoadWeaponAssets(int32 WeaponId, const UObject* WorldContextObject, FStreamableDelegate OnLoaded) const
+{
+	TArray<FSoftObjectPath> Assets;
+	GetWeaponAssets(WeaponId, EHAAssetBundle::Game, Assets);
+	if (WantsCosmetics(WorldContextObject))
+	{
+		GetWeaponAssets(WeaponId, EHAAssetBundle::Client, Assets);
+	}
+	return LoadAssets(MoveTemp(Assets), MoveTemp(OnLoaded), Weapons.GetName(WeaponId).ToString());
+}
+
+TSharedPtr<FStreamableHandle> UHADataRegistry::LoadAmmoPickupAssets(int32 AmmoPickupId, const UObject* WorldContextObject, FStreamableDelegate OnLoaded) const
+{
+	TArray<FSoftObjectPath> Assets;
+	GetAmmoPickupAssets(AmmoPickupId, EHAAssetBundle::Game, Assets);
+	if (WantsCosmetics(WorldContextObject))
+	{
+		GetAmmoPickupAssets(AmmoPickupId, EHAAssetBundle::Client, Assets);
+	}
+	return LoadAssets(MoveTemp(Assets), MoveTemp(OnLoaded), AmmoPickups.GetName(AmmoPickupId).ToString());
+}
+
+TSharedPtr<FStreamableHandle> UHADataRegistry::LoadTeamColorsAssets(int32 TeamColorsId, const UObject* WorldContextObject, FStreamableDelegate OnLoaded) const
+{
+	TArray<FSoftObjectPath> Assets;
+	GetTeamColorsAssets(TeamColorsId, EHAAssetBundle::Game, Assets);
+	if (WantsCosmetics(WorldContextObject))
+	{
+		GetTeamColorsAssets(TeamColorsId, EHAAssetBundle::Client, Assets);
+	}
+	return LoadAssets(MoveTemp(Assets), MoveTemp(OnLoaded), TeamColors.GetName(TeamColorsId).ToString());
+}
+
+TSharedPtr<FStreamableHandle> UHADataRegistry::LoadAssets(TArray<FSoftObjectPath>&& Assets, FStreamableDelegate OnLoaded, const FString& DebugName)
+{
+	if (Assets.Num() == 0)
+	{
+		OnLoaded.ExecuteIfBound();
+		return nullptr;
+	}
+
+	// The streamable manager may defer the callback of a finished request to the next frame, resident assets
+	// are applied right away instead so freshly spawned actors never show up without them
+	const bool bResident = !Assets.ContainsByPredicate([](const FSoftObjectPath& Asset) { return Asset.ResolveObject() == nullptr; });
+	TSharedPtr<FStreamableHandle> Handle = UAssetManager::GetStreamableManager().RequestAsyncLoad(MoveTemp(Assets), bResident ? FStreamableDelegate() : OnLoaded, FStreamableManager::AsyncLoadHighPriority, false, false, DebugName);
+	if (bResident)
+	{
+		OnLoaded.ExecuteIfBound();
+	}
+	return Handle;
+}
+
+void UHADataRegistry::OnWorldInitializedActors(const UWorld::FActorsInitializedParams& Params)
+{
+	UWorld* World = Params.World;
+	if (World == nullptr || !World->IsGameWorld() || World->GetGameInstance() != GetGameInstance()) return;
+
+	TSet<int32> WeaponIds;
+	TSet<int32> AmmoPickupIds;
+	for (TActorIterator<ABaseWeapon> It(World); It; ++It)
+	{
+		WeaponIds.Add(Weapons.FindId(It->GetWeaponName()));
+	}
+	for (TActorIterator<AAmmoPickup> It(World); It; ++It)
+	{
+		AmmoPickupIds.Add(AmmoPickups.FindId(It->AmmoName));
+	}
+	if (TActorIterator<ALootBox>(World))
+	{
+		for (int32 LootId = 0; LootId < Loot.Num(); ++LootId)
+		{
+			switch (Loot.Get(LootId).PickupType)
+			{
+			case EPickupTypes::EPT_Weapon:
+				WeaponIds.Add(LootPickupIds[LootId]);
+				break;
+			case EPickupTypes::EPT_Ammo:
+				AmmoPickupIds.Add(LootPickupIds[LootId]);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	const bool bCosmetics = WantsCosmetics(World);
+	TArray<FSoftObjectPath> Assets;
+	for (const int32 WeaponId : WeaponIds)
+	{
+		if (!Weapons.IsValidId(WeaponId)) continue;
+
+		GetWeaponStats(WeaponId, GetAllAttachmentsMask(WeaponId));
+		GetWeaponAssets(WeaponId, EHAAssetBundle::Game, Assets);
+		if (bCosmetics)
+		{
+			GetWeaponAssets(WeaponId, EHAAssetBundle::Client, Assets);
+		}
+	}
+	for (const int32 AmmoPickupId : AmmoPickupIds)
+	{
+		GetAmmoPickupAssets(AmmoPickupId, EHAAssetBundle::Game, Assets);
+		if (bCosmetics)
+		{
+			GetAmmoPickupAssets(AmmoPickupId, EHAAssetBundle::Client, Assets);
+		}
+	}
+	if (bCosmetics)
+	{
+		for (int32 TeamColorsId = 0; TeamColorsId < TeamColors.Num(); ++TeamColorsId)
+		{
+			GetTeamColorsAssets(TeamColorsId, EHAAssetBundle::Client, Assets);
+		}
+	}
+
+	// Requested before the previous world's handle is released, so assets both worlds use stay loaded
+	const int32 NumAssets = Assets.Num();
+	const double StartTime = FPlatformTime::Seconds();
+	const FString MapName = World->GetMapName();
+	WorldPreloadHandle = LoadAssets(MoveTemp(Assets), FStreamableDelegate::CreateWeakLambda(this, [NumAssets, StartTime, MapName]()
+	{
+		UE_LOG(LogTemp, Log, TEXT("Preloaded %d assets for %s in %.1f ms"), NumAssets, *MapName, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+	}), World->GetMapName());
+}
+
+#if WITH_EDITOR
+void UHADataRegistry::OnTableChanged()
+{
+	BuildIndices();
+
+	// Weapons hold on to the stats of the old rows until their handle is applied again
+	if (UWorld* World = GetGameInstance()->GetWorld())
+	{
+		for (TActorIterator<ABaseWeapon> It(World); It; ++It)
+		{
+			It->OnWeaponTableChanged();
+		}
+	}
+}
+#endif
@@ -0,0 +1,319 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/HAFXSubsystem.h"
+#include "Particles/ParticleSystem.h"
+#include "Particles/ParticleSystemComponent.h"
+#include "Sound/SoundBase.h"
+#include "Kismet/GameplayStatics.h"
+#include "GameFramework/PlayerController.h"
+#include "Engine/Engine.h"
+#include "HexArena/HexArena.h"
+
+DECLARE_CYCLE_STAT(TEXT("Flush Impacts"), STAT_HAFXFlush, STATGROUP_HAFX);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Impacts Requested"), STAT_HAFXImpactsRequested, STATGROUP_HAFX);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Impact Emitters Played"), STAT_HAFXEmittersPlayed, STATGROUP_HAFX);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Impact Sounds Played"), STAT_HAFXSoundsPlayed, STATGROUP_HAFX);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Impacts Coalesced"), STAT_HAFXCoalesced, STATGROUP_HAFX);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Impacts Culled"), STAT_HAFXCulled, STATGROUP_HAFX);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Impacts Over Budget"), STAT_HAFXOverBudget, STATGROUP_HAFX);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Impact Emitters Spawned"), STAT_HAFXEmittersSpawned, STATGROUP_HAFX);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Tracers Over Budget"), STAT_HAFXTracersOverBudget, STATGROUP_HAFX);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Live Tracers"), STAT_HAFXLiveTracers, STATGROUP_HAFX);
+
+static TAutoConsoleVariable<int32> CVarFXMaxEmittersPerFrame(
+	TEXT("HA.FX.MaxEmittersPerFrame"),
+	8,
+	TEXT("Impact emitters played per frame, the nearest impacts go first"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarFXMaxSoundsPerFrame(
+	TEXT("HA.FX.MaxSoundsPerFrame"),
+	6,
+	TEXT("Impact sounds played per frame, the nearest impacts go first"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarFXCullDistance(
+	TEXT("HA.FX.CullDistance"),
+	8000.f,
+	TEXT("Impact emitters further than this from the view are dropped, sounds use their attenuation distance"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarFXCoalesceRadius(
+	TEXT("HA.FX.CoalesceRadius"),
+	50.f,
+	TEXT("Impacts of the same effect this close to one played in the same frame are merged into it"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarFXMaxTracers(
+	TEXT("HA.FX.MaxTracers"),
+	128,
+	TEXT("Most tracers alive at once, rounds fired past it fly without one"),
+	ECVF_Default);
+
+void FHAFXTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Target && TickType != LEVELTICK_ViewportsOnly)
+	{
+		Target->FlushImpacts();
+	}
+}
+
+FString FHAFXTickFunction::DiagnosticMessage()
+{
+	return TEXT("FHAFXTickFunction[FlushImpacts]");
+}
+
+bool UHAFXSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+#if !WITH_COSMETICS
+	return false;
+#else
+	return Super::ShouldCreateSubsystem(Outer) && !IsRunningDedicatedServer();
+#endif
+}
+
+bool UHAFXSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UHAFXSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// Dedicated servers in PIE share the process with clients, so only the net mode tells them apart
+	if (InWorld.GetNetMode() == NM_DedicatedServer) return;
+	bEnabled = true;
+
+	// After every actor and bullet of the frame had the chance to hit something
+	FlushTickFunction.bCanEverTick = true;
+	FlushTickFunction.bStartWithTickEnabled = true;
+	FlushTickFunction.TickGroup = TG_PostUpdateWork;
+	FlushTickFunction.Target = this;
+	FlushTickFunction.RegisterTickFunction(InWorld.PersistentLevel);
+}
+
+void UHAFXSubsystem::Deinitialize()
+{
+	if (FlushTickFunction.IsTickFunctionRegistered())
+	{
+		FlushTickFunction.UnRegisterTickFunction();
+	}
+
+	DEC_DWORD_STAT_BY(STAT_HAFXLiveTracers, NumLiveTracers);
+	NumLiveTracers = 0;
+	bEnabled = false;
+	PendingImpacts.Empty();
+	PlayedImpacts.Empty();
+	FreeEmitters.Empty();
+	FreeTracers.Empty();
+
+	Super::Deinitialize();
+}
+
+UHAFXSubsystem* UHAFXSubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull);
+	UHAFXSubsystem* FXSubsystem = World ? World->GetSubsystem<UHAFXSubsystem>() : nullptr;
+	return FXSubsystem && FXSubsystem->bEnabled ? FXSubsystem : nullptr;
+}
+
+void UHAFXSubsystem::PlayImpact(UParticleSystem* Particles, USoundBase* Sound, const FTransform& Transform)
+{
+	if (Particles == nullptr && Sound == nullptr) return;
+
+	INC_DWORD_STAT(STAT_HAFXImpactsRequested);
+	FImpactRequest& Request = PendingImpacts.AddDefaulted_GetRef();
+	Request.Particles = Particles;
+	Request.Sound = Sound;
+	Request.Transform = Transform;
+}
+
+void UHAFXSubsystem::FlushImpacts()
+{
+	if (PendingImpacts.Num() == 0) return;
+
+	SCOPE_CYCLE_COUNTER(STAT_HAFXFlush);
+
+	FVector ViewLocation;
+	const bool bHasView = GetViewLocation(ViewLocation);
+	for (FImpactRequest& Request : PendingImpacts)
+	{
+		Request.DistanceSquared = bHasView ? FVector::DistSquared(ViewLocation, Request.Transform.GetLocation()) : 0.f;
+	}
+	PendingImpacts.Sort([](const FImpactRequest& A, const FImpactRequest& B) { return A.DistanceSquared < B.DistanceSquared; });
+
+	const float CullDistanceSquared = FMath::Square(CVarFXCullDistance.GetValueOnGameThread());
+	const float CoalesceRadiusSquared = FMath::Square(CVarFXCoalesceRadius.GetValueOnGameThread());
+	int32 EmittersLeft = CVarFXMaxEmittersPerFrame.GetValueOnGameThread();
+	int32 SoundsLeft = CVarFXMaxSoundsPerFrame.GetValueOnGameThread();
+
+	PlayedImpacts.Reset();
+	for (const FImpactRequest& Request : PendingImpacts)
+	{
+		const FVector Location = Request.Transform.GetLocation();
+
+		bool bParticlesCoalesced = false;
+		bool bSoundCoalesced = false;
+		for (const FImpactRequest& Played : PlayedImpacts)
+		{
+			if (FVector::DistSquared(Played.Transform.GetLocation(), Location) > CoalesceRadiusSquared) continue;
+
+			bParticlesCoalesced |= Request.Particles && Played.Particles == Request.Particles;
+			bSoundCoalesced |= Request.Sound && Played.Sound == Request.Sound;
+		}
+
+		FImpactRequest Played;
+		Played.Transform = Request.Transform;
+
+		if (Request.Particles)
+		{
+			if (bParticlesCoalesced)
+			{
+				INC_DWORD_STAT(STAT_HAFXCoalesced);
+			}
+			else if (Request.DistanceSquared > CullDistanceSquared)
+			{
+				INC_DWORD_STAT(STAT_HAFXCulled);
+			}
+			else if (EmittersLeft <= 0)
+			{
+				INC_DWORD_STAT(STAT_HAFXOverBudget);
+			}
+			else if (AcquireEmitter(Request.Particles, Request.Transform))
+			{
+				INC_DWORD_STAT(STAT_HAFXEmittersPlayed);
+				--EmittersLeft;
+				Played.Particles = Request.Particles;
+			}
+		}
+
+		if (Request.Sound)
+		{
+			if (bSoundCoalesced)
+			{
+				INC_DWORD_STAT(STAT_HAFXCoalesced);
+			}
+			else if (Request.DistanceSquared > FMath::Square(Request.Sound->GetMaxDistance()))
+			{
+				INC_DWORD_STAT(STAT_HAFXCulled);
+			}
+			else if (SoundsLeft <= 0)
+			{
+				INC_DWORD_STAT(STAT_HAFXOverBudget);
+			}
+			else
+			{
+				INC_DWORD_STAT(STAT_HAFXSoundsPlayed);
+				--SoundsLeft;
+				UGameplayStatics::PlaySoundAtLocation(this, Request.Sound, Location);
+				Played.Sound = Request.Sound;
+			}
+		}
+
+		if (Played.Particles || Played.Sound)
+		{
+			PlayedImpacts.Add(Played);
+		}
+	}
+
+	// Impacts are only worth showing the frame they happen, nothing carries over
+	PendingImpacts.Reset();
+}
+
+UParticleSystemComponent* UHAFXSubsystem::AcquireTracer(UParticleSystem* Template, const FVector& Location, const FRotator& Rotation)
+{
+	if (Template == nullptr) return nullptr;
+	if (NumLiveTracers >= CVarFXMaxTracers.GetValueOnGameThread())
+	{
+		INC_DWORD_STAT(STAT_HAFXTracersOverBudget);
+		return nullptr;
+	}
+
+	UParticleSystemComponent* TracerComponent = nullptr;
+	while (FreeTracers.Num() > 0 && TracerComponent == nullptr)
+	{
+		TracerComponent = FreeTracers.Pop(false);
+		if (!IsValid(TracerComponent))
+		{
+			TracerComponent = nullptr;
+			continue;
+		}
+
+		if (TracerComponent->Template != Template)
+		{
+			TracerComponent->SetTemplate(Template);
+		}
+		TracerComponent->SetWorldLocationAndRotation(Location, Rotation);
+		TracerComponent->Activate(true);
+	}
+
+	if (TracerComponent == nullptr)
+	{
+		TracerComponent = UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), Template, Location, Rotation, FVector(1.f), false);
+	}
+
+	if (TracerComponent)
+	{
+		++NumLiveTracers;
+		INC_DWORD_STAT(STAT_HAFXLiveTracers);
+	}
+	return TracerComponent;
+}
+
+void UHAFXSubsystem::ReleaseTracer(UParticleSystemComponent* TracerComponent)
+{
+	if (!IsValid(TracerComponent)) return;
+
+	--NumLiveTracers;
+	DEC_DWORD_STAT(STAT_HAFXLiveTracers);
+
+	// Projectile actors attach their tracer
+	TracerComponent->DetachFromComponent(FDetachmentTransformRules::KeepWorldTransform);
+	TracerComponent->DeactivateImmediate();
+	FreeTracers.Add(TracerComponent);
+}
+
+UParticleSystemComponent* UHAFXSubsystem::AcquireEmitter(UParticleSystem* Template, const FTransform& Transform)
+{
+	while (FreeEmitters.Num() > 0)
+	{
+		UParticleSystemComponent* EmitterComponent = FreeEmitters.Pop(false);
+		if (!IsValid(EmitterComponent)) continue;
+
+		if (EmitterComponent->Template != Template)
+		{
+			EmitterComponent->SetTemplate(Template);
+		}
+		EmitterComponent->SetWorldTransform(Transform);
+		EmitterComponent->Activate(true);
+		return EmitterComponent;
+	}
+
+	UParticleSystemComponent* EmitterComponent = UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), Template, Transform, false);
+	if (EmitterComponent)
+	{
+		INC_DWORD_STAT(STAT_HAFXEmittersSpawned);
+		EmitterComponent->OnSystemFinished.AddDynamic(this, &UHAFXSubsystem::OnEmitterFinished);
+	}
+	return EmitterComponent;
+}
+
+void UHAFXSubsystem::OnEmitterFinished(UParticleSystemComponent* EmitterComponent)
+{
+	if (bEnabled && IsValid(EmitterComponent))
+	{
+		FreeEmitters.Add(EmitterComponent);
+	}
+}
+
+bool UHAFXSubsystem::GetViewLocation(FVector& OutViewLocation) const
+{
+	const APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	if (PlayerController == nullptr) return false;
+
+	FRotator ViewRotation;
+	PlayerController->GetPlayerViewPoint(OutViewLocation, ViewRotation);
+	return true;
+}
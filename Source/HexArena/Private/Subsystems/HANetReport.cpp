@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Weapon/Projectile.h"
+#include "Engine/NetDriver.h"
+#include "Engine/NetConnection.h"
+#include "Engine/ActorChannel.h"
+
+/**
+ * Net report
+ * Logs open actor channels and bandwidth of every client connection, run on the server while clients play.
+ * Compare runs of the same map and client count to see what a replication change saved.
+ */
+
+namespace HANetReport
+{
+	static void Execute(UWorld* World)
+	{
+		const UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+		if (NetDriver == nullptr || World->GetNetMode() == NM_Client) return;
+
+		int32 TotalChannels = 0;
+		int32 TotalOutBytesPerSecond = 0;
+		for (UNetConnection* Connection : NetDriver->ClientConnections)
+		{
+			if (Connection == nullptr) continue;
+
+			int32 NumProjectileChannels = 0;
+			for (const auto& ChannelPair : Connection->ActorChannelMap())
+			{
+				if (ChannelPair.Key.IsValid() && ChannelPair.Key->IsA<AProjectile>())
+				{
+					++NumProjectileChannels;
+				}
+			}
+
+			UE_LOG(LogTemp, Display, TEXT("NetReport %s: %d actor channels, %d of them projectiles, %d out bytes/s, %d in bytes/s"),
+				*Connection->LowLevelGetRemoteAddress(true),
+				Connection->ActorChannelsNum(),
+				NumProjectileChannels,
+				Connection->OutBytesPerSecond,
+				Connection->InBytesPerSecond);
+
+			TotalChannels += Connection->ActorChannelsNum();
+			TotalOutBytesPerSecond += Connection->OutBytesPerSecond;
+		}
+
+		const int32 NumClients = FMath::Max(NetDriver->ClientConnections.Num(), 1);
+		UE_LOG(LogTemp, Display, TEXT("NetReport %d clients, %.1f actor channels and %.0f out bytes/s per client"),
+			NetDriver->ClientConnections.Num(),
+			static_cast<float>(TotalChannels) / NumClients,
+			static_cast<float>(TotalOutBytesPerSecond) / NumClients);
+	}
+}
+
+static FAutoConsoleCommandWithWorld NetReportCommand(
+	TEXT("HA.Net.Report"),
+	TEXT("Logs actor channel count, projectile channels and bytes per second of every client connection"),
+	FConsoleCommandWithWorldDelegate::CreateStatic(&HANetReport::Execute),
+	ECVF_Cheat);
@@ -0,0 +1,172 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/HAProjectilePoolSubsystem.h"
+#include "Weapon/Projectile.h"
+#include "EngineUtils.h"
+#include "HexArena/HexArena.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile Pool Hits"), STAT_HAProjectilePoolHits, STATGROUP_HAPools);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile Pool Misses"), STAT_HAProjectilePoolMisses, STATGROUP_HAPools);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Projectiles"), STAT_HAProjectilePoolSize, STATGROUP_HAPools);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Projectiles In Flight"), STAT_HAProjectilePoolInFlight, STATGROUP_HAPools);
+
+static TAutoConsoleVariable<int32> CVarProjectilePoolEnabled(
+	TEXT("HA.ProjectilePool.Enabled"),
+	1,
+	TEXT("Reuse projectiles instead of spawning one per round.\n0: off, 1: on"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarProjectilePoolMaxPerClass(
+	TEXT("HA.ProjectilePool.MaxPerClass"),
+	256,
+	TEXT("Most projectiles of one class kept alive, released projectiles over it are destroyed"),
+	ECVF_Default);
+
+static FAutoConsoleCommandWithWorld ProjectilePoolDumpCommand(
+	TEXT("HA.ProjectilePool.Dump"),
+	TEXT("Logs pool sizes, lifetime hits and misses and the number of projectile actors in the world"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const UHAProjectilePoolSubsystem* Pool = World ? World->GetSubsystem<UHAProjectilePoolSubsystem>() : nullptr)
+		{
+			Pool->DumpStats();
+		}
+	}));
+
+bool UHAProjectilePoolSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UHAProjectilePoolSubsystem::Deinitialize()
+{
+	for (const auto& PoolPair : Pools)
+	{
+		DEC_DWORD_STAT_BY(STAT_HAProjectilePoolSize, PoolPair.Value.NumSpawned);
+		DEC_DWORD_STAT_BY(STAT_HAProjectilePoolInFlight, PoolPair.Value.NumSpawned - PoolPair.Value.Free.Num());
+	}
+	Pools.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UHAProjectilePoolSubsystem::CanPool(TSubclassOf<AProjectile> ProjectileClass)
+{
+	return ProjectileClass != nullptr && CVarProjectilePoolEnabled.GetValueOnGameThread() != 0;
+}
+
+AProjectile* UHAProjectilePoolSubsystem::SpawnLocalProjectile(UClass* ProjectileClass, const FTransform& Transform, AActor* Owner, APawn* Instigator)
+{
+	AProjectile* Projectile = GetWorld()->SpawnActorDeferred<AProjectile>(ProjectileClass, Transform, Owner, Instigator, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+	if (Projectile == nullptr) return nullptr;
+
+	// Shots reach clients as fire events, classes set to replicate in the editor would open an actor channel per round
+	Projectile->SetReplicates(false);
+	Projectile->FinishSpawning(Transform);
+	return Projectile;
+}
+
+AProjectile* UHAProjectilePoolSubsystem::SpawnPooledProjectile(UClass* ProjectileClass, FProjectilePool& Pool)
+{
+	AProjectile* Projectile = SpawnLocalProjectile(ProjectileClass, FTransform::Identity, nullptr, nullptr);
+	if (Projectile == nullptr) return nullptr;
+
+	Projectile->SetPooled(true);
+	++Pool.NumSpawned;
+	INC_DWORD_STAT(STAT_HAProjectilePoolSize);
+	return Projectile;
+}
+
+void UHAProjectilePoolSubsystem::Prewarm(TSubclassOf<AProjectile> ProjectileClass, int32 Count)
+{
+	if (!CanPool(ProjectileClass)) return;
+
+	FProjectilePool& Pool = Pools.FindOrAdd(ProjectileClass);
+	Count = FMath::Min(Count, CVarProjectilePoolMaxPerClass.GetValueOnGameThread());
+	while (Pool.NumSpawned < Count)
+	{
+		AProjectile* Projectile = SpawnPooledProjectile(ProjectileClass, Pool);
+		if (Projectile == nullptr) return;
+
+		Projectile->DeactivateToPool();
+		Pool.Free.Add(Projectile);
+	}
+}
+
+AProjectile* UHAProjectilePoolSubsystem::AcquireProjectile(TSubclassOf<AProjectile> ProjectileClass, const FTransform& Transform, AActor* Owner, APawn* Instigator)
+{
+	if (ProjectileClass == nullptr) return nullptr;
+
+	if (!CanPool(ProjectileClass))
+	{
+		return SpawnLocalProjectile(ProjectileClass, Transform, Owner, Instigator);
+	}
+
+	FProjectilePool& Pool = Pools.FindOrAdd(ProjectileClass);
+
+	AProjectile* Projectile = nullptr;
+	while (Projectile == nullptr && Pool.Free.Num() > 0)
+	{
+		// Destroyed from outside, with the level for example
+		Projectile = Pool.Free.Pop(false);
+		if (!IsValid(Projectile))
+		{
+			Projectile = nullptr;
+			--Pool.NumSpawned;
+			DEC_DWORD_STAT(STAT_HAProjectilePoolSize);
+		}
+	}
+
+	if (Projectile)
+	{
+		INC_DWORD_STAT(STAT_HAProjectilePoolHits);
+		++TotalHits;
+	}
+	else
+	{
+		// Pool grows to the high water mark of the match, later rounds are hits
+		INC_DWORD_STAT(STAT_HAProjectilePoolMisses);
+		++TotalMisses;
+		Projectile = SpawnPooledProjectile(ProjectileClass, Pool);
+		if (Projectile == nullptr) return nullptr;
+	}
+
+	INC_DWORD_STAT(STAT_HAProjectilePoolInFlight);
+	Projectile->ActivateFromPool(Transform, Owner, Instigator);
+	return Projectile;
+}
+
+void UHAProjectilePoolSubsystem::ReleaseProjectile(AProjectile* Projectile)
+{
+	if (!IsValid(Projectile) || !Projectile->IsPooled() || Projectile->IsInPool()) return;
+
+	DEC_DWORD_STAT(STAT_HAProjectilePoolInFlight);
+	Projectile->DeactivateToPool();
+
+	FProjectilePool& Pool = Pools.FindOrAdd(Projectile->GetClass());
+	if (Pool.NumSpawned > CVarProjectilePoolMaxPerClass.GetValueOnGameThread())
+	{
+		--Pool.NumSpawned;
+		DEC_DWORD_STAT(STAT_HAProjectilePoolSize);
+		Projectile->SetPooled(false);
+		Projectile->Destroy();
+		return;
+	}
+	Pool.Free.Add(Projectile);
+}
+
+void UHAProjectilePoolSubsystem::DumpStats() const
+{
+	int32 NumProjectileActors = 0;
+	for (TActorIterator<AProjectile> It(GetWorld()); It; ++It)
+	{
+		++NumProjectileActors;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Projectile pool: %lld hits, %lld misses, %d projectile actors in the world"), TotalHits, TotalMisses, NumProjectileActors);
+	for (const auto& PoolPair : Pools)
+	{
+		UE_LOG(LogTemp, Display, TEXT("  %s: %d spawned, %d free"), *GetNameSafe(PoolPair.Key), PoolPair.Value.NumSpawned, PoolPair.Value.Free.Num());
+	}
+}
@@ -0,0 +1,511 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Character/HABaseCharacter.h"
+#include "HAComponents/HitBoxComponent.h"
+#include "HAComponents/HitBoxHistory.h"
+#include "HAComponents/HitBoxTrace.h"
+#include "HAComponents/LagCompensationComponent.h"
+#include "Subsystems/HARewindSubsystem.h"
+#include "Weapon/ShotgunWeapon.h"
+#include "GameFramework/GameModeBase.h"
+#include "Engine/Engine.h"
+#include "HAL/FileManager.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include <atomic>
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * Rewind benchmark
+ * Spawns synthetic characters in a private world, captures their motion with its own UHARewindSubsystem and times
+ * score request confirmation through the lag compensation component. Runs synchronously, so it works on a headless
+ * server started with -nullrhi: -ExecCmds="Automation RunTests HexArena.Rewind.Benchmark; Quit"
+ * HexArena.Rewind.ShotgunBenchmark times the server side of shotgun blasts the same way.
+ */
+
+namespace HARewindBenchmark
+{
+	struct FSettings
+	{
+		int32 NumCharacters = 50;
+		float TickRate = 120.f;
+		int32 NumRequests = 1000;
+		// Sizes the history like the default MaxRecordTime of ULagCompensationComponent
+		float MaxRecordTime = 4.f;
+	};
+
+	struct FOperationTimes
+	{
+		FString Name;
+		TArray<double> Microseconds;
+	};
+
+	struct FReport
+	{
+		FSettings Settings;
+		TArray<FOperationTimes> Operations;
+		SIZE_T BytesPerCharacter = 0;
+		double AllocationsPerTick = 0.0;
+	};
+
+	static double Percentile(TArray<double>& Samples, float Fraction)
+	{
+		if (Samples.Num() == 0) return 0.0;
+		Samples.Sort();
+		return Samples[FMath::Clamp(FMath::FloorToInt((Samples.Num() - 1) * Fraction), 0, Samples.Num() - 1)];
+	}
+
+	static double CyclesToMicroseconds(uint64 Cycles)
+	{
+		return FPlatformTime::ToMilliseconds64(Cycles) * 1000.0;
+	}
+
+	/**
+	 * Forwards to the allocator it wraps and counts the calls that allocate.
+	 * Installed as GMalloc only around the measured code, allocations of other threads in that window are counted too.
+	 */
+	class FCountingMalloc final : public FMalloc
+	{
+	public:
+		explicit FCountingMalloc(FMalloc* InInner) : Inner(InInner) {}
+
+		virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+		{
+			++NumAllocations;
+			return Inner->Malloc(Count, Alignment);
+		}
+
+		virtual void* TryMalloc(SIZE_T Count, uint32 Alignment) override
+		{
+			++NumAllocations;
+			return Inner->TryMalloc(Count, Alignment);
+		}
+
+		virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			// Realloc to zero frees
+			if (Count > 0)
+			{
+				++NumAllocations;
+			}
+			return Inner->Realloc(Original, Count, Alignment);
+		}
+
+		virtual void Free(void* Original) override { Inner->Free(Original); }
+		virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return Inner->QuantizeSize(Count, Alignment); }
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+		virtual void Trim(bool bTrimThreadCaches) override { Inner->Trim(bTrimThreadCaches); }
+		virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+		virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+		virtual const TCHAR* GetDescriptiveName() override { return Inner->GetDescriptiveName(); }
+
+		FORCEINLINE int64 GetNumAllocations() const { return NumAllocations.load(); }
+		FORCEINLINE FMalloc* GetInner() const { return Inner; }
+
+	private:
+		FMalloc* Inner;
+		std::atomic<int64> NumAllocations{ 0 };
+	};
+
+	// The pawn of a running match has its hit boxes on the real skeleton, the native class keeps them all at the root
+	static UClass* FindCharacterClass()
+	{
+		for (const FWorldContext& Context : GEngine->GetWorldContexts())
+		{
+			const UWorld* World = Context.World();
+			const AGameModeBase* GameMode = World ? World->GetAuthGameMode() : nullptr;
+			if (GameMode && GameMode->DefaultPawnClass && GameMode->DefaultPawnClass->IsChildOf(AHABaseCharacter::StaticClass()))
+			{
+				return GameMode->DefaultPawnClass;
+			}
+		}
+		return AHABaseCharacter::StaticClass();
+	}
+
+	/**
+	 * Private game world with its own rewind subsystem, nothing spawned here is captured by a running match
+	 */
+
+	static UWorld* CreateWorld()
+	{
+		UWorld* World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("RewindBenchmark"));
+		FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+		WorldContext.SetCurrentWorld(World);
+		World->InitializeActorsForPlay(FURL());
+		World->BeginPlay();
+		return World;
+	}
+
+	static void DestroyWorld(UWorld* World, const TArray<AHABaseCharacter*>& Characters)
+	{
+		for (AHABaseCharacter* Character : Characters)
+		{
+			Character->Destroy();
+		}
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+	}
+
+	// Characters registered with the rewind subsystem of World, the history sized for TickRate
+	static TArray<AHABaseCharacter*> SpawnCharacters(UWorld* World, int32 NumCharacters, float MaxRecordTime, float TickRate)
+	{
+		TArray<AHABaseCharacter*> Characters;
+		UHARewindSubsystem* RewindSubsystem = World->GetSubsystem<UHARewindSubsystem>();
+		if (RewindSubsystem == nullptr) return Characters;
+
+		// The first registration sizes the history, components would size it for the default record rate
+		UClass* CharacterClass = FindCharacterClass();
+		RewindSubsystem->UnregisterCharacter(RewindSubsystem->RegisterCharacter(CharacterClass->GetDefaultObject<AHABaseCharacter>(), MaxRecordTime, TickRate));
+
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		for (int32 Index = 0; Index < NumCharacters; Index++)
+		{
+			AHABaseCharacter* Character = World->SpawnActor<AHABaseCharacter>(CharacterClass, FTransform::Identity, SpawnParams);
+			if (Character == nullptr) continue;
+
+			if (Character->GetLagCompensation() == nullptr || Character->GetLagCompensation()->GetHistoryEntry() == INDEX_NONE)
+			{
+				Character->Destroy();
+				continue;
+			}
+			Characters.Add(Character);
+		}
+		return Characters;
+	}
+
+	// Walks in a circle and turns with it, every fourth character stands still so idle frame skipping is measured too
+	static void MoveCharacter(AHABaseCharacter* Character, int32 Index, float Time)
+	{
+		const FVector Base(1000.f * (Index % 10), 1000.f * (Index / 10), 50000.f);
+		if (Index % 4 == 3)
+		{
+			Character->SetActorLocationAndRotation(Base, FRotator::ZeroRotator, false, nullptr, ETeleportType::TeleportPhysics);
+			return;
+		}
+
+		const float Angle = Time * (1.f + 0.1f * (Index % 7));
+		const FVector Location = Base + FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.f) * 300.f;
+		Character->SetActorLocationAndRotation(Location, FRotator(0.f, FMath::RadiansToDegrees(Angle) + 90.f, 0.f), false, nullptr, ETeleportType::TeleportPhysics);
+	}
+
+	// Fills the whole history, then keeps going as long again so rings wrap around. Returns allocations per capture
+	static double CaptureHistory(UWorld* World, const TArray<AHABaseCharacter*>& Characters, float TickRate, FOperationTimes* Capture, FOperationTimes* CapturePerCharacter)
+	{
+		UHARewindSubsystem* RewindSubsystem = World->GetSubsystem<UHARewindSubsystem>();
+		const int32 NumTicks = RewindSubsystem->GetHistory().GetCapacity() * 2;
+		const float DeltaTime = 1.f / TickRate;
+
+		FCountingMalloc CountingMalloc(GMalloc);
+		int64 NumAllocations = 0;
+		float Time = 0.f;
+		for (int32 Tick = 0; Tick < NumTicks; Tick++)
+		{
+			// The subsystem captures at most once per record interval of world time
+			Time += DeltaTime;
+			World->TimeSeconds = Time;
+			for (int32 Index = 0; Index < Characters.Num(); Index++)
+			{
+				MoveCharacter(Characters[Index], Index, Time);
+			}
+
+			GMalloc = &CountingMalloc;
+			const int64 AllocationsBefore = CountingMalloc.GetNumAllocations();
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			RewindSubsystem->CaptureFrame();
+			const double TickMicroseconds = CyclesToMicroseconds(FPlatformTime::Cycles64() - StartCycles);
+			NumAllocations += CountingMalloc.GetNumAllocations() - AllocationsBefore;
+			GMalloc = CountingMalloc.GetInner();
+
+			if (Capture) Capture->Microseconds.Add(TickMicroseconds);
+			if (CapturePerCharacter) CapturePerCharacter->Microseconds.Add(TickMicroseconds / Characters.Num());
+		}
+		return static_cast<double>(NumAllocations) / NumTicks;
+	}
+
+	static FReport Run(UWorld* World, const TArray<AHABaseCharacter*>& Characters, const FSettings& Settings)
+	{
+		FReport Report;
+		Report.Settings = Settings;
+		// Operation references below stay valid while the rest is added
+		Report.Operations.Reserve(6);
+
+		const UHARewindSubsystem* RewindSubsystem = World->GetSubsystem<UHARewindSubsystem>();
+		const FHitBoxHistory& History = RewindSubsystem->GetHistory();
+		const int32 NumBoxes = History.GetNumBoxes();
+
+		FOperationTimes& Capture = Report.Operations.Add_GetRef({ TEXT("CaptureFrame"), {} });
+		FOperationTimes& CapturePerCharacter = Report.Operations.Add_GetRef({ TEXT("CaptureEntry"), {} });
+		Report.AllocationsPerTick = CaptureHistory(World, Characters, Settings.TickRate, &Capture, &CapturePerCharacter);
+		Report.BytesPerCharacter = History.GetAllocatedSize() / History.GetNumEntries();
+
+		FOperationTimes& GetFrameToCheck = Report.Operations.Add_GetRef({ TEXT("GetFrameToCheck"), {} });
+		FOperationTimes& InterpBetweenFrames = Report.Operations.Add_GetRef({ TEXT("InterpBetweenFrames"), {} });
+		FOperationTimes& ProjectileConfirmHit = Report.Operations.Add_GetRef({ TEXT("ProjectileConfirmHit"), {} });
+		FOperationTimes& HitScanConfirmHit = Report.Operations.Add_GetRef({ TEXT("HitScanConfirmHit"), {} });
+
+		TArray<FVector3f, TInlineAllocator<32>> Locations;
+		TArray<FQuat4f, TInlineAllocator<32>> Rotations;
+		Locations.SetNumUninitialized(NumBoxes);
+		Rotations.SetNumUninitialized(NumBoxes);
+
+		FHitBoxTracePose Pose;
+		Pose.Locations = Locations.GetData();
+		Pose.Rotations = Rotations.GetData();
+		Pose.NumBoxes = NumBoxes;
+
+		// Fixed seed, runs with the same settings fire the same requests
+		FRandomStream Stream(NumBoxes * 7919 + Settings.NumCharacters);
+		const int32 NewestFrame = RewindSubsystem->GetCurrentFrame();
+		for (int32 Request = 0; Request < Settings.NumRequests; Request++)
+		{
+			const int32 VictimIndex = Stream.RandRange(0, Characters.Num() - 1);
+			AHABaseCharacter* Victim = Characters[VictimIndex];
+			AHABaseCharacter* Shooter = Characters[(VictimIndex + 1) % Characters.Num()];
+			const int32 Entry = Victim->GetLagCompensation()->GetHistoryEntry();
+
+			FRewindFrame RewindFrame;
+			RewindFrame.Frame = NewestFrame - Stream.RandRange(0, History.GetCapacity() - 2);
+			RewindFrame.Alpha = static_cast<uint8>(Stream.RandRange(0, 255));
+
+			uint64 StartCycles = FPlatformTime::Cycles64();
+			const bool bPoseValid = History.GetPoseAtFrame(Entry, RewindFrame.Frame, RewindFrame.GetAlpha(), Locations.GetData(), Rotations.GetData());
+			GetFrameToCheck.Microseconds.Add(CyclesToMicroseconds(FPlatformTime::Cycles64() - StartCycles));
+			if (!bPoseValid) continue;
+			Pose.Extents = History.GetExtents(Entry);
+
+			const int32 OlderFrame = History.FindFrame(Entry, RewindFrame.Frame);
+			const int32 YoungerFrame = FMath::Min(OlderFrame + 1, History.Num(Entry) - 1);
+			StartCycles = FPlatformTime::Cycles64();
+			History.InterpBetweenFrames(Entry, OlderFrame, YoungerFrame, RewindFrame.GetAlpha(), Locations.GetData(), Rotations.GetData());
+			InterpBetweenFrames.Microseconds.Add(CyclesToMicroseconds(FPlatformTime::Cycles64() - StartCycles));
+
+			// Shots from a few meters away aimed at a random box
+			const FVector3f Target = Locations[Stream.RandRange(0, NumBoxes - 1)];
+			const FVector3f Start = Target + FVector3f(Stream.GetUnitVector()) * Stream.FRandRange(500.f, 3000.f);
+
+			// Same path as a projectile score request, with the MaxRecordTime and path settings of the component
+			StartCycles = FPlatformTime::Cycles64();
+			Shooter->GetLagCompensation()->ProjectileServerSideRewind(Victim, FVector(Start), FVector((Target - Start).GetSafeNormal() * 15000.f), RewindFrame);
+			ProjectileConfirmHit.Microseconds.Add(CyclesToMicroseconds(FPlatformTime::Cycles64() - StartCycles));
+
+			FHitBoxTraceResult TraceResult;
+			StartCycles = FPlatformTime::Cycles64();
+			FHitBoxTrace::TraceSegment(Start, Start + (Target - Start) * 1.25f, 0.f, Pose, 0, NumBoxes, TraceResult);
+			HitScanConfirmHit.Microseconds.Add(CyclesToMicroseconds(FPlatformTime::Cycles64() - StartCycles));
+		}
+		return Report;
+	}
+
+	struct FShotgunReport
+	{
+		int32 NumPellets = 0;
+		int32 NumBlasts = 0;
+		// Blasts with at least one pellet on the victim, each sends one score request
+		int32 NumBlastsHit = 0;
+		// What one request per pellet would send
+		int32 NumPelletsHit = 0;
+		TArray<double> ServerMicroseconds;
+	};
+
+	// Blasts at a random victim from a few meters away, reported and confirmed like ShotgunServerScoreRequest does
+	static FShotgunReport RunShotgun(UWorld* World, const TArray<AHABaseCharacter*>& Characters, int32 NumPellets, int32 NumBlasts)
+	{
+		FShotgunReport Report;
+		Report.NumPellets = NumPellets;
+		Report.NumBlasts = NumBlasts;
+
+		UHARewindSubsystem* RewindSubsystem = World->GetSubsystem<UHARewindSubsystem>();
+		const FHitBoxHistory& History = RewindSubsystem->GetHistory();
+		const int32 NumBoxes = History.GetNumBoxes();
+		const AShotgunWeapon* Shotgun = GetDefault<AShotgunWeapon>();
+
+		TArray<FVector3f, TInlineAllocator<32>> Locations;
+		TArray<FQuat4f, TInlineAllocator<32>> Rotations;
+		Locations.SetNumUninitialized(NumBoxes);
+		Rotations.SetNumUninitialized(NumBoxes);
+
+		FHitBoxTracePose Pose;
+		Pose.Locations = Locations.GetData();
+		Pose.Rotations = Rotations.GetData();
+		Pose.NumBoxes = NumBoxes;
+
+		FRandomStream Stream(NumPellets * 7919 + Characters.Num());
+		const int32 NewestFrame = RewindSubsystem->GetCurrentFrame();
+		TArray<FVector, TInlineAllocator<16>> PelletEnds;
+		for (int32 Blast = 0; Blast < NumBlasts; Blast++)
+		{
+			const int32 VictimIndex = Stream.RandRange(0, Characters.Num() - 1);
+			AHABaseCharacter* Victim = Characters[VictimIndex];
+			const int32 Entry = Victim->GetLagCompensation()->GetHistoryEntry();
+
+			FRewindFrame RewindFrame;
+			RewindFrame.Frame = NewestFrame - Stream.RandRange(0, History.GetCapacity() - 2);
+			RewindFrame.Alpha = static_cast<uint8>(Stream.RandRange(0, 255));
+			if (!History.GetPoseAtFrame(Entry, RewindFrame.Frame, RewindFrame.GetAlpha(), Locations.GetData(), Rotations.GetData())) continue;
+			Pose.Extents = History.GetExtents(Entry);
+
+			// Client side, the pellets that hit decide whether the blast is reported at all
+			const FVector Target(Locations[Stream.RandRange(0, NumBoxes - 1)]);
+			const FVector Start = Target + Stream.GetUnitVector() * Stream.FRandRange(300.f, 1500.f);
+			const int32 Seed = Stream.RandRange(0, MAX_int32 - 1);
+			Shotgun->GetPelletTraceEnds(Start, Target, Seed, NumPellets, PelletEnds);
+
+			int32 NumPelletsHit = 0;
+			for (const FVector& PelletEnd : PelletEnds)
+			{
+				FHitBoxTraceResult TraceResult;
+				if (FHitBoxTrace::TraceSegment(FVector3f(Start), FVector3f(PelletEnd), 0.f, Pose, 0, NumBoxes, TraceResult))
+				{
+					++NumPelletsHit;
+				}
+			}
+			if (NumPelletsHit == 0) continue;
+			++Report.NumBlastsHit;
+			Report.NumPelletsHit += NumPelletsHit;
+
+			// Server side, pellets rebuilt from the seed, the victim rewound once and every pellet confirmed against it.
+			// No weapon, so no damage is applied and victims stay the same for every blast
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			FScoreRequest Request;
+			Request.Type = EScoreRequestType::Shotgun;
+			Request.Shooter = Characters[(VictimIndex + 1) % Characters.Num()];
+			Request.HitCharacters.Add(Victim);
+			Request.Entries.Add(Entry);
+			Request.RewindFrames.Add(RewindFrame);
+			Request.TraceStart = Start;
+			Shotgun->GetPelletTraceEnds(Start, Target, Seed, NumPellets, Request.TraceEnds);
+			RewindSubsystem->QueueScoreRequest(MoveTemp(Request));
+			RewindSubsystem->ResolveScoreRequests();
+			Report.ServerMicroseconds.Add(CyclesToMicroseconds(FPlatformTime::Cycles64() - StartCycles));
+		}
+		return Report;
+	}
+
+	static void WriteShotgunReport(FShotgunReport& Report)
+	{
+		const FString Row = FString::Printf(TEXT("%d,%d,%.2f,%.2f,%.3f,%.3f"),
+			Report.NumPellets,
+			Report.NumBlasts,
+			static_cast<double>(Report.NumBlastsHit) / Report.NumBlasts,
+			static_cast<double>(Report.NumPelletsHit) / Report.NumBlasts,
+			Percentile(Report.ServerMicroseconds, 0.5f),
+			Percentile(Report.ServerMicroseconds, 0.99f));
+		UE_LOG(LogTemp, Display, TEXT("ShotgunBenchmark %s"), *Row);
+
+		const FString Csv = TEXT("Pellets,Blasts,ScoreRpcsPerBlast,PerPelletRpcsPerBlast,ServerP50Us,ServerP99Us\n") + Row + TEXT("\n");
+		const FString FileName = FPaths::ProfilingDir() / TEXT("RewindBenchmark") / FString::Printf(TEXT("ShotgunBenchmark-%d-%s.csv"), Report.NumPellets, *FDateTime::Now().ToString());
+		if (FFileHelper::SaveStringToFile(Csv, *FileName))
+		{
+			UE_LOG(LogTemp, Display, TEXT("ShotgunBenchmark written to %s"), *IFileManager::Get().ConvertToAbsolutePathForExternalAppForWrite(*FileName));
+		}
+	}
+
+	static void WriteReport(FReport& Report)
+	{
+		FString Csv = TEXT("Characters,TickRate,Operation,Samples,P50Us,P99Us,BytesPerCharacter,AllocationsPerTick\n");
+		for (FOperationTimes& Operation : Report.Operations)
+		{
+			const FString Row = FString::Printf(TEXT("%d,%.0f,%s,%d,%.3f,%.3f,%llu,%.2f"),
+				Report.Settings.NumCharacters,
+				Report.Settings.TickRate,
+				*Operation.Name,
+				Operation.Microseconds.Num(),
+				Percentile(Operation.Microseconds, 0.5f),
+				Percentile(Operation.Microseconds, 0.99f),
+				static_cast<uint64>(Report.BytesPerCharacter),
+				Report.AllocationsPerTick);
+
+			UE_LOG(LogTemp, Display, TEXT("RewindBenchmark %s"), *Row);
+			Csv += Row + TEXT("\n");
+		}
+
+		const FString FileName = FPaths::ProfilingDir() / TEXT("RewindBenchmark") / FString::Printf(TEXT("RewindBenchmark-%d-%.0fHz-%s.csv"),
+			Report.Settings.NumCharacters, Report.Settings.TickRate, *FDateTime::Now().ToString());
+		if (FFileHelper::SaveStringToFile(Csv, *FileName))
+		{
+			UE_LOG(LogTemp, Display, TEXT("RewindBenchmark written to %s"), *IFileManager::Get().ConvertToAbsolutePathForExternalAppForWrite(*FileName));
+		}
+	}
+}
+
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FHARewindBenchmarkTest, "HexArena.Rewind.Benchmark", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+void FHARewindBenchmarkTest::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	// Player counts and tick rates tracked for regressions, parameters are "Characters TickRate [Requests]"
+	for (const int32 NumCharacters : { 10, 50, 100 })
+	{
+		for (const int32 TickRate : { 30, 60, 120 })
+		{
+			OutBeautifiedNames.Add(FString::Printf(TEXT("%d characters at %d Hz"), NumCharacters, TickRate));
+			OutTestCommands.Add(FString::Printf(TEXT("%d %d"), NumCharacters, TickRate));
+		}
+	}
+}
+
+bool FHARewindBenchmarkTest::RunTest(const FString& Parameters)
+{
+	using namespace HARewindBenchmark;
+
+	TArray<FString> Args;
+	Parameters.ParseIntoArrayWS(Args);
+
+	FSettings Settings;
+	if (Args.IsValidIndex(0)) Settings.NumCharacters = FMath::Max(FCString::Atoi(*Args[0]), 1);
+	if (Args.IsValidIndex(1)) Settings.TickRate = FMath::Max(FCString::Atof(*Args[1]), 1.f);
+	if (Args.IsValidIndex(2)) Settings.NumRequests = FMath::Max(FCString::Atoi(*Args[2]), 1);
+
+	UWorld* World = CreateWorld();
+	const TArray<AHABaseCharacter*> Characters = SpawnCharacters(World, Settings.NumCharacters, Settings.MaxRecordTime, Settings.TickRate);
+	if (TestEqual(TEXT("Every character is registered for rewind"), Characters.Num(), Settings.NumCharacters))
+	{
+		FReport Report = Run(World, Characters, Settings);
+		WriteReport(Report);
+	}
+	DestroyWorld(World, Characters);
+	return true;
+}
+
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FHAShotgunBenchmarkTest, "HexArena.Rewind.ShotgunBenchmark", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+void FHAShotgunBenchmarkTest::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	// Parameters are "Pellets [Blasts]"
+	for (const int32 NumPellets : { 8, 16 })
+	{
+		OutBeautifiedNames.Add(FString::Printf(TEXT("%d pellets"), NumPellets));
+		OutTestCommands.Add(FString::FromInt(NumPellets));
+	}
+}
+
+bool FHAShotgunBenchmarkTest::RunTest(const FString& Parameters)
+{
+	using namespace HARewindBenchmark;
+
+	TArray<FString> Args;
+	Parameters.ParseIntoArrayWS(Args);
+	const int32 NumPellets = Args.IsValidIndex(0) ? FMath::Clamp(FCString::Atoi(*Args[0]), 1, 255) : 8;
+	const int32 NumBlasts = Args.IsValidIndex(1) ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 1000;
+
+	FSettings Settings;
+	Settings.NumCharacters = 10;
+
+	UWorld* World = CreateWorld();
+	const TArray<AHABaseCharacter*> Characters = SpawnCharacters(World, Settings.NumCharacters, Settings.MaxRecordTime, Settings.TickRate);
+	if (TestEqual(TEXT("Every character is registered for rewind"), Characters.Num(), Settings.NumCharacters))
+	{
+		CaptureHistory(World, Characters, Settings.TickRate, nullptr, nullptr);
+		FShotgunReport Report = RunShotgun(World, Characters, NumPellets, NumBlasts);
+		TestTrue(TEXT("Blasts hit their victims"), Report.NumBlastsHit > 0);
+		WriteShotgunReport(Report);
+	}
+	DestroyWorld(World, Characters);
+	return true;
+}
+
+#endif
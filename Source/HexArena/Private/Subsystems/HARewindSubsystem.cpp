@@ -0,0 +1,453 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/HARewindSubsystem.h"
+#include "Character/HABaseCharacter.h"
+#include "HAComponents/LagCompensationComponent.h"
+#include "HAComponents/HitBoxTrace.h"
+#include "Weapon/BaseWeapon.h"
+#include "Engine/NetDriver.h"
+#include "Async/ParallelFor.h"
+#include "Kismet/GameplayStatics.h"
+#include "HexArena/HexArena.h"
+
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Compression Location Error"), STAT_HARewindLocationError, STATGROUP_HARewind);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Compression Angle Error"), STAT_HARewindAngleError, STATGROUP_HARewind);
+DECLARE_CYCLE_STAT(TEXT("Resolve Score Requests"), STAT_HARewindResolve, STATGROUP_HARewind);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Score Request Queue Depth"), STAT_HARewindQueueDepth, STATGROUP_HARewind);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Score Requests Resolved"), STAT_HARewindResolved, STATGROUP_HARewind);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Score Requests Carried Over"), STAT_HARewindCarriedOver, STATGROUP_HARewind);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Score Request Latency (ms)"), STAT_HARewindResolveLatency, STATGROUP_HARewind);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pose Cache Hits"), STAT_HARewindPoseCacheHits, STATGROUP_HARewind);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pose Cache Misses"), STAT_HARewindPoseCacheMisses, STATGROUP_HARewind);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Pose Cache Hit Rate (%)"), STAT_HARewindPoseCacheHitRate, STATGROUP_HARewind);
+
+static TAutoConsoleVariable<float> CVarRewindMoveThreshold(
+	TEXT("HA.Rewind.MoveThreshold"),
+	0.5f,
+	TEXT("Characters whose hit boxes moved less than this many cm since the last stored frame do not store a new one.\n0: store every frame"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarRewindResolveBudget(
+	TEXT("HA.Rewind.ResolveBudgetMs"),
+	2.f,
+	TEXT("Game thread time per tick spent confirming score requests, the rest is carried over to the next tick.\n0: no budget"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarRewindValidateCompression(
+	TEXT("HA.Rewind.ValidateCompression"),
+	0,
+	TEXT("Compare every captured frame with the live hit boxes and log reconstruction errors above the quantization bounds.\n0: off, 1: on"),
+	ECVF_Cheat);
+
+void FHARewindTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Target && TickType != LEVELTICK_ViewportsOnly)
+	{
+		// Requests are checked against the history before this frame is added to it
+		Target->ResolveScoreRequests();
+		Target->CaptureFrame();
+	}
+}
+
+FString FHARewindTickFunction::DiagnosticMessage()
+{
+	return TEXT("FHARewindTickFunction[CaptureFrame]");
+}
+
+bool UHARewindSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UHARewindSubsystem::Deinitialize()
+{
+	if (CaptureTickFunction.IsTickFunctionRegistered())
+	{
+		CaptureTickFunction.UnRegisterTickFunction();
+	}
+	Characters.Empty();
+	FreeEntries.Empty();
+	ScoreRequests.Empty();
+	ScoreHits.Empty();
+	PoseIndexByKey.Empty();
+	CachedPoses.Empty();
+	CachedLocations.Empty();
+	CachedRotations.Empty();
+
+	Super::Deinitialize();
+}
+
+void UHARewindSubsystem::InitHistory(int32 NumBoxes, float MaxRecordTime, float RecordRate)
+{
+	if (RecordRate <= 0.f)
+	{
+		const UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+		RecordRate = NetDriver && NetDriver->NetServerMaxTickRate > 0 ? NetDriver->NetServerMaxTickRate : 120.f;
+	}
+	// Small tolerance so frame time jitter at the max tick rate does not skip frames
+	MinRecordInterval = 0.9f / RecordRate;
+
+	History.Init(FMath::CeilToInt(MaxRecordTime * RecordRate) + 1, NumBoxes);
+
+	// Runs after animation and physics finalized the pose of every character
+	CaptureTickFunction.bCanEverTick = true;
+	CaptureTickFunction.bStartWithTickEnabled = true;
+	CaptureTickFunction.TickGroup = TG_PostUpdateWork;
+	CaptureTickFunction.Target = this;
+	CaptureTickFunction.RegisterTickFunction(GetWorld()->PersistentLevel);
+
+	bHistoryInitialized = true;
+}
+
+int32 UHARewindSubsystem::RegisterCharacter(AHABaseCharacter* Character, float MaxRecordTime, float RecordRate)
+{
+	if (Character == nullptr) return INDEX_NONE;
+
+	if (!bHistoryInitialized)
+	{
+		InitHistory(Character->HitBoxArray.Num(), MaxRecordTime, RecordRate);
+	}
+	if (Character->HitBoxArray.Num() != History.GetNumBoxes())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s has %d hit boxes, rewind history expects %d"), *Character->GetName(), Character->HitBoxArray.Num(), History.GetNumBoxes());
+		return INDEX_NONE;
+	}
+	// Confirmation traces box 0 alone first for headshot priority
+	if (Character->HitBoxArray.Num() == 0 || Character->HitBoxArray[0] == nullptr || Character->HitBoxArray[0]->HitBoxType != EHitBoxType::EHBT_Head)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s does not have its head box first, rewind history expects it there"), *Character->GetName());
+		return INDEX_NONE;
+	}
+
+	int32 Entry;
+	if (FreeEntries.Num() > 0)
+	{
+		Entry = FreeEntries.Pop(false);
+		Characters[Entry] = Character;
+	}
+	else
+	{
+		Entry = Characters.Add(Character);
+		// Grow in chunks so joining players rarely reallocate the table
+		if (Entry >= History.GetNumEntries())
+		{
+			History.SetNumEntries(FMath::Max(History.GetNumEntries() * 2, 16));
+		}
+	}
+
+	History.ResetEntry(Entry, Character->HitBoxArray);
+	return Entry;
+}
+
+void UHARewindSubsystem::UnregisterCharacter(int32 Entry)
+{
+	if (!Characters.IsValidIndex(Entry) || Characters[Entry] == nullptr) return;
+
+	Characters[Entry] = nullptr;
+	FreeEntries.Add(Entry);
+}
+
+void UHARewindSubsystem::CaptureFrame()
+{
+	if (Characters.Num() == FreeEntries.Num()) return;
+
+	const float Time = GetWorld()->GetTimeSeconds();
+	if (Time - LastCaptureTime < MinRecordInterval) return;
+	LastCaptureTime = Time;
+	const int32 Frame = ++CurrentFrame;
+
+	const float MoveThreshold = CVarRewindMoveThreshold.GetValueOnGameThread();
+
+	// Every character writes its own block of the table, nothing else is touched while capturing
+	ParallelFor(Characters.Num(), [this, Frame, MoveThreshold](int32 Entry)
+	{
+		const AHABaseCharacter* Character = Characters[Entry];
+		if (Character == nullptr) return;
+
+		History.CaptureEntry(Entry, Frame, Character->GetActorTransform(), Character->HitBoxArray, MoveThreshold);
+	});
+
+	// Replicated with the pose just captured, clients send it back with their score requests
+	for (AHABaseCharacter* Character : Characters)
+	{
+		if (Character)
+		{
+			Character->SetRewindFrame(Frame);
+		}
+	}
+
+	if (CVarRewindValidateCompression.GetValueOnGameThread() != 0)
+	{
+		ValidateCompression(MoveThreshold);
+	}
+}
+
+void UHARewindSubsystem::ValidateCompression(float MoveThreshold)
+{
+	const int32 NumBoxes = History.GetNumBoxes();
+	TArray<FVector3f, TInlineAllocator<32>> Locations;
+	TArray<FQuat4f, TInlineAllocator<32>> Rotations;
+	Locations.SetNumUninitialized(NumBoxes);
+	Rotations.SetNumUninitialized(NumBoxes);
+
+	// Quantization alone stays well below 0.1 cm and 0.25 deg, still poses add their own tolerance
+	const bool bSkipsStillFrames = MoveThreshold > 0.f;
+	const float MaxLocationError = MoveThreshold + 0.1f;
+	const float MaxAngleError = FMath::DegreesToRadians(bSkipsStillFrames ? 1.5f : 0.25f);
+
+	float WorstLocationError = 0.f;
+	float WorstAngleError = 0.f;
+	for (int32 Entry = 0; Entry < Characters.Num(); Entry++)
+	{
+		const AHABaseCharacter* Character = Characters[Entry];
+		if (Character == nullptr || History.IsEmpty(Entry)) continue;
+
+		History.DecompressFrame(Entry, History.Num(Entry) - 1, Locations.GetData(), Rotations.GetData());
+		for (int32 BoxIndex = 0; BoxIndex < NumBoxes; BoxIndex++)
+		{
+			const UHitBoxComponent* Box = Character->HitBoxArray[BoxIndex];
+			if (Box == nullptr) continue;
+
+			const float LocationError = FVector3f::Dist(Locations[BoxIndex], FVector3f(Box->GetComponentLocation()));
+			const float AngleError = FQuat4f(Box->GetComponentQuat()).AngularDistance(Rotations[BoxIndex]);
+			WorstLocationError = FMath::Max(WorstLocationError, LocationError);
+			WorstAngleError = FMath::Max(WorstAngleError, AngleError);
+
+			if (LocationError > MaxLocationError || AngleError > MaxAngleError)
+			{
+				UE_LOG(LogTemp, Warning, TEXT("Rewind compression error on %s box %d: %f cm, %f deg"), *Character->GetName(), BoxIndex, LocationError, FMath::RadiansToDegrees(AngleError));
+			}
+		}
+	}
+
+	SET_FLOAT_STAT(STAT_HARewindLocationError, WorstLocationError);
+	SET_FLOAT_STAT(STAT_HARewindAngleError, FMath::RadiansToDegrees(WorstAngleError));
+}
+
+void UHARewindSubsystem::QueueScoreRequest(FScoreRequest&& Request)
+{
+	if (Request.HitCharacters.Num() == 0 || Request.Entries.Num() != Request.HitCharacters.Num() || Request.RewindFrames.Num() != Request.HitCharacters.Num()) return;
+
+	Request.QueuedSeconds = FPlatformTime::Seconds();
+	ScoreRequests.Add(MoveTemp(Request));
+}
+
+void UHARewindSubsystem::ResolveScoreRequests()
+{
+	SET_DWORD_STAT(STAT_HARewindQueueDepth, ScoreRequests.Num());
+	if (ScoreRequests.Num() == 0)
+	{
+		SET_DWORD_STAT(STAT_HARewindCarriedOver, 0);
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_HARewindResolve);
+
+	const double BudgetSeconds = CVarRewindResolveBudget.GetValueOnGameThread() / 1000.0;
+	const double StartSeconds = FPlatformTime::Seconds();
+	// Enough requests per batch to keep every worker busy, small enough to stop close to the budget
+	const int32 BatchSize = FMath::Max(FTaskGraphInterface::Get().GetNumWorkerThreads() * 4, 8);
+
+	int32 NumResolved = 0;
+	int32 NumPoseCacheHits = 0;
+	double MaxLatencySeconds = 0.0;
+	while (NumResolved < ScoreRequests.Num())
+	{
+		const int32 BatchStart = NumResolved;
+		const int32 BatchNum = FMath::Min(BatchSize, ScoreRequests.Num() - BatchStart);
+
+		NumPoseCacheHits += CacheRequestPoses(BatchStart, BatchNum);
+
+		ScoreHits.Reset();
+		ScoreHits.SetNum(BatchNum);
+		ParallelFor(BatchNum, [this, BatchStart](int32 Index)
+		{
+			ConfirmScoreRequest(ScoreRequests[BatchStart + Index], ScoreHits[Index]);
+		});
+
+		const double Now = FPlatformTime::Seconds();
+		for (int32 Index = 0; Index < BatchNum; Index++)
+		{
+			const FScoreRequest& Request = ScoreRequests[BatchStart + Index];
+			ApplyScoreHits(Request, ScoreHits[Index]);
+			MaxLatencySeconds = FMath::Max(MaxLatencySeconds, Now - Request.QueuedSeconds);
+		}
+		NumResolved += BatchNum;
+
+		if (BudgetSeconds > 0.0 && FPlatformTime::Seconds() - StartSeconds >= BudgetSeconds) break;
+	}
+
+	ScoreRequests.RemoveAt(0, NumResolved, false);
+
+	const int32 NumPoseLookups = NumPoseCacheHits + CachedPoses.Num();
+	SET_FLOAT_STAT(STAT_HARewindPoseCacheHitRate, NumPoseLookups > 0 ? 100.f * NumPoseCacheHits / NumPoseLookups : 0.f);
+
+	// History moves on with the capture that follows
+	PoseIndexByKey.Reset();
+	CachedPoses.Reset();
+
+	INC_DWORD_STAT_BY(STAT_HARewindResolved, NumResolved);
+	SET_DWORD_STAT(STAT_HARewindCarriedOver, ScoreRequests.Num());
+	SET_FLOAT_STAT(STAT_HARewindResolveLatency, MaxLatencySeconds * 1000.0);
+}
+
+uint64 UHARewindSubsystem::MakePoseKey(int32 Entry, const FRewindFrame& RewindFrame)
+{
+	return (static_cast<uint64>(static_cast<uint32>(Entry)) << 40) | (static_cast<uint64>(static_cast<uint32>(RewindFrame.Frame)) << 8) | RewindFrame.Alpha;
+}
+
+int32 UHARewindSubsystem::CacheRequestPoses(int32 FirstRequest, int32 NumRequests)
+{
+	const int32 FirstNewPose = CachedPoses.Num();
+	int32 NumHits = 0;
+
+	for (int32 RequestIndex = FirstRequest; RequestIndex < FirstRequest + NumRequests; RequestIndex++)
+	{
+		FScoreRequest& Request = ScoreRequests[RequestIndex];
+		Request.PoseIndices.Reset();
+		for (int32 VictimIndex = 0; VictimIndex < Request.Entries.Num(); VictimIndex++)
+		{
+			int32& Entry = Request.Entries[VictimIndex];
+			const FRewindFrame& RewindFrame = Request.RewindFrames[VictimIndex];
+
+			// A carried over request may outlive its victim's registration, the entry can belong to another character by now
+			const AHABaseCharacter* HitCharacter = Request.HitCharacters[VictimIndex].Get();
+			if (HitCharacter == nullptr || HitCharacter->GetLagCompensation() == nullptr || HitCharacter->GetLagCompensation()->GetHistoryEntry() != Entry)
+			{
+				Entry = INDEX_NONE;
+			}
+			if (Entry == INDEX_NONE)
+			{
+				Request.PoseIndices.Add(INDEX_NONE);
+				continue;
+			}
+
+			const uint64 Key = MakePoseKey(Entry, RewindFrame);
+			if (const int32* PoseIndex = PoseIndexByKey.Find(Key))
+			{
+				Request.PoseIndices.Add(*PoseIndex);
+				++NumHits;
+				continue;
+			}
+
+			FCachedPose& Pose = CachedPoses.AddDefaulted_GetRef();
+			Pose.Entry = Entry;
+			Pose.RewindFrame = RewindFrame;
+			Request.PoseIndices.Add(PoseIndexByKey.Add(Key, CachedPoses.Num() - 1));
+		}
+	}
+
+	const int32 NumMisses = CachedPoses.Num() - FirstNewPose;
+	INC_DWORD_STAT_BY(STAT_HARewindPoseCacheHits, NumHits);
+	INC_DWORD_STAT_BY(STAT_HARewindPoseCacheMisses, NumMisses);
+	if (NumMisses == 0) return NumHits;
+
+	// Grows only while the first team fights of the match raise the high water mark, Reset keeps the memory
+	const int32 NumBoxes = History.GetNumBoxes();
+	CachedLocations.SetNumUninitialized(CachedPoses.Num() * NumBoxes, false);
+	CachedRotations.SetNumUninitialized(CachedPoses.Num() * NumBoxes, false);
+
+	ParallelFor(NumMisses, [this, FirstNewPose, NumBoxes](int32 Index)
+	{
+		const int32 PoseIndex = FirstNewPose + Index;
+		FCachedPose& Pose = CachedPoses[PoseIndex];
+		Pose.bValid = History.GetPoseAtFrame(
+			Pose.Entry,
+			Pose.RewindFrame.Frame,
+			Pose.RewindFrame.GetAlpha(),
+			CachedLocations.GetData() + PoseIndex * NumBoxes,
+			CachedRotations.GetData() + PoseIndex * NumBoxes);
+	});
+	return NumHits;
+}
+
+void UHARewindSubsystem::ConfirmScoreRequest(const FScoreRequest& Request, FScoreHits& OutHits) const
+{
+	const int32 NumBoxes = History.GetNumBoxes();
+	FHitBoxTracePose Pose;
+	Pose.NumBoxes = NumBoxes;
+
+	const FVector3f TraceStart(Request.TraceStart);
+
+	// Nearest hit of every trace over all victims, a pellet stops at the first character it hits
+	TArray<float, TInlineAllocator<16>> NearestHitTimes;
+	NearestHitTimes.Init(MAX_flt, FMath::Max(Request.TraceEnds.Num(), 1));
+	OutHits.Init(FScoreHit(), NearestHitTimes.Num());
+
+	for (int32 VictimIndex = 0; VictimIndex < Request.Entries.Num(); VictimIndex++)
+	{
+		const int32 PoseIndex = Request.PoseIndices[VictimIndex];
+		if (PoseIndex == INDEX_NONE || !CachedPoses[PoseIndex].bValid) continue;
+
+		Pose.Locations = CachedLocations.GetData() + PoseIndex * NumBoxes;
+		Pose.Rotations = CachedRotations.GetData() + PoseIndex * NumBoxes;
+		Pose.Extents = History.GetExtents(CachedPoses[PoseIndex].Entry);
+
+		if (Request.Type == EScoreRequestType::Projectile)
+		{
+			// Head box is checked alone first, it wins even if the arc crosses another box before it
+			FHitBoxTraceResult TraceResult;
+			const bool bHit =
+				FHitBoxTrace::TraceBallistic(Request.ProjectileParams, Pose, 0, 1, TraceResult) ||
+				FHitBoxTrace::TraceBallistic(Request.ProjectileParams, Pose, 0, NumBoxes, TraceResult);
+
+			if (bHit && TraceResult.Time < NearestHitTimes[0])
+			{
+				NearestHitTimes[0] = TraceResult.Time;
+				OutHits[0] = { VictimIndex, TraceResult.BoxIndex };
+			}
+			continue;
+		}
+
+		for (int32 TraceIndex = 0; TraceIndex < Request.TraceEnds.Num(); TraceIndex++)
+		{
+			// Full range of the shot the server fired, for the hitscan target and every pellet alike
+			const FVector3f TraceEnd(Request.TraceEnds[TraceIndex]);
+
+			FHitBoxTraceResult TraceResult;
+			if (FHitBoxTrace::TraceSegment(TraceStart, TraceEnd, 0.f, Pose, 0, NumBoxes, TraceResult) && TraceResult.Time < NearestHitTimes[TraceIndex])
+			{
+				NearestHitTimes[TraceIndex] = TraceResult.Time;
+				OutHits[TraceIndex] = { VictimIndex, TraceResult.BoxIndex };
+			}
+		}
+	}
+
+	OutHits.RemoveAllSwap([](const FScoreHit& Hit) { return Hit.VictimIndex == INDEX_NONE; }, false);
+}
+
+void UHARewindSubsystem::ApplyScoreHits(const FScoreRequest& Request, const FScoreHits& Hits)
+{
+	AHABaseCharacter* Shooter = Request.Shooter.Get();
+	ABaseWeapon* Weapon = Request.Weapon.Get();
+	if (Hits.Num() == 0 || Shooter == nullptr || Weapon == nullptr) return;
+
+	// One damage event per victim
+	TArray<float, TInlineAllocator<4>> VictimDamage;
+	VictimDamage.Init(0.f, Request.HitCharacters.Num());
+	for (const FScoreHit& Hit : Hits)
+	{
+		const AHABaseCharacter* HitCharacter = Request.HitCharacters[Hit.VictimIndex].Get();
+		if (HitCharacter == nullptr || !HitCharacter->HitBoxArray.IsValidIndex(Hit.BoxIndex)) continue;
+
+		const UHitBoxComponent* HitBox = HitCharacter->HitBoxArray[Hit.BoxIndex];
+		if (HitBox == nullptr) continue;
+
+		VictimDamage[Hit.VictimIndex] += ULagCompensationComponent::GetHitBoxDamage(Weapon->GetWeaponData(), HitBox->HitBoxType);
+	}
+
+	for (int32 VictimIndex = 0; VictimIndex < VictimDamage.Num(); VictimIndex++)
+	{
+		AHABaseCharacter* HitCharacter = Request.HitCharacters[VictimIndex].Get();
+		if (HitCharacter == nullptr || VictimDamage[VictimIndex] <= 0.f) continue;
+
+		UGameplayStatics::ApplyDamage(
+			HitCharacter,
+			VictimDamage[VictimIndex],
+			Shooter->Controller,
+			Weapon,
+			UDamageType::StaticClass()
+		);
+	}
+}
@@ -0,0 +1,157 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/HAShellSubsystem.h"
+#include "Weapon/BaseWeapon.h"
+#include "Weapon/BulletShell.h"
+#include "Subsystems/HADataRegistry.h"
+#include "Containers/Ticker.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/Pawn.h"
+
+/**
+ * Shell stress test
+ * Synthetic shooters around the local player eject shells at a full auto rate for a few seconds, the way a client sees a full
+ * lobby firing. Game thread time is sampled every frame, the peak of live shells shows how often HA.Shells.MaxLive was hit.
+ */
+
+#if WITH_COSMETICS
+namespace HAShellStress
+{
+	struct FSettings
+	{
+		int32 NumShooters = 32;
+		float Seconds = 10.f;
+		// Shells per second of each shooter
+		float FireRate = 10.f;
+	};
+
+	struct FRun
+	{
+		FSettings Settings;
+		TWeakObjectPtr<UWorld> World;
+		TSubclassOf<ABulletShell> ShellClass;
+		FVector Center = FVector::ZeroVector;
+		FRandomStream Stream;
+		float ElapsedTime = 0.f;
+		float ShellsOwed = 0.f;
+		int32 PeakLive = 0;
+		TArray<double> GameThreadMilliseconds;
+	};
+
+	static TSharedPtr<FRun> ActiveRun;
+
+	static constexpr float WarmupTime = 1.f;
+
+	static double Percentile(TArray<double>& Samples, float Fraction)
+	{
+		if (Samples.Num() == 0) return 0.0;
+		Samples.Sort();
+		return Samples[FMath::Clamp(FMath::FloorToInt((Samples.Num() - 1) * Fraction), 0, Samples.Num() - 1)];
+	}
+
+	// First shell class of the weapon table, the bare class has no mesh to draw
+	static TSubclassOf<ABulletShell> FindShellClass(const UWorld* World)
+	{
+		const UHADataRegistry* Registry = UHADataRegistry::Get(World);
+		if (Registry == nullptr) return ABulletShell::StaticClass();
+
+		for (int32 WeaponId = 0; WeaponId < Registry->GetNumWeapons(); ++WeaponId)
+		{
+			const FWeaponData& Weapon = Registry->GetWeapon(WeaponId);
+			if (!Weapon.BulletShellClass.IsNull())
+			{
+				return Weapon.BulletShellClass.LoadSynchronous();
+			}
+		}
+		return ABulletShell::StaticClass();
+	}
+
+	// Shooters stand on a ring around the center and eject to their right
+	static void EjectShell(FRun& Run, UHAShellSubsystem& Shells, int32 Shooter)
+	{
+		const float Angle = 2.f * PI * Shooter / Run.Settings.NumShooters;
+		const FVector Location = Run.Center + FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.f) * 800.f + FVector(0.f, 0.f, 120.f);
+		const FRotator Rotation(Run.Stream.FRandRange(10.f, 30.f), FMath::RadiansToDegrees(Angle) + 90.f, 0.f);
+		Shells.EjectShell(Run.ShellClass, FTransform(Rotation, Location), FVector::ZeroVector);
+	}
+
+	static bool Tick(float DeltaTime)
+	{
+		TSharedPtr<FRun> Run = ActiveRun;
+		UWorld* World = Run.IsValid() ? Run->World.Get() : nullptr;
+		UHAShellSubsystem* Shells = World ? World->GetSubsystem<UHAShellSubsystem>() : nullptr;
+		if (Shells == nullptr)
+		{
+			ActiveRun.Reset();
+			return false;
+		}
+
+		Run->ElapsedTime += DeltaTime;
+		if (Run->ElapsedTime > WarmupTime)
+		{
+			Run->GameThreadMilliseconds.Add(FPlatformTime::ToMilliseconds(GGameThreadTime));
+		}
+
+		if (Run->ElapsedTime > Run->Settings.Seconds + WarmupTime)
+		{
+			UE_LOG(LogTemp, Display, TEXT("ShellStress Shooters=%d FireRate=%.1f PeakLive=%d Frames=%d P50GameThreadMs=%.3f P99GameThreadMs=%.3f"),
+				Run->Settings.NumShooters,
+				Run->Settings.FireRate,
+				Run->PeakLive,
+				Run->GameThreadMilliseconds.Num(),
+				Percentile(Run->GameThreadMilliseconds, 0.5f),
+				Percentile(Run->GameThreadMilliseconds, 0.99f));
+			ActiveRun.Reset();
+			return false;
+		}
+
+		Run->ShellsOwed += Run->Settings.NumShooters * Run->Settings.FireRate * DeltaTime;
+		const int32 NumShells = FMath::FloorToInt(Run->ShellsOwed);
+		Run->ShellsOwed -= NumShells;
+		for (int32 Shell = 0; Shell < NumShells; ++Shell)
+		{
+			EjectShell(*Run, *Shells, Run->Stream.RandRange(0, Run->Settings.NumShooters - 1));
+		}
+
+		Run->PeakLive = FMath::Max(Run->PeakLive, Shells->GetNumShells());
+		return true;
+	}
+
+	static void Execute(const TArray<FString>& Args, UWorld* World)
+	{
+		if (World == nullptr || World->GetSubsystem<UHAShellSubsystem>() == nullptr) return;
+		if (ActiveRun.IsValid())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("ShellStress already running"));
+			return;
+		}
+
+		FSettings Settings;
+		if (Args.IsValidIndex(0)) Settings.NumShooters = FMath::Max(FCString::Atoi(*Args[0]), 1);
+		if (Args.IsValidIndex(1)) Settings.Seconds = FMath::Max(FCString::Atof(*Args[1]), 1.f);
+		if (Args.IsValidIndex(2)) Settings.FireRate = FMath::Max(FCString::Atof(*Args[2]), 0.1f);
+
+		ActiveRun = MakeShared<FRun>();
+		ActiveRun->Settings = Settings;
+		ActiveRun->World = World;
+		ActiveRun->ShellClass = FindShellClass(World);
+		ActiveRun->Stream.Initialize(Settings.NumShooters * 7919);
+
+		const APlayerController* PlayerController = World->GetFirstPlayerController();
+		if (PlayerController && PlayerController->GetPawn())
+		{
+			ActiveRun->Center = PlayerController->GetPawn()->GetActorLocation();
+		}
+
+		FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&Tick));
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs ShellStressCommand(
+	TEXT("HA.Shells.Stress"),
+	TEXT("Ejects shells from synthetic shooters around the local player and reports game thread frame time percentiles to the log.\n")
+	TEXT("HA.Shells.Stress [Shooters=32] [Seconds=10] [FireRate=10]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&HAShellStress::Execute),
+	ECVF_Cheat);
+#endif
@@ -0,0 +1,386 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/HAShellSubsystem.h"
+#include "Weapon/BulletShell.h"
+#include "HexBlock/HexBlock.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Kismet/GameplayStatics.h"
+#include "Sound/SoundCue.h"
+#include "EngineUtils.h"
+#include "HexArena/HexArena.h"
+
+DECLARE_CYCLE_STAT(TEXT("Simulate Shells"), STAT_HAShellSimulate, STATGROUP_HAPools);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Live Shells"), STAT_HAShellsLive, STATGROUP_HAPools);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shells Recycled Early"), STAT_HAShellsRecycled, STATGROUP_HAPools);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shell Sounds Played"), STAT_HAShellSoundsPlayed, STATGROUP_HAPools);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shell Sounds Dropped"), STAT_HAShellSoundsDropped, STATGROUP_HAPools);
+
+static TAutoConsoleVariable<int32> CVarShellsMaxLive(
+	TEXT("HA.Shells.MaxLive"),
+	256,
+	TEXT("Most shells alive at once, the oldest is reused past it. Read when the world begins play"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarShellsMaxSoundsPerSecond(
+	TEXT("HA.Shells.MaxSoundsPerSecond"),
+	12.f,
+	TEXT("Shell impact sounds allowed per second, impacts past the budget are silent"),
+	ECVF_Default);
+
+#if WITH_COSMETICS
+namespace HAShell
+{
+	// Bounce of a shell hitting the ground
+	static constexpr float Restitution = 0.3f;
+	static constexpr float GroundFriction = 0.5f;
+	// Slower bounces come to rest
+	static constexpr float RestSpeed = 20.f;
+	// Slower impacts make no sound, as the physics shell did
+	static constexpr float MinSoundSpeed = 50.f;
+	// Hex tops this far above a shell still catch it, so a fast shell does not tunnel through in one frame
+	static constexpr float TopTolerance = 20.f;
+}
+#endif
+
+void FHAShellTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Target && TickType != LEVELTICK_ViewportsOnly)
+	{
+		Target->Simulate(DeltaTime);
+	}
+}
+
+FString FHAShellTickFunction::DiagnosticMessage()
+{
+	return TEXT("FHAShellTickFunction[Simulate]");
+}
+
+bool UHAShellSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+#if !WITH_COSMETICS
+	return false;
+#else
+	return Super::ShouldCreateSubsystem(Outer) && !IsRunningDedicatedServer();
+#endif
+}
+
+bool UHAShellSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UHAShellSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+#if WITH_COSMETICS
+	// Dedicated servers in PIE share the process with clients, so only the net mode tells them apart
+	if (InWorld.GetNetMode() == NM_DedicatedServer) return;
+
+	const int32 MaxLive = FMath::Max(CVarShellsMaxLive.GetValueOnGameThread(), 1);
+	Positions.SetNumZeroed(MaxLive);
+	Velocities.SetNumZeroed(MaxLive);
+	Rotations.SetNumZeroed(MaxLive);
+	Spins.SetNumZeroed(MaxLive);
+	Ages.SetNumZeroed(MaxLive);
+	PoolIndices.SetNumZeroed(MaxLive);
+	InstanceSlots.SetNumZeroed(MaxLive);
+	FloorZs.SetNumZeroed(MaxLive);
+	bResting.SetNumZeroed(MaxLive);
+
+	SimulateTickFunction.bCanEverTick = true;
+	SimulateTickFunction.bStartWithTickEnabled = true;
+	SimulateTickFunction.TickGroup = TG_PostPhysics;
+	SimulateTickFunction.Target = this;
+	SimulateTickFunction.RegisterTickFunction(InWorld.PersistentLevel);
+#endif
+}
+
+void UHAShellSubsystem::Deinitialize()
+{
+	if (SimulateTickFunction.IsTickFunctionRegistered())
+	{
+		SimulateTickFunction.UnRegisterTickFunction();
+	}
+
+	DEC_DWORD_STAT_BY(STAT_HAShellsLive, NumShells);
+	NumShells = 0;
+	Pools.Empty();
+	PoolIndexByClass.Empty();
+	HexTops.Empty();
+	HexTopsByCell.Empty();
+
+	Super::Deinitialize();
+}
+
+void UHAShellSubsystem::EjectShell(TSubclassOf<ABulletShell> ShellClass, const FTransform& Transform, const FVector& InheritedVelocity)
+{
+#if WITH_COSMETICS
+	const int32 Capacity = Positions.Num();
+	if (Capacity == 0 || ShellClass == nullptr) return;
+
+	const int32 Pool = FindOrAddPool(ShellClass);
+	if (Pool == INDEX_NONE) return;
+
+	if (!bHexTopsCached)
+	{
+		CacheHexTops();
+	}
+
+	if (NumShells == Capacity)
+	{
+		INC_DWORD_STAT(STAT_HAShellsRecycled);
+		ReleaseShell(Tail);
+		Tail = (Tail + 1) % Capacity;
+		--NumShells;
+		DEC_DWORD_STAT(STAT_HAShellsLive);
+	}
+
+	const int32 Shell = (Tail + NumShells) % Capacity;
+	++NumShells;
+	INC_DWORD_STAT(STAT_HAShellsLive);
+
+	FShellMeshPool& MeshPool = Pools[Pool];
+	int32 Slot = INDEX_NONE;
+	if (MeshPool.FreeSlots.Num() > 0)
+	{
+		Slot = MeshPool.FreeSlots.Pop(false);
+	}
+	else
+	{
+		Slot = MeshPool.Transforms.Add(FTransform::Identity);
+		MeshPool.Instances->AddInstance(FTransform(FQuat::Identity, FVector::ZeroVector, FVector::ZeroVector), true);
+	}
+
+	const FVector Location = Transform.GetLocation();
+	const float Speed = MeshPool.EjectionSpeed * FMath::FRandRange(0.8f, 1.2f);
+	Positions[Shell] = Location;
+	Velocities[Shell] = FVector3f(Transform.GetRotation().GetForwardVector() * Speed + FVector(0.f, 0.f, Speed * 0.5f) + InheritedVelocity);
+	Rotations[Shell] = FQuat4f(Transform.GetRotation());
+	Spins[Shell] = FVector3f(FMath::VRand() * FMath::FRandRange(10.f, 30.f));
+	Ages[Shell] = 0.f;
+	PoolIndices[Shell] = static_cast<uint8>(Pool);
+	InstanceSlots[Shell] = Slot;
+	bResting[Shell] = false;
+
+	// Without hex blocks the floor is whatever is below the muzzle
+	FloorZs[Shell] = FloorZ;
+	if (HexTops.Num() == 0)
+	{
+		FHitResult FloorHit;
+		const FVector TraceEnd = Location - FVector(0.f, 0.f, 1000.f);
+		FloorZs[Shell] = GetWorld()->LineTraceSingleByObjectType(FloorHit, Location, TraceEnd, FCollisionObjectQueryParams(ECC_WorldStatic)) ? FloorHit.ImpactPoint.Z : TraceEnd.Z;
+	}
+#endif
+}
+
+void UHAShellSubsystem::Simulate(float DeltaTime)
+{
+#if WITH_COSMETICS
+	SCOPE_CYCLE_COUNTER(STAT_HAShellSimulate);
+
+	const float MaxSoundsPerSecond = CVarShellsMaxSoundsPerSecond.GetValueOnGameThread();
+	SoundBudget = FMath::Min(SoundBudget + DeltaTime * MaxSoundsPerSecond, MaxSoundsPerSecond);
+
+	if (NumShells == 0) return;
+
+	const int32 Capacity = Positions.Num();
+	for (int32 Index = 0; Index < NumShells; ++Index)
+	{
+		Ages[(Tail + Index) % Capacity] += DeltaTime;
+	}
+
+	// Oldest first, a shell with a longer lifetime holds back younger ones until it expires
+	while (NumShells > 0 && Ages[Tail] >= Pools[PoolIndices[Tail]].LifeTime)
+	{
+		ReleaseShell(Tail);
+		Tail = (Tail + 1) % Capacity;
+		--NumShells;
+		DEC_DWORD_STAT(STAT_HAShellsLive);
+	}
+
+	const float GravityZ = GetWorld()->GetGravityZ();
+	for (int32 Index = 0; Index < NumShells; ++Index)
+	{
+		const int32 Shell = (Tail + Index) % Capacity;
+		const float GroundZ = FMath::Max(GetGroundZ(Positions[Shell]), FloorZs[Shell]);
+
+		if (bResting[Shell])
+		{
+			// Hex blocks rise and lower under resting shells
+			if (FMath::IsNearlyEqual(Positions[Shell].Z, GroundZ, 1.f)) continue;
+			if (Positions[Shell].Z > GroundZ)
+			{
+				bResting[Shell] = false;
+			}
+			Positions[Shell].Z = FMath::Max(Positions[Shell].Z, GroundZ);
+		}
+		else
+		{
+			Velocities[Shell].Z += GravityZ * DeltaTime;
+			Positions[Shell] += FVector(Velocities[Shell]) * DeltaTime;
+
+			const float SpinSpeed = Spins[Shell].Size();
+			if (SpinSpeed > KINDA_SMALL_NUMBER)
+			{
+				Rotations[Shell] = FQuat4f(Spins[Shell] / SpinSpeed, SpinSpeed * DeltaTime) * Rotations[Shell];
+				Rotations[Shell].Normalize();
+			}
+
+			if (Positions[Shell].Z < GroundZ)
+			{
+				Positions[Shell].Z = GroundZ;
+				const float ImpactSpeed = -Velocities[Shell].Z;
+				if (ImpactSpeed > HAShell::MinSoundSpeed)
+				{
+					TryPlayImpactSound(PoolIndices[Shell], Positions[Shell]);
+				}
+
+				Velocities[Shell].Z = ImpactSpeed * HAShell::Restitution;
+				Velocities[Shell].X *= HAShell::GroundFriction;
+				Velocities[Shell].Y *= HAShell::GroundFriction;
+				Spins[Shell] *= HAShell::GroundFriction;
+				if (Velocities[Shell].Z < HAShell::RestSpeed)
+				{
+					bResting[Shell] = true;
+					Velocities[Shell] = FVector3f::ZeroVector;
+					Spins[Shell] = FVector3f::ZeroVector;
+				}
+			}
+		}
+
+		FShellMeshPool& MeshPool = Pools[PoolIndices[Shell]];
+		MeshPool.Transforms[InstanceSlots[Shell]] = FTransform(FQuat(Rotations[Shell]), Positions[Shell]);
+		MeshPool.bDirty = true;
+	}
+
+	for (FShellMeshPool& MeshPool : Pools)
+	{
+		if (!MeshPool.bDirty) continue;
+
+		MeshPool.Instances->BatchUpdateInstancesTransforms(0, MeshPool.Transforms, true, true, true);
+		MeshPool.bDirty = false;
+	}
+#endif
+}
+
+int32 UHAShellSubsystem::FindOrAddPool(TSubclassOf<ABulletShell> ShellClass)
+{
+#if WITH_COSMETICS
+	if (const int32* PoolIndex = PoolIndexByClass.Find(ShellClass))
+	{
+		return *PoolIndex;
+	}
+
+	const ABulletShell* DefaultShell = ShellClass->GetDefaultObject<ABulletShell>();
+	if (DefaultShell == nullptr || DefaultShell->GetShellMesh() == nullptr || Pools.Num() > MAX_uint8) return INDEX_NONE;
+
+	FShellMeshPool& MeshPool = Pools.AddDefaulted_GetRef();
+	MeshPool.ImpactSound = DefaultShell->GetShellSound();
+	MeshPool.LifeTime = DefaultShell->GetLifeTime();
+	MeshPool.EjectionSpeed = DefaultShell->GetEjectionSpeed();
+
+	// Registered at the origin so instance transforms are world transforms
+	MeshPool.Instances = NewObject<UInstancedStaticMeshComponent>(this);
+	MeshPool.Instances->SetStaticMesh(DefaultShell->GetShellMesh()->GetStaticMesh());
+	MeshPool.Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	MeshPool.Instances->SetCastShadow(false);
+	MeshPool.Instances->SetMobility(EComponentMobility::Movable);
+	MeshPool.Instances->RegisterComponentWithWorld(GetWorld());
+
+	return PoolIndexByClass.Add(ShellClass, Pools.Num() - 1);
+#else
+	return INDEX_NONE;
+#endif
+}
+
+void UHAShellSubsystem::ReleaseShell(int32 Shell)
+{
+	FShellMeshPool& MeshPool = Pools[PoolIndices[Shell]];
+	MeshPool.Transforms[InstanceSlots[Shell]] = FTransform(FQuat::Identity, FVector::ZeroVector, FVector::ZeroVector);
+	MeshPool.FreeSlots.Add(InstanceSlots[Shell]);
+	MeshPool.bDirty = true;
+}
+
+void UHAShellSubsystem::CacheHexTops()
+{
+	bHexTopsCached = true;
+
+	float MaxRadius = 0.f;
+	FloorZ = TNumericLimits<float>::Max();
+	for (TActorIterator<AHexBlock> It(GetWorld()); It; ++It)
+	{
+		const UStaticMeshComponent* HexMesh = It->GetHexMesh();
+		if (HexMesh == nullptr) continue;
+
+		const FBoxSphereBounds& Bounds = HexMesh->Bounds;
+		FHexTop& HexTop = HexTops.AddDefaulted_GetRef();
+		HexTop.Block = *It;
+		HexTop.Center = FVector2D(Bounds.Origin);
+		const float Radius = FMath::Min(Bounds.BoxExtent.X, Bounds.BoxExtent.Y);
+		HexTop.RadiusSquared = FMath::Square(Radius);
+		HexTop.TopOffset = Bounds.Origin.Z + Bounds.BoxExtent.Z - It->GetActorLocation().Z;
+
+		MaxRadius = FMath::Max(MaxRadius, Radius);
+		FloorZ = FMath::Min(FloorZ, Bounds.Origin.Z + Bounds.BoxExtent.Z);
+	}
+
+	if (HexTops.Num() == 0)
+	{
+		FloorZ = -HALF_WORLD_MAX;
+		return;
+	}
+
+	// A hex is only in the cell of its center, GetGroundZ looks at the neighbouring cells too
+	HexCellSize = FMath::Max(MaxRadius * 2.f, 1.f);
+	for (int32 HexIndex = 0; HexIndex < HexTops.Num(); ++HexIndex)
+	{
+		const FVector2D& Center = HexTops[HexIndex].Center;
+		HexTopsByCell.Add(FIntPoint(FMath::FloorToInt(Center.X / HexCellSize), FMath::FloorToInt(Center.Y / HexCellSize)), HexIndex);
+	}
+}
+
+float UHAShellSubsystem::GetGroundZ(const FVector& Location) const
+{
+	float GroundZ = -HALF_WORLD_MAX;
+	if (HexTops.Num() == 0) return GroundZ;
+
+	const FIntPoint Cell(FMath::FloorToInt(Location.X / HexCellSize), FMath::FloorToInt(Location.Y / HexCellSize));
+	for (int32 OffsetY = -1; OffsetY <= 1; ++OffsetY)
+	{
+		for (int32 OffsetX = -1; OffsetX <= 1; ++OffsetX)
+		{
+			for (auto It = HexTopsByCell.CreateConstKeyIterator(Cell + FIntPoint(OffsetX, OffsetY)); It; ++It)
+			{
+				const FHexTop& HexTop = HexTops[It.Value()];
+				const AHexBlock* Block = HexTop.Block.Get();
+				if (Block == nullptr || FVector2D::DistSquared(HexTop.Center, FVector2D(Location)) > HexTop.RadiusSquared) continue;
+
+				const float TopZ = Block->GetActorLocation().Z + HexTop.TopOffset;
+				if (TopZ <= Location.Z + HAShell::TopTolerance)
+				{
+					GroundZ = FMath::Max(GroundZ, TopZ);
+				}
+			}
+		}
+	}
+	return GroundZ;
+}
+
+bool UHAShellSubsystem::TryPlayImpactSound(int32 Pool, const FVector& Location)
+{
+	USoundCue* ImpactSound = Pools[Pool].ImpactSound;
+	if (ImpactSound == nullptr) return false;
+
+	if (SoundBudget < 1.f)
+	{
+		INC_DWORD_STAT(STAT_HAShellSoundsDropped);
+		return false;
+	}
+
+	SoundBudget -= 1.f;
+	INC_DWORD_STAT(STAT_HAShellSoundsPlayed);
+	UGameplayStatics::PlaySoundAtLocation(this, ImpactSound, Location);
+	return true;
+}
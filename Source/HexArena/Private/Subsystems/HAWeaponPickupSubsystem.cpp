@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/HAWeaponPickupSubsystem.h"
+#include "Pickups/WeaponPickup.h"
+#include "Weapon/BaseWeapon.h"
+#include "Engine/Engine.h"
+#include "HexArena/HexArena.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Weapon Pickups"), STAT_HAWeaponPickups, STATGROUP_HAPools);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Weapon Pickups On Ground"), STAT_HAWeaponPickupsLive, STATGROUP_HAPools);
+
+bool UHAWeaponPickupSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UHAWeaponPickupSubsystem::Deinitialize()
+{
+	for (const auto& PoolPair : Pools)
+	{
+		DEC_DWORD_STAT_BY(STAT_HAWeaponPickups, PoolPair.Value.NumSpawned);
+		DEC_DWORD_STAT_BY(STAT_HAWeaponPickupsLive, PoolPair.Value.NumSpawned - PoolPair.Value.Free.Num());
+	}
+	Pools.Empty();
+
+	Super::Deinitialize();
+}
+
+UHAWeaponPickupSubsystem* UHAWeaponPickupSubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull);
+	if (World == nullptr || World->GetNetMode() == NM_Client) return nullptr;
+	return World->GetSubsystem<UHAWeaponPickupSubsystem>();
+}
+
+AWeaponPickup* UHAWeaponPickupSubsystem::AcquirePickup(TSubclassOf<AWeaponPickup> PickupClass, ABaseWeapon* Weapon)
+{
+	if (PickupClass == nullptr || Weapon == nullptr) return nullptr;
+
+	FWeaponPickupPool& Pool = Pools.FindOrAdd(PickupClass);
+
+	AWeaponPickup* Pickup = nullptr;
+	while (Pickup == nullptr && Pool.Free.Num() > 0)
+	{
+		// Destroyed from outside, with the level for example
+		Pickup = Pool.Free.Pop(false);
+		if (!IsValid(Pickup))
+		{
+			Pickup = nullptr;
+			--Pool.NumSpawned;
+			DEC_DWORD_STAT(STAT_HAWeaponPickups);
+		}
+	}
+
+	if (Pickup == nullptr)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		Pickup = GetWorld()->SpawnActor<AWeaponPickup>(PickupClass, Weapon->GetActorTransform(), SpawnParams);
+		if (Pickup == nullptr) return nullptr;
+
+		++Pool.NumSpawned;
+		INC_DWORD_STAT(STAT_HAWeaponPickups);
+	}
+
+	INC_DWORD_STAT(STAT_HAWeaponPickupsLive);
+	Pickup->ActivateFromPool(Weapon);
+	return Pickup;
+}
+
+void UHAWeaponPickupSubsystem::ReleasePickup(AWeaponPickup* Pickup)
+{
+	if (!IsValid(Pickup) || Pickup->IsInPool()) return;
+
+	DEC_DWORD_STAT(STAT_HAWeaponPickupsLive);
+	Pickup->DeactivateToPool();
+	Pools.FindOrAdd(Pickup->GetClass()).Free.Add(Pickup);
+}
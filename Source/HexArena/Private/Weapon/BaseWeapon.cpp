@@ -1,11 +1,10 @@
 
 
 #include "Weapon/BaseWeapon.h"
-#include "Components/SphereComponent.h"
-#include "Components/WidgetComponent.h"
 #include "Character/HABaseCharacter.h"
 #include "Net/UnrealNetwork.h"
 #include "Animation/AnimationAsset.h"
+#include "Curves/CurveFloat.h"
 #include "Components/SkeletalMeshComponent.h"
 #include "Weapon/BulletShell.h"
 #include "Engine/SkeletalMeshSocket.h"
@@ -14,6 +13,59 @@
 #include "Camera/CameraComponent.h"
 #include <Attachments/BaseAttachment.h>
 #include "Attachments/ScopeAttachment.h"
+#include "Components/StaticMeshComponent.h"
+#include "Components/SceneCaptureComponent2D.h"
+#include "Subsystems/HARewindSubsystem.h"
+#include "Subsystems/HAShellSubsystem.h"
+#include "Subsystems/HADataRegistry.h"
+#include "Subsystems/HAAttachmentSubsystem.h"
+#include "Subsystems/HAWeaponPickupSubsystem.h"
+#include "Pickups/WeaponPickup.h"
+
+FWeaponStats::FWeaponStats(const FWeaponData& Weapon, TArray<const FAttachmentData*> Attachments)
+	: WeaponData(Weapon)
+{
+	Attachments.StableSort([](const FAttachmentData& A, const FAttachmentData& B) { return A.AttachmentType < B.AttachmentType; });
+
+	for (const FAttachmentData* Attachment : Attachments)
+	{
+		switch (Attachment->AttachmentType)
+		{
+		case EAttachmentType::EAT_Mag:
+			WeaponData.MagCapacity = Attachment->MagCapacity;
+			break;
+		case EAttachmentType::EAT_Sight:
+			WeaponData.ZoomedFOV *= Attachment->ZoomedFOVMultiplyer;
+			break;
+		default:
+			break;
+		}
+
+		if (Attachment->AffectAiming)
+		{
+			WeaponData.ZoomInterpSpeed *= Attachment->ZoomInterpSpeedMultiplyer;
+		}
+
+		if (Attachment->AffectRecoil)
+		{
+			WeaponData.HipScatterDistance /= Attachment->SpreadMultiplyer;
+
+			// RecoilX and RecoilY are percent taken off the yaw and pitch pattern
+			RecoilScale.X *= FMath::Max(1.f - Attachment->RecoilX / 100.f, 0.f);
+			RecoilScale.Y *= FMath::Max(1.f - Attachment->RecoilY / 100.f, 0.f);
+		}
+	}
+
+	FireDelay = 60.f / WeaponData.FireRate;
+	// Baked once into the shared stats, loaded right here when the weapon was not streamed in yet
+	Spread.BakeRecoil(WeaponData.RecoilYawCurve.LoadSynchronous(), WeaponData.RecoilPitchCurve.LoadSynchronous(), WeaponData.MagCapacity, RecoilScale);
+}
+
+const TSharedRef<const FWeaponStats>& FWeaponStats::GetDefault()
+{
+	static const TSharedRef<const FWeaponStats> DefaultStats = MakeShared<FWeaponStats>();
+	return DefaultStats;
+}
 
 ABaseWeapon::ABaseWeapon()
 {
@@ -21,7 +73,7 @@ ABaseWeapon::ABaseWeapon()
 	bReplicates = true;
 
 	WeaponMeshComponent = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("WeaponMeshComponent"));
-	WeaponMeshComponent->SetupAttachment(GetRootComponent());
+	SetRootComponent(WeaponMeshComponent);
 
 	WeaponMeshComponent->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Block);
 	WeaponMeshComponent->SetCollisionResponseToChannel(ECollisionChannel::ECC_Pawn, ECollisionResponse::ECR_Ignore);
@@ -31,53 +83,122 @@ ABaseWeapon::ABaseWeapon()
 	WeaponMeshComponent->MarkRenderStateDirty();
 	EnableCustomDepth(true);
 
-	PickupType = EPickupTypes::EPT_Weapon;
+	PickupClass = AWeaponPickup::StaticClass();
+
+	Stats = FWeaponStats::GetDefault();
+}
+
+void ABaseWeapon::BeginPlay()
+{
+	Super::BeginPlay();
 
-	static ConstructorHelpers::FObjectFinder<UDataTable> LootDTObject(TEXT("DataTable'/Game/Blueprints/Weapon/WeaponDT.WeaponDT'"));
-	if (LootDTObject.Succeeded())
+	// Clients apply the handle when it replicates
+	if (HasAuthority())
 	{
-		WeaponTable = LootDTObject.Object;
+		// Level placed weapons are authored by name, loot boxes set the id before spawning finishes
+		if (!WeaponHandle.IsValid())
+		{
+			SetWeaponDataByName(WeaponName);
+		}
+		ApplyWeaponHandle();
+
+		// Level placed and loot weapons start on the ground
+		if (GetOwner() == nullptr)
+		{
+			AcquirePickup();
+		}
 	}
+}
 
-	static ConstructorHelpers::FObjectFinder<UDataTable> AttachmentDTObject(TEXT("DataTable'/Game/Blueprints/Weapon/Attachment/DT_Attachments.DT_Attachments'"));
-	if (AttachmentDTObject.Succeeded())
+void ABaseWeapon::SetWeaponDataByName(FName NewName)
+{
+	if (const UHADataRegistry* Registry = UHADataRegistry::Get(this))
 	{
-		AttachmentsTable = AttachmentDTObject.Object;
+		SetWeaponId(Registry->FindWeaponId(NewName));
 	}
 }
 
-void ABaseWeapon::BeginPlay()
+void ABaseWeapon::SetWeaponId(int32 WeaponId)
 {
-	Super::BeginPlay();
+	if (!HasAuthority()) return;
 
-	SetWeaponDataByName(WeaponName);
+	const UHADataRegistry* Registry = UHADataRegistry::Get(this);
+	if (Registry == nullptr || !Registry->IsValidWeaponId(WeaponId) || WeaponId >= MAX_uint8)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s has no weapon data with id %d"), *GetName(), WeaponId);
+		return;
+	}
+
+	WeaponHandle.WeaponId = static_cast<uint8>(WeaponId);
+	WeaponHandle.AttachmentMask = Registry->GetAllAttachmentsMask(WeaponId);
+
+	// A deferred spawn applies it in BeginPlay
+	if (HasActorBegunPlay())
+	{
+		ApplyWeaponHandle();
+	}
 }
 
-void ABaseWeapon::SetWeaponDataByName(FName NewName)
+void ABaseWeapon::OnRep_WeaponHandle()
+{
+	ApplyWeaponHandle();
+}
+
+FWeaponData ABaseWeapon::K2_GetWeaponData() const
 {
-	if(HasAuthority())
+	return GetWeaponData();
+}
+
+#if WITH_EDITOR
+void ABaseWeapon::OnWeaponTableChanged()
+{
+	const int32 LoadedAmmo = Ammo;
+	ApplyWeaponHandle();
+	Ammo = FMath::Min(LoadedAmmo, GetMagCapacity());
+	if (HasAuthority())
 	{
-		MulticastSetWeaponDataByName(NewName);
+		AmmoAck.Ammo = Ammo;
 	}
+	SetHUDAmmo();
 }
+#endif
 
-void ABaseWeapon::MulticastSetWeaponDataByName_Implementation(FName NewName)
+void ABaseWeapon::ApplyWeaponHandle()
 {
-	WeaponName = NewName;
-	if (WeaponTable)
+	UHADataRegistry* Registry = UHADataRegistry::Get(this);
+	if (Registry == nullptr || !Registry->IsValidWeaponId(WeaponHandle.WeaponId)) return;
+
+	WeaponName = Registry->GetWeaponName(WeaponHandle.WeaponId);
+	Stats = Registry->GetWeaponStats(WeaponHandle.WeaponId, WeaponHandle.AttachmentMask);
+
+	// Recreated once the weapon mesh they attach to is loaded
+	ReleaseAttachments();
+
+	WeaponAssetsHandle = Registry->LoadWeaponAssets(WeaponHandle.WeaponId, this, FStreamableDelegate::CreateUObject(this, &ABaseWeapon::OnWeaponAssetsLoaded));
+
+	if (HasAuthority())
 	{
-		WeaponData = *WeaponTable->FindRow<FWeaponData>(WeaponName, "");
+		Ammo = GetMagCapacity();
+		AmmoAck.Ammo = Ammo;
 	}
-
-	for ( FName Attachment : WeaponData.Attachments)
+	else
 	{
-		CreateAttachment(Attachment);
+		Ammo = bAmmoAckReceived ? FMath::Clamp(AmmoAck.Ammo - PendingShots.Num(), 0, GetMagCapacity()) : GetMagCapacity();
 	}
+}
+
+void ABaseWeapon::OnWeaponAssetsLoaded()
+{
+	WeaponMeshComponent->SetSkeletalMesh(GetWeaponData().WeaponMesh.Get());
+	CreateAttachments();
+}
 
-	FireDelay =  60.f / WeaponData.FireRate ;
-	WeaponMeshComponent->SetSkeletalMesh(WeaponData.WeaponMesh);
+void ABaseWeapon::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	ReleaseAttachments();
+	ReleasePickup();
 
-	Ammo = WeaponData.MagCapacity;
+	Super::EndPlay(EndPlayReason);
 }
 
 void ABaseWeapon::Tick(float DeltaTime)
@@ -91,9 +212,9 @@ void ABaseWeapon::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifet
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
 	DOREPLIFETIME(ABaseWeapon, WeaponState);
-	DOREPLIFETIME(ABaseWeapon, WeaponData);
+	DOREPLIFETIME(ABaseWeapon, WeaponHandle);
 	DOREPLIFETIME_CONDITION(ABaseWeapon, bUseSSR, COND_OwnerOnly);
-	//DOREPLIFETIME_CONDITION(ABaseWeapon, Ammo, COND_OwnerOnly);
+	DOREPLIFETIME_CONDITION(ABaseWeapon, AmmoAck, COND_OwnerOnly);
 }
 
 void ABaseWeapon::OnPingToHigh(bool bPingTooHigh)
@@ -101,77 +222,101 @@ void ABaseWeapon::OnPingToHigh(bool bPingTooHigh)
 	bUseSSR = !bPingTooHigh;
 }
 
-void ABaseWeapon::CreateAttachment(FName Name)
+void ABaseWeapon::CreateAttachments()
 {
-	FAttachmentData* NewAttachmentData = nullptr;
-	UStaticMesh* NewAttachmentMesh = nullptr;
-	if (AttachmentsTable)
-	{
-		NewAttachmentData = AttachmentsTable->FindRow<FAttachmentData>(Name, "");
-	}
+	UHAAttachmentSubsystem* AttachmentSubsystem = UHAAttachmentSubsystem::Get(this);
+	const UHADataRegistry* Registry = UHADataRegistry::Get(this);
+	if (AttachmentSubsystem == nullptr || Registry == nullptr || !Registry->IsValidWeaponId(WeaponHandle.WeaponId)) return;
 
-	if (NewAttachmentData->AttachmentMesh)
+	const TArray<int32>& AttachmentIds = Registry->GetWeaponAttachmentIds(WeaponHandle.WeaponId);
+	for (int32 AttachmentIndex = 0; AttachmentIndex < FMath::Min(AttachmentIds.Num(), 16); ++AttachmentIndex)
 	{
-		NewAttachmentMesh = NewAttachmentData->AttachmentMesh;
-	}
+		if ((WeaponHandle.AttachmentMask & (1 << AttachmentIndex)) == 0 || !Registry->IsValidAttachmentId(AttachmentIds[AttachmentIndex])) continue;
 
-	if (!NewAttachmentData || !NewAttachmentMesh) return;
+		const FAttachmentData& AttachmentData = Registry->GetAttachment(AttachmentIds[AttachmentIndex]);
 
-	UWorld* World = GetWorld();
-	if (!World) return;
-	//FActorSpawnParameters SpawnParams;
-	//SpawnParams.Owner = GetOwner();
-	ABaseAttachment* NewAttachment = World->SpawnActor<ABaseAttachment>(NewAttachmentData->AttachmentClass, this->GetActorLocation(), this->GetActorRotation());
-	
-	if(!NewAttachment) return;
-	NewAttachment->AttachmentMesh->SetStaticMesh(NewAttachmentMesh);
-	NewAttachment->AttachmentData = *NewAttachmentData;
-
-	if (NewAttachment->AttachmentMesh && WeaponMeshComponent)
-	{
-		const USkeletalMeshSocket* WeaponSocket;
-
-		switch (NewAttachment->AttachmentData.AttachmentType)
+		FName Socket;
+		switch (AttachmentData.AttachmentType)
 		{
 		case EAttachmentType::EAT_Mag:
-			WeaponSocket = WeaponMeshComponent->GetSocketByName(FName("Mag"));
-			if (WeaponSocket) WeaponSocket->AttachActor(NewAttachment, WeaponMeshComponent);
-			WeaponData.MagCapacity = NewAttachment->AttachmentData.MagCapacity;
+			Socket = FName("Mag");
 			break;
 		case EAttachmentType::EAT_Grip:
-			WeaponSocket = WeaponMeshComponent->GetSocketByName(FName("Grip"));
-			if (WeaponSocket) WeaponSocket->AttachActor(NewAttachment, WeaponMeshComponent);
+			Socket = FName("Grip");
 			break;
 		case EAttachmentType::EAT_Muzzle:
-			WeaponSocket = WeaponMeshComponent->GetSocketByName(FName("Barrel"));
-			if (WeaponSocket) WeaponSocket->AttachActor(NewAttachment, WeaponMeshComponent);
+			Socket = FName("Barrel");
 			break;
 		case EAttachmentType::EAT_Stock:
-			WeaponSocket = WeaponMeshComponent->GetSocketByName(FName("Stock"));
-			if (WeaponSocket) WeaponSocket->AttachActor(NewAttachment, WeaponMeshComponent);
+			Socket = FName("Stock");
 			break;
 		case EAttachmentType::EAT_Sight:
-			WeaponSocket = WeaponMeshComponent->GetSocketByName(FName("Sight"));
-			//AScopeAttachment* NewSight = Cast<AScopeAttachment>(NewAttachment);
-			
-			Sight = NewAttachment;
-			WeaponData.ZoomedFOV *= Sight->AttachmentData.ZoomedFOVMultiplyer;
-			
-			if (WeaponSocket) WeaponSocket->AttachActor(NewAttachment, WeaponMeshComponent);
+			Socket = FName("Sight");
 			break;
 		}
+		if (!WeaponMeshComponent->DoesSocketExist(Socket)) continue;
+
+		UStaticMeshComponent* AttachmentComponent = AttachmentSubsystem->AcquireAttachment(AttachmentData.AttachmentClass, AttachmentData.AttachmentMesh.Get(), WeaponMeshComponent, Socket);
+		if (AttachmentComponent == nullptr) continue;
+
+		AttachmentComponent->SetRenderCustomDepth(WeaponMeshComponent->bRenderCustomDepth);
+		AttachmentComponents.Add(AttachmentComponent);
 
-		if (NewAttachment->AttachmentData.AffectAiming)
+		if (AttachmentData.AttachmentType == EAttachmentType::EAT_Sight)
 		{
-			WeaponData.ZoomInterpSpeed *= NewAttachment->AttachmentData.ZoomInterpSpeedMultiplyer;
+			SightComponent = AttachmentComponent;
+			ScopeClass = AttachmentData.AttachmentClass.Get();
 		}
+	}
+
+	UpdateScopeCapture();
+}
 
-		if (NewAttachment->AttachmentData.AffectRecoil)
+void ABaseWeapon::ReleaseAttachments()
+{
+	if (ScopeCapture)
+	{
+		ScopeCapture->DestroyComponent();
+		ScopeCapture = nullptr;
+	}
+	ScopeClass = nullptr;
+	SightComponent = nullptr;
+
+	if (UHAAttachmentSubsystem* AttachmentSubsystem = UHAAttachmentSubsystem::Get(this))
+	{
+		for (UStaticMeshComponent* AttachmentComponent : AttachmentComponents)
+		{
+			AttachmentSubsystem->ReleaseAttachment(AttachmentComponent);
+		}
+	}
+	AttachmentComponents.Reset();
+}
+
+void ABaseWeapon::UpdateScopeCapture()
+{
+#if WITH_COSMETICS
+	const AScopeAttachment* ScopeDefaults = ScopeClass ? ScopeClass->GetDefaultObject<AScopeAttachment>() : nullptr;
+	const AHABaseCharacter* OwnerCharacter = Cast<AHABaseCharacter>(GetOwner());
+	const bool bCapture = ScopeDefaults && ScopeDefaults->GetRenderTarget() && SightComponent &&
+		WeaponState == EWeaponState::EWS_Equipped && OwnerCharacter && OwnerCharacter->IsLocallyControlled();
+
+	if (bCapture && ScopeCapture == nullptr)
+	{
+		// Relative transform and capture settings come from the camera authored on the scope
+		ScopeCapture = NewObject<USceneCaptureComponent2D>(this, NAME_None, RF_Transient, ScopeDefaults->GetScopeCamera());
+		ScopeCapture->SetupAttachment(SightComponent);
+		ScopeCapture->RegisterComponent();
+	}
+	if (ScopeCapture)
+	{
+		if (bCapture)
 		{
-			WeaponData.HipScatterDistance /= NewAttachment->AttachmentData.SpreadMultiplyer;
+			ScopeCapture->FOVAngle = ScopeDefaults->ScopeFOV;
 		}
-		Attachments.Add(NewAttachment);
+		ScopeCapture->TextureTarget = bCapture ? ScopeDefaults->GetRenderTarget() : nullptr;
+		ScopeCapture->SetVisibility(bCapture);
 	}
+#endif
 }
 
 /*
@@ -200,15 +345,12 @@ void ABaseWeapon::OnWeaponStateSet()
 		break;
 
 	}
+	UpdateScopeCapture();
 }
 
 void ABaseWeapon::OnEquipped()
 {
-	ShowPickupWidget(false);
-	AreaSphere->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-	PhysicsMeshComponent->SetSimulatePhysics(false);
-	PhysicsMeshComponent->SetEnableGravity(false);
-	PhysicsMeshComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	ReleasePickup();
 
 	HAOwnerCharacter = HAOwnerCharacter == nullptr ? Cast<AHABaseCharacter>(GetOwner()) : HAOwnerCharacter;
 	if(HAOwnerCharacter && bUseSSR)
@@ -220,28 +362,18 @@ void ABaseWeapon::OnEquipped()
 		}
 	}
 	EnableCustomDepth(false);
-
-	for (auto Attachment : Attachments)
-	{
-		Attachment->EnableCustomDepth(false);
-	}
 }
 
 void ABaseWeapon::OnDropped()
 {
-	PhysicsMeshComponent->SetSimulatePhysics(true);
-	PhysicsMeshComponent->SetEnableGravity(true);
-	PhysicsMeshComponent->SetCollisionEnabled(ECollisionEnabled::PhysicsOnly);
-
-	UnprocessedSequence = 0;
+	PendingShots.Reset();
 
 	if (HasAuthority())
 	{
-		AreaSphere->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
-		PhysicsMeshComponent->AddImpulse(WeaponMeshComponent->GetRelativeRotation().Vector() * 100.f);
+		// Shot sequences count per shooter, the next owner starts its own
+		AmmoAck.ShotSequence = 0;
 	}
-	
-	WeaponMeshComponent->SetRelativeRotation(FQuat(0,0,0,0));
+
 	HAOwnerCharacter = HAOwnerCharacter == nullptr ? Cast<AHABaseCharacter>(GetOwner()) : HAOwnerCharacter;
 	if (HAOwnerCharacter && bUseSSR)
 	{
@@ -253,23 +385,13 @@ void ABaseWeapon::OnDropped()
 	}
 	WeaponMeshComponent->MarkRenderStateDirty();
 	EnableCustomDepth(true);
-
-	for (auto Attachment : Attachments)
-	{
-		Attachment->AttachmentMesh->MarkRenderStateDirty();
-		Attachment->EnableCustomDepth(true);
-	}
 }
 
 void ABaseWeapon::OnInventory()
 {
-	ShowPickupWidget(false);
-	AreaSphere->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-	PhysicsMeshComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-	PhysicsMeshComponent->SetSimulatePhysics(false);
-	PhysicsMeshComponent->SetEnableGravity(false);
+	ReleasePickup();
 
-	UnprocessedSequence = 0;
+	PendingShots.Reset();
 
 	HAOwnerCharacter = HAOwnerCharacter == nullptr ? Cast<AHABaseCharacter>(GetOwner()) : HAOwnerCharacter;
 	if (HAOwnerCharacter && bUseSSR)
@@ -281,11 +403,6 @@ void ABaseWeapon::OnInventory()
 		}
 	}
 	EnableCustomDepth(false);
-
-	for (auto Attachment : Attachments)
-	{
-		Attachment->EnableCustomDepth(false);
-	}
 }
 
 void ABaseWeapon::OnRep_WeaponState()
@@ -298,14 +415,15 @@ void ABaseWeapon::Dropped()
 {
 	SetWeaponState(EWeaponState::EWS_Dropped);
 	FDetachmentTransformRules DetachRules(EDetachmentRule::KeepWorld, true);
-	PhysicsMeshComponent->DetachFromComponent(DetachRules);
+	DetachFromActor(DetachRules);
 	SetOwner(nullptr);
 	HAOwnerController = nullptr;
 	HAOwnerCharacter = nullptr;
 
-	for (auto Attachment : Attachments)
+	AcquirePickup();
+	if (Pickup)
 	{
-		Attachment->SetOwner(nullptr);
+		Pickup->AddImpulse(GetActorForwardVector() * 100.f);
 	}
 }
 
@@ -313,11 +431,33 @@ void ABaseWeapon::ToInventory()
 {
 	SetWeaponState(EWeaponState::EWS_Inventory);
 	FDetachmentTransformRules DetachRules(EDetachmentRule::KeepWorld, true);
-	PhysicsMeshComponent->DetachFromComponent(DetachRules);
+	DetachFromActor(DetachRules);
+}
+
+void ABaseWeapon::AcquirePickup()
+{
+	if (Pickup) return;
+
+	if (UHAWeaponPickupSubsystem* PickupSubsystem = UHAWeaponPickupSubsystem::Get(this))
+	{
+		Pickup = PickupSubsystem->AcquirePickup(PickupClass, this);
+	}
+}
+
+void ABaseWeapon::ReleasePickup()
+{
+	if (Pickup == nullptr) return;
+
+	if (UHAWeaponPickupSubsystem* PickupSubsystem = UHAWeaponPickupSubsystem::Get(this))
+	{
+		PickupSubsystem->ReleasePickup(Pickup);
+	}
+	Pickup = nullptr;
 }
 
 void ABaseWeapon::SetHUDAmmo()
 {
+#if WITH_COSMETICS
 	HAOwnerCharacter = HAOwnerCharacter == nullptr ? Cast<AHABaseCharacter>(GetOwner()) : HAOwnerCharacter;
 	if (HAOwnerCharacter)
 	{
@@ -327,42 +467,40 @@ void ABaseWeapon::SetHUDAmmo()
 			HAOwnerController->SetHUDWeaponAmmo(Ammo);
 		}
 	}
+#endif
 }
 
 void ABaseWeapon::SpendRound()
 {
-	Ammo = FMath::Clamp(Ammo - 1, 0, WeaponData.MagCapacity);
+	Ammo = FMath::Clamp(Ammo - 1, 0, GetMagCapacity());
 	SetHUDAmmo();
-	if(HasAuthority())
-	{
-		ClientUpdateAmmo(Ammo);
-	}
-	else
-	{
-		++UnprocessedSequence;
-	}
 }
 
-void ABaseWeapon::ClientUpdateAmmo_Implementation(int32 ServerAmmo)
+void ABaseWeapon::AddPendingShot(int32 ShotSequence)
 {
-	if(HasAuthority()) return;
-	Ammo = ServerAmmo;
-	--UnprocessedSequence;
-	Ammo -=UnprocessedSequence;
-	SetHUDAmmo();
+	PendingShots.Add(ShotSequence);
 }
 
-void ABaseWeapon::AddAmmo(int32 AmmoToAdd)
+void ABaseWeapon::AckShot(int32 ShotSequence)
 {
-	Ammo = FMath::Clamp(Ammo + AmmoToAdd, 0, WeaponData.MagCapacity);
+	AmmoAck.Ammo = Ammo;
+	AmmoAck.ShotSequence = ShotSequence;
+}
+
+void ABaseWeapon::OnRep_AmmoAck()
+{
+	bAmmoAckReceived = true;
+
+	// Shots are acknowledged in order, everything up to the acked one is in the server ammo
+	PendingShots.RemoveAll([this](int32 ShotSequence) { return ShotSequence <= AmmoAck.ShotSequence; });
+	Ammo = FMath::Clamp(AmmoAck.Ammo - PendingShots.Num(), 0, GetMagCapacity());
 	SetHUDAmmo();
-	ClientAddAmmo(AmmoToAdd);
 }
 
-void ABaseWeapon::ClientAddAmmo_Implementation(int32 AmmoToAdd)
+void ABaseWeapon::AddAmmo(int32 AmmoToAdd)
 {
-	if (HasAuthority()) return;
-	Ammo = FMath::Clamp(Ammo + AmmoToAdd, 0, WeaponData.MagCapacity);
+	Ammo = FMath::Clamp(Ammo + AmmoToAdd, 0, GetMagCapacity());
+	AmmoAck.Ammo = Ammo;
 	SetHUDAmmo();
 }
 
@@ -378,50 +516,96 @@ void ABaseWeapon::OnRep_Owner()
 	{
 		SetHUDAmmo();
 	}
+	UpdateScopeCapture();
+}
+
+void ABaseWeapon::SetOwner(AActor* NewOwner)
+{
+	Super::SetOwner(NewOwner);
+	UpdateScopeCapture();
 }
 
 void ABaseWeapon::Fire(const FVector& HitTarget)
 {
-	if(WeaponData.FireAnimation)
-	{
-		WeaponMeshComponent->PlayAnimation(WeaponData.FireAnimation, false);
-	}
-	if(WeaponData.BulletShellClass)
+	PlayFireAnimation();
+#if WITH_COSMETICS
+	// Shells are client cosmetics, dedicated servers have no shell subsystem
+	UHAShellSubsystem* ShellSubsystem = GetWorld()->GetSubsystem<UHAShellSubsystem>();
+	const TSubclassOf<ABulletShell> BulletShellClass = GetWeaponData().BulletShellClass.Get();
+	if(BulletShellClass && ShellSubsystem)
 	{
 		const USkeletalMeshSocket* AmmoEjectSocket = WeaponMeshComponent->GetSocketByName(FName("AmmoEject"));
 		if (AmmoEjectSocket)
 		{
-			FTransform SocketTransform = AmmoEjectSocket->GetSocketTransform(WeaponMeshComponent);
-			
-			UWorld* World = GetWorld();
-			if (World)
-			{
-				World->SpawnActor<ABulletShell>(
-					WeaponData.BulletShellClass,
-					SocketTransform.GetLocation(),
-					SocketTransform.GetRotation().Rotator()
-				);
-			}
+			const FTransform SocketTransform = AmmoEjectSocket->GetSocketTransform(WeaponMeshComponent);
+			const FVector InheritedVelocity = GetOwner() ? GetOwner()->GetVelocity() : FVector::ZeroVector;
+			ShellSubsystem->EjectShell(BulletShellClass, SocketTransform, InheritedVelocity);
 		}
 	}
+#endif
 	SpendRound();
 }
 
-FVector ABaseWeapon::TraceEndWithcSpread(const FVector& HitTarget, float Spread)
+void ABaseWeapon::PlayFireAnimation()
 {
-	const USkeletalMeshSocket* MuzzleFlashSocket = GetWeaponMesh()->GetSocketByName("MuzzleFlash");
-	if (MuzzleFlashSocket == nullptr) return FVector();
+	// Not streamed in on dedicated servers
+	if(UAnimationAsset* FireAnimation = GetWeaponData().FireAnimation.Get())
+	{
+		WeaponMeshComponent->PlayAnimation(FireAnimation, false);
+	}
+}
 
-	const FTransform SocketTransform = MuzzleFlashSocket->GetSocketTransform(GetWeaponMesh());
-	const FVector TraceStart = SocketTransform.GetLocation();
+void ABaseWeapon::FireShot(const FVector& HitTarget, const FFireShot& Shot, int32 ShotSequence)
+{
+	Fire(HitTarget);
+}
 
-	const FVector ToTargetNormalized = (HitTarget - TraceStart).GetSafeNormal();
-	const FVector SphereCenter = TraceStart + ToTargetNormalized * WeaponData.HipScatterDistance;
-	const FVector RandVec = UKismetMathLibrary::RandomUnitVector() * FMath::FRandRange(0.f, Spread);
-	const FVector EndLoc = SphereCenter + RandVec;
-	const FVector ToEndLoc = EndLoc - TraceStart;
+void ABaseWeapon::FireFromEvent(const FFireEvent& FireEvent)
+{
+	Fire(FireEvent.GetHitTarget(TRACE_LENGTH));
+}
+
+FFireEvent ABaseWeapon::MakeFireEvent(const FVector& HitTarget, const FFireShot& Shot)
+{
+	FFireEvent FireEvent;
+	FireEvent.Origin = GetMuzzleLocation();
+	FireEvent.Direction = (HitTarget - FireEvent.Origin).GetSafeNormal();
+	FireEvent.WeaponType = static_cast<uint8>(GetWeaponType());
+	FireEvent.Seed = GetFireSeed(Shot);
+
+	if (const UHARewindSubsystem* RewindSubsystem = GetWorld()->GetSubsystem<UHARewindSubsystem>())
+	{
+		FireEvent.ServerFrame = RewindSubsystem->GetCurrentFrame();
+	}
+	return FireEvent;
+}
 
-	return FVector(TraceStart + ToEndLoc * TRACE_LENGTH / ToEndLoc.Size());
+int32 ABaseWeapon::GetFireSeed(const FFireShot& Shot)
+{
+	// Combined the other way round than the spread stream of FWeaponSpread::GetShotTarget, patterns draw from their own sequence
+	return static_cast<int32>(HashCombine(static_cast<uint32>(Shot.ShotIndex), static_cast<uint32>(Shot.TriggerSeed)));
+}
+
+FVector ABaseWeapon::GetShotTarget(const FFireShot& Shot)
+{
+	return Stats->Spread.GetShotTarget(
+		GetMuzzleLocation(),
+		Shot.AimTarget,
+		GetWeaponData().HipScatterDistance,
+		TRACE_LENGTH,
+		Shot.TriggerSeed,
+		Shot.ShotIndex,
+		FWeaponSpread::DequantizeSpread(Shot.Spread)
+	);
+}
+
+FVector ABaseWeapon::GetMuzzleLocation() const
+{
+	if (const USkeletalMeshSocket* MuzzleFlashSocket = WeaponMeshComponent->GetSocketByName(FName("MuzzleFlash")))
+	{
+		return MuzzleFlashSocket->GetSocketTransform(WeaponMeshComponent).GetLocation();
+	}
+	return GetActorLocation();
 }
 
 /**
@@ -434,6 +618,10 @@ void ABaseWeapon::EnableCustomDepth(bool bEnable)
 	{
 		WeaponMeshComponent->SetRenderCustomDepth(bEnable);
 	}
+	for (UStaticMeshComponent* AttachmentComponent : AttachmentComponents)
+	{
+		AttachmentComponent->SetRenderCustomDepth(bEnable);
+	}
 }
 
 /**
@@ -460,15 +648,13 @@ bool ABaseWeapon::IsEmpty()
 
 FTransform ABaseWeapon::GetsightsWorldTransform() const
 {
-	if (Sight == nullptr)
+	if (SightComponent == nullptr)
 	{
 		return WeaponMeshComponent->GetSocketTransform(FName("Sights"));
-		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Green, TEXT("Sight"));
 	}
 	else
 	{
-		return Sight->AttachmentMesh->GetSocketTransform(FName("Sights"));
-		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Green, TEXT("Scope"));
+		return SightComponent->GetSocketTransform(FName("Sights"));
 	}
 }
 
@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Weapon/FireEvent.h"
+
+void FFireStream::AddShot(int32 ShotSequence, const FFireShot& Shot, int32 MaxShots)
+{
+	if (Shots.Num() == 0)
+	{
+		FirstSequence = ShotSequence;
+	}
+	Shots.Add(Shot);
+
+	const int32 NumLost = Shots.Num() - MaxShots;
+	if (NumLost > 0)
+	{
+		Shots.RemoveAt(0, NumLost, false);
+		FirstSequence += NumLost;
+	}
+}
+
+void FFireStream::Acknowledge(int32 AckedSequence)
+{
+	const int32 NumAcked = FMath::Clamp(AckedSequence - FirstSequence + 1, 0, Shots.Num());
+	Shots.RemoveAt(0, NumAcked, false);
+	FirstSequence += NumAcked;
+}
+
+bool FFireShotQueue::Receive(const FFireStream& Stream, int32 MaxShots, int32& AckedSequence)
+{
+	// A client never has more shots in flight than its window
+	if (Stream.Shots.Num() > MaxShots) return false;
+
+	// Everything before the stream was processed or given up by the client, it is not waited for
+	if (Shots.Num() == 0 && Stream.FirstSequence > AckedSequence + 1)
+	{
+		AckedSequence = Stream.FirstSequence - 1;
+	}
+
+	// Shots already queued or fired from an earlier stream are skipped
+	const int32 LastQueuedSequence = Shots.Num() > 0 ? Shots.Last().Key : AckedSequence;
+	for (int32 Index = 0; Index < Stream.Shots.Num(); ++Index)
+	{
+		const int32 ShotSequence = Stream.FirstSequence + Index;
+		if (ShotSequence > LastQueuedSequence)
+		{
+			Shots.Emplace(ShotSequence, Stream.Shots[Index]);
+		}
+	}
+
+	// Same window as the client, shots it gave up on are not fired late either
+	const int32 NumLost = Shots.Num() - MaxShots;
+	if (NumLost > 0)
+	{
+		Shots.RemoveAt(0, NumLost, false);
+	}
+	return true;
+}
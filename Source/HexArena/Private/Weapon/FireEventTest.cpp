@@ -0,0 +1,148 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Weapon/FireEvent.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * Fire stream tests
+ * Client window and server queue of one shooter, linked without a network.
+ */
+
+namespace FireStreamTest
+{
+	static constexpr int32 MaxShots = 16;
+
+	// The server fires every queued shot as soon as it arrives
+	struct FLink
+	{
+		FFireStream Client;
+		FFireShotQueue Server;
+		int32 AckedSequence = 0;
+		int32 NextSequence = 1;
+		TArray<int32> FiredSequences;
+
+		// Fires the next shot on the client. Without bDelivered neither its stream nor the ack get through
+		void Fire(bool bDelivered)
+		{
+			FFireShot Shot;
+			Shot.ShotIndex = static_cast<uint8>(NextSequence);
+			Client.AddShot(NextSequence++, Shot, MaxShots);
+			if (!bDelivered) return;
+
+			if (Server.Receive(Client, MaxShots, AckedSequence))
+			{
+				for (const TPair<int32, FFireShot>& QueuedShot : Server.Shots)
+				{
+					FiredSequences.Add(QueuedShot.Key);
+					AckedSequence = QueuedShot.Key;
+				}
+				Server.Shots.Reset();
+			}
+			Client.Acknowledge(AckedSequence);
+		}
+	};
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFireStreamShortLossTest, "HexArena.Net.FireStream.ShortLoss", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFireStreamShortLossTest::RunTest(const FString& Parameters)
+{
+	using namespace FireStreamTest;
+
+	FLink Link;
+	Link.Fire(true);
+	for (int32 Shot = 0; Shot < MaxShots - 1; Shot++)
+	{
+		Link.Fire(false);
+	}
+	TestEqual(TEXT("Lost shots stay in the client window"), Link.Client.Shots.Num(), MaxShots - 1);
+
+	Link.Fire(true);
+	TestEqual(TEXT("Every shot is fired once"), Link.FiredSequences.Num(), MaxShots + 1);
+	for (int32 Index = 0; Index < Link.FiredSequences.Num(); Index++)
+	{
+		TestEqual(TEXT("Shots are fired in sequence order"), Link.FiredSequences[Index], Index + 1);
+	}
+	TestEqual(TEXT("Client window is acknowledged"), Link.Client.Shots.Num(), 0);
+
+	// A late copy of an old stream fires nothing again
+	FFireStream OldStream;
+	OldStream.AddShot(3, FFireShot(), MaxShots);
+	TestTrue(TEXT("Old stream is accepted"), Link.Server.Receive(OldStream, MaxShots, Link.AckedSequence));
+	TestEqual(TEXT("Old shots are not queued again"), Link.Server.Shots.Num(), 0);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFireStreamLongLossTest, "HexArena.Net.FireStream.LongLoss", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFireStreamLongLossTest::RunTest(const FString& Parameters)
+{
+	using namespace FireStreamTest;
+
+	static constexpr int32 NumLost = MaxShots * 2 + 8;
+
+	FLink Link;
+	for (int32 Shot = 0; Shot < 5; Shot++)
+	{
+		Link.Fire(true);
+	}
+	for (int32 Shot = 0; Shot < NumLost; Shot++)
+	{
+		Link.Fire(false);
+	}
+	TestEqual(TEXT("Client gave up the oldest lost shots"), Link.Client.Shots.Num(), MaxShots);
+
+	// The first stream after the loss starts far past the last processed shot
+	Link.Fire(true);
+	const int32 LastSequence = Link.NextSequence - 1;
+	TestEqual(TEXT("Newest shot is fired"), Link.FiredSequences.Last(), LastSequence);
+	TestEqual(TEXT("Shots of the client window are fired"), Link.FiredSequences.Num(), 5 + MaxShots);
+	TestFalse(TEXT("Shots given up by the client are not fired"), Link.FiredSequences.Contains(LastSequence - MaxShots));
+	TestEqual(TEXT("Ack moves to the newest shot"), Link.AckedSequence, LastSequence);
+	TestEqual(TEXT("Client window is acknowledged"), Link.Client.Shots.Num(), 0);
+
+	// Firing goes on as before the loss
+	for (int32 Shot = 0; Shot < 3; Shot++)
+	{
+		Link.Fire(true);
+		TestEqual(TEXT("Every later shot is fired"), Link.FiredSequences.Last(), Link.NextSequence - 1);
+	}
+	TestEqual(TEXT("Ack follows the later shots"), Link.AckedSequence, Link.NextSequence - 1);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFireStreamWindowTest, "HexArena.Net.FireStream.Window", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFireStreamWindowTest::RunTest(const FString& Parameters)
+{
+	using namespace FireStreamTest;
+
+	FFireStream Stream;
+	for (int32 Index = 0; Index <= MaxShots; Index++)
+	{
+		Stream.Shots.Add(FFireShot());
+	}
+	Stream.FirstSequence = 1;
+
+	FFireShotQueue Queue;
+	int32 AckedSequence = 0;
+	TestFalse(TEXT("Stream longer than the window is rejected"), Queue.Receive(Stream, MaxShots, AckedSequence));
+	TestEqual(TEXT("Rejected stream queues nothing"), Queue.Shots.Num(), 0);
+
+	// Shots not fired yet are held to the window as well, the oldest are dropped
+	Stream.Shots.SetNum(MaxShots);
+	TestTrue(TEXT("Full window is accepted"), Queue.Receive(Stream, MaxShots, AckedSequence));
+	Stream.FirstSequence += MaxShots;
+	TestTrue(TEXT("Next window is accepted"), Queue.Receive(Stream, MaxShots, AckedSequence));
+	TestEqual(TEXT("Queue holds one window"), Queue.Shots.Num(), MaxShots);
+	TestEqual(TEXT("Queue keeps the newest shots"), Queue.Shots[0].Key, MaxShots + 1);
+
+	return true;
+}
+
+#endif
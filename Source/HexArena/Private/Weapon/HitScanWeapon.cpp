@@ -0,0 +1,106 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Weapon/HitScanWeapon.h"
+#include "Engine/SkeletalMeshSocket.h"
+#include "Kismet/GameplayStatics.h"
+#include "Particles/ParticleSystem.h"
+#include "Sound/SoundCue.h"
+#include "Character/HABaseCharacter.h"
+#include "PlayerController/HAPlayerController.h"
+#include "HAComponents/LagCompensationComponent.h"
+#include "HAComponents/HitBoxComponent.h"
+#include "Subsystems/HAFXSubsystem.h"
+#include "HexArena/HexArena.h"
+
+void AHitScanWeapon::Fire(const FVector& HitTarget)
+{
+	FireWithSequence(HitTarget, INDEX_NONE);
+}
+
+void AHitScanWeapon::FireShot(const FVector& HitTarget, const FFireShot& Shot, int32 ShotSequence)
+{
+	FireWithSequence(HitTarget, ShotSequence);
+}
+
+void AHitScanWeapon::FireWithSequence(const FVector& HitTarget, int32 ShotSequence)
+{
+	Super::Fire(HitTarget);
+
+	APawn* OwnerPawn = Cast<APawn>(GetOwner());
+	if (OwnerPawn == nullptr) return;
+
+	const USkeletalMeshSocket* MuzzleFlashSocket = GetWeaponMesh()->GetSocketByName(FName("MuzzleFlash"));
+	if (MuzzleFlashSocket == nullptr) return;
+
+	const FTransform SocketTransform = MuzzleFlashSocket->GetSocketTransform(GetWeaponMesh());
+	const FVector Start = SocketTransform.GetLocation();
+
+	FHitResult FireHit;
+	WeaponTraceHit(Start, HitTarget, FireHit);
+
+	AHABaseCharacter* HitCharacter = Cast<AHABaseCharacter>(FireHit.GetActor());
+	AController* InstigatorController = OwnerPawn->GetController();
+	if (HitCharacter && InstigatorController)
+	{
+		if (OwnerPawn->HasAuthority() && (!bUseSSR || OwnerPawn->IsLocallyControlled())) // Server, host or no SSR: Damage right away
+		{
+			UHitBoxComponent* HitBox = Cast<UHitBoxComponent>(FireHit.GetComponent());
+			if (HitBox)
+			{
+				UGameplayStatics::ApplyDamage(
+					HitCharacter,
+					ULagCompensationComponent::GetHitBoxDamage(GetWeaponData(), HitBox->HitBoxType),
+					InstigatorController,
+					this,
+					UDamageType::StaticClass()
+				);
+			}
+		}
+		else if (!OwnerPawn->HasAuthority() && bUseSSR && OwnerPawn->IsLocallyControlled() && ShotSequence != INDEX_NONE) // Client, Locally controlled: Using SSR
+		{
+			// The server traces the shot it fired itself, only the victim and where it was rendered are sent
+			AHABaseCharacter* OwnerCharacter = Cast<AHABaseCharacter>(OwnerPawn);
+			if (OwnerCharacter && OwnerCharacter->GetLagCompensation())
+			{
+				OwnerCharacter->GetLagCompensation()->HitScanServerScoreRequest(
+					HitCharacter,
+					HitCharacter->GetRenderedRewindFrame(),
+					ShotSequence
+				);
+			}
+		}
+	}
+
+	PlayImpactEffects(FireHit);
+}
+
+void AHitScanWeapon::PlayImpactEffects(const FHitResult& FireHit)
+{
+	if (!FireHit.bBlockingHit) return;
+
+	if (UHAFXSubsystem* FXSubsystem = UHAFXSubsystem::Get(this))
+	{
+		FXSubsystem->PlayImpact(ImpactParticles, HitSound, FTransform(FireHit.ImpactNormal.Rotation(), FireHit.ImpactPoint));
+	}
+}
+
+void AHitScanWeapon::WeaponTraceHit(const FVector& TraceStart, const FVector& HitTarget, FHitResult& OutHit)
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr) return;
+
+	// Slightly past the target so a target point on a surface still blocks
+	const FVector End = TraceStart + (HitTarget - TraceStart) * 1.25f;
+
+	FCollisionObjectQueryParams ObjectParams;
+	ObjectParams.AddObjectTypesToQuery(ECC_WorldStatic);
+	ObjectParams.AddObjectTypesToQuery(ECC_WorldDynamic);
+	ObjectParams.AddObjectTypesToQuery(ECC_HitBox);
+
+	FCollisionQueryParams QueryParams;
+	QueryParams.AddIgnoredActor(this);
+	QueryParams.AddIgnoredActor(GetOwner());
+
+	World->LineTraceSingleByObjectType(OutHit, TraceStart, End, ObjectParams, QueryParams);
+}
@@ -4,12 +4,14 @@
 #include "Weapon/Projectile.h"
 #include "GameFramework/ProjectileMovementComponent.h"
 #include"Components/BoxComponent.h"
-#include "Kismet/GameplayStatics.h"
 #include "Particles/ParticleSystemComponent.h"
 #include "Particles/ParticleSystem.h"
 #include "Sound/SoundCue.h"
 #include "Character/HABaseCharacter.h"
 #include "HexArena/HexArena.h"
+#include "Subsystems/HAProjectilePoolSubsystem.h"
+#include "Subsystems/HAFXSubsystem.h"
+#include "TimerManager.h"
 
 AProjectile::AProjectile()
 {
@@ -44,14 +46,107 @@ void AProjectile::Destroyed()
 {
 	Super::Destroyed();
 
-	if (ImpactParticles)
+	// Pooled projectiles played their impact when they were released, now they go with the world
+	if (!bPooled)
 	{
-		UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), ImpactParticles, GetActorTransform());
+		PlayImpactEffects();
 	}
+	ReleaseTracer();
+}
 
-	if (ImpactSound)
+void AProjectile::PlayImpactEffects()
+{
+	if (UHAFXSubsystem* FXSubsystem = UHAFXSubsystem::Get(this))
 	{
-		UGameplayStatics::PlaySoundAtLocation(this, ImpactSound, GetActorLocation());
+		FXSubsystem->PlayImpact(ImpactParticles, ImpactSound, GetActorTransform());
+	}
+}
+
+void AProjectile::AcquireTracer()
+{
+	UHAFXSubsystem* FXSubsystem = UHAFXSubsystem::Get(this);
+	if (FXSubsystem == nullptr || TracerComponent) return;
+
+	TracerComponent = FXSubsystem->AcquireTracer(Tracer, GetActorLocation(), GetActorRotation());
+	if (TracerComponent)
+	{
+		TracerComponent->AttachToComponent(CollisionBox, FAttachmentTransformRules::KeepWorldTransform);
+	}
+}
+
+void AProjectile::ReleaseTracer()
+{
+	if (TracerComponent == nullptr) return;
+
+	if (UHAFXSubsystem* FXSubsystem = UHAFXSubsystem::Get(this))
+	{
+		FXSubsystem->ReleaseTracer(TracerComponent);
+	}
+	TracerComponent = nullptr;
+}
+
+void AProjectile::ActivateFromPool(const FTransform& Transform, AActor* NewOwner, APawn* NewInstigator)
+{
+	const AProjectile* DefaultProjectile = GetClass()->GetDefaultObject<AProjectile>();
+	bUseSSR = false;
+	TraceStart = FVector_NetQuantize::ZeroVector;
+	InitialVelocity = FVector_NetQuantize100::ZeroVector;
+	Damage = DefaultProjectile->Damage;
+	InstigatorWeapon = nullptr;
+	bInPool = false;
+
+	SetOwner(NewOwner);
+	SetInstigator(NewInstigator);
+	SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+
+	CollisionBox->ClearMoveIgnoreActors();
+	CollisionBox->IgnoreActorWhenMoving(NewOwner, true);
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+
+	// Movement stopped simulating on the last hit
+	ProjectileMovementComponent->SetUpdatedComponent(CollisionBox);
+	ProjectileMovementComponent->Velocity = Transform.GetRotation().GetForwardVector() * InitialSpeed;
+	ProjectileMovementComponent->Activate(true);
+
+	AcquireTracer();
+
+	GetWorldTimerManager().SetTimer(PooledLifeTimer, this, &AProjectile::ReturnToPool, PooledLifeTime);
+}
+
+void AProjectile::DeactivateToPool()
+{
+	bInPool = true;
+	GetWorldTimerManager().ClearTimer(PooledLifeTimer);
+
+	ProjectileMovementComponent->StopMovementImmediately();
+	ProjectileMovementComponent->Deactivate();
+	ReleaseTracer();
+
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+	SetOwner(nullptr);
+	SetInstigator(nullptr);
+	InstigatorWeapon = nullptr;
+}
+
+void AProjectile::FinishFlight()
+{
+	if (!bPooled)
+	{
+		Destroy();
+		return;
+	}
+
+	PlayImpactEffects();
+	ReturnToPool();
+}
+
+void AProjectile::ReturnToPool()
+{
+	if (UHAProjectilePoolSubsystem* Pool = GetWorld()->GetSubsystem<UHAProjectilePoolSubsystem>())
+	{
+		Pool->ReleaseProjectile(this);
 	}
 }
 
@@ -61,17 +156,7 @@ void AProjectile::BeginPlay()
 	
 	CollisionBox->IgnoreActorWhenMoving(GetOwner(), true);
 
-	if (Tracer)
-	{
-		TracerComponent = UGameplayStatics::SpawnEmitterAttached(
-			Tracer,
-			CollisionBox,
-			FName(),
-			GetActorLocation(),
-			GetActorRotation(),
-			EAttachLocation::KeepWorldPosition
-		);
-	}
+	AcquireTracer();
 
 	if(HasAuthority())
 	{
@@ -81,8 +166,7 @@ void AProjectile::BeginPlay()
 
 void AProjectile::OnHit(UPrimitiveComponent* HitComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
 {
-	UE_LOG(LogTemp, Warning, TEXT("Owner of %s is %s"), *this->GetName(), *GetOwner()->GetName());
-	Destroy();
+	FinishFlight();
 }
 
 
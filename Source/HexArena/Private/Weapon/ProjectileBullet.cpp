@@ -29,7 +29,6 @@ void AProjectileBullet::PostEditChangeProperty(struct FPropertyChangedEvent& Eve
 
 void AProjectileBullet::OnHit(UPrimitiveComponent* HitComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
 {
-	UE_LOG(LogTemp, Warning, TEXT("Hit.GetComponent of %s is %s"), *this->GetName(), *Hit.GetComponent()->GetName());
 	AHABaseCharacter* OwnerCharacter = Cast<AHABaseCharacter>(GetOwner());
 	if(OwnerCharacter)
 	{
@@ -45,23 +44,23 @@ void AProjectileBullet::OnHit(UPrimitiveComponent* HitComp, AActor* OtherActor,
 					switch (HitBox->HitBoxType)
 					{
 					case EHitBoxType::EHBT_Head:
-						Damage = InstigatorWeapon->WeaponData.BaseDamage * InstigatorWeapon->WeaponData.HeadMultiplyer;
+						Damage = InstigatorWeapon->GetWeaponData().BaseDamage * InstigatorWeapon->GetWeaponData().HeadMultiplyer;
 						break;
 
 					case EHitBoxType::EHBT_Neck:
-						Damage = InstigatorWeapon->WeaponData.BaseDamage * InstigatorWeapon->WeaponData.NeckMultiplyer;
+						Damage = InstigatorWeapon->GetWeaponData().BaseDamage * InstigatorWeapon->GetWeaponData().NeckMultiplyer;
 						break;
 
 					case EHitBoxType::EHBT_Chest:
-						Damage = InstigatorWeapon->WeaponData.BaseDamage * InstigatorWeapon->WeaponData.ChestMultiplyer;
+						Damage = InstigatorWeapon->GetWeaponData().BaseDamage * InstigatorWeapon->GetWeaponData().ChestMultiplyer;
 						break;
 
 					case EHitBoxType::EHBT_Stomach:
-						Damage = InstigatorWeapon->WeaponData.BaseDamage * InstigatorWeapon->WeaponData.StomachMultiplyer;
+						Damage = InstigatorWeapon->GetWeaponData().BaseDamage * InstigatorWeapon->GetWeaponData().StomachMultiplyer;
 						break;
 
 					case EHitBoxType::EHBT_Limbs:
-						Damage = InstigatorWeapon->WeaponData.BaseDamage * InstigatorWeapon->WeaponData.LimbsMultiplyer;
+						Damage = InstigatorWeapon->GetWeaponData().BaseDamage * InstigatorWeapon->GetWeaponData().LimbsMultiplyer;
 						break;
 					}
 				}
@@ -79,7 +78,7 @@ void AProjectileBullet::OnHit(UPrimitiveComponent* HitComp, AActor* OtherActor,
 					HitCharacter,
 					TraceStart,
 					InitialVelocity,
-					OwnerController->GetServerTime() - OwnerController->SingleTripTime
+					HitCharacter->GetRenderedRewindFrame()
 				);
 			}
 		}
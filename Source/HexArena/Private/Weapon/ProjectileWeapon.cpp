@@ -4,6 +4,102 @@
 #include "Weapon/ProjectileWeapon.h"
 #include "Engine/SkeletalMeshSocket.h"
 #include "Weapon/Projectile.h"
+#include "Subsystems/HAProjectilePoolSubsystem.h"
+#include "Subsystems/HABulletSubsystem.h"
+#include "Character/HABaseCharacter.h"
+
+void AProjectileWeapon::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Every machine fires the non replicated rewind projectile, spawn a magazine worth up front
+	UHAProjectilePoolSubsystem* Pool = GetWorld()->GetSubsystem<UHAProjectilePoolSubsystem>();
+	if (Pool && !UHABulletSubsystem::IsEnabled())
+	{
+		Pool->Prewarm(ServerSideRewindProjectileClass, PooledProjectiles);
+		Pool->Prewarm(GetWeaponData().ProjectileClass, PooledProjectiles);
+	}
+}
+
+void AProjectileWeapon::FireBullet(const FVector& Location, const FRotator& Rotation, APawn* InstigatorPawn)
+{
+	UHABulletSubsystem* Bullets = GetWorld()->GetSubsystem<UHABulletSubsystem>();
+	if (Bullets == nullptr) return;
+
+	FBulletSpawnParams Params;
+	Params.Shooter = Cast<AHABaseCharacter>(InstigatorPawn);
+	Params.Weapon = this;
+	Params.Location = Location;
+	Params.Direction = Rotation.Vector();
+
+	// Same roles as the projectile actors, every machine simulates its own bullet instead of replicating one
+	if (bUseSSR)
+	{
+		if (InstigatorPawn->HasAuthority() && InstigatorPawn->IsLocallyControlled()) // Server, host
+		{
+			Params.BulletClass = GetWeaponData().ProjectileClass;
+			Params.Flags = EBulletFlags::ApplyDamage | EBulletFlags::Cosmetic;
+		}
+		else if (InstigatorPawn->IsLocallyControlled()) // Client, Locally controlled: scores with SSR
+		{
+			Params.BulletClass = ServerSideRewindProjectileClass;
+			Params.Flags = EBulletFlags::RequestSSR | EBulletFlags::Cosmetic;
+		}
+		else // Simulated shooter, or server copy of a client bullet
+		{
+			Params.BulletClass = ServerSideRewindProjectileClass;
+			Params.Flags = EBulletFlags::Cosmetic;
+		}
+	}
+	else // Not using SSR
+	{
+		Params.BulletClass = GetWeaponData().ProjectileClass;
+		Params.Flags = InstigatorPawn->HasAuthority() ? EBulletFlags::ApplyDamage | EBulletFlags::Cosmetic : EBulletFlags::Cosmetic;
+	}
+
+	Bullets->FireBullet(Params);
+}
+
+AProjectile* AProjectileWeapon::SpawnProjectile(TSubclassOf<AProjectile> Class, const FVector& Location, const FRotator& Rotation, APawn* InstigatorPawn)
+{
+	UHAProjectilePoolSubsystem* Pool = GetWorld()->GetSubsystem<UHAProjectilePoolSubsystem>();
+	if (Pool)
+	{
+		return Pool->AcquireProjectile(Class, FTransform(Rotation, Location), GetOwner(), InstigatorPawn);
+	}
+
+	const FTransform SpawnTransform(Rotation, Location);
+	AProjectile* Projectile = GetWorld()->SpawnActorDeferred<AProjectile>(Class, SpawnTransform, GetOwner(), InstigatorPawn);
+	if (Projectile)
+	{
+		// Fire events replicate the shot, the projectile stays on the machine that fired it
+		Projectile->SetReplicates(false);
+		Projectile->FinishSpawning(SpawnTransform);
+	}
+	return Projectile;
+}
+
+void AProjectileWeapon::FireFromEvent(const FFireEvent& FireEvent)
+{
+	// Animation, shell and ammo, the round itself flies from the server muzzle
+	ABaseWeapon::Fire(FireEvent.GetHitTarget(TRACE_LENGTH));
+
+	APawn* InstigatorPawn = Cast<APawn>(GetOwner());
+	if (InstigatorPawn == nullptr) return;
+
+	const FRotator Rotation = FVector(FireEvent.Direction).Rotation();
+	if (UHABulletSubsystem::IsEnabled())
+	{
+		FireBullet(FireEvent.Origin, Rotation, InstigatorPawn);
+		return;
+	}
+
+	AProjectile* SpawnedProjectile = SpawnProjectile(ServerSideRewindProjectileClass, FireEvent.Origin, Rotation, InstigatorPawn);
+	if (SpawnedProjectile)
+	{
+		SpawnedProjectile->bUseSSR = false;
+	}
+}
 
 void AProjectileWeapon::Fire(const FVector& HitTarget)
 {
@@ -21,9 +117,11 @@ void AProjectileWeapon::Fire(const FVector& HitTarget)
 		FVector ToTarget = HitTarget - SocketTransform.GetLocation();
 		FRotator TargetRotation = ToTarget.Rotation();
 
-		FActorSpawnParameters SpawnParams;
-		SpawnParams.Owner = GetOwner();
-		SpawnParams.Instigator = InstigatorPawn;
+		if (UHABulletSubsystem::IsEnabled())
+		{
+			FireBullet(SocketTransform.GetLocation(), TargetRotation, InstigatorPawn);
+			return;
+		}
 
 		AProjectile* SpawnedProjectile = nullptr;
 
@@ -33,13 +131,13 @@ void AProjectileWeapon::Fire(const FVector& HitTarget)
 			{
 				if(InstigatorPawn->IsLocallyControlled()) // Server, host: Using Replicated projectile
 				{
-					SpawnedProjectile = World->SpawnActor<AProjectile>(WeaponData.ProjectileClass,SocketTransform.GetLocation(),TargetRotation,SpawnParams);
+					SpawnedProjectile = SpawnProjectile(GetWeaponData().ProjectileClass, SocketTransform.GetLocation(), TargetRotation, InstigatorPawn);
 					SpawnedProjectile->bUseSSR = false;
 					SpawnedProjectile->SetInstigatorWeapon(this);
 				}
 				else // Server, not Locally controlled: Doesn't Uses Replicated projectile
 				{
-					SpawnedProjectile = World->SpawnActor<AProjectile>(ServerSideRewindProjectileClass, SocketTransform.GetLocation(), TargetRotation, SpawnParams);
+					SpawnedProjectile = SpawnProjectile(ServerSideRewindProjectileClass, SocketTransform.GetLocation(), TargetRotation, InstigatorPawn);
 					SpawnedProjectile->bUseSSR = true;
 				}
 			}
@@ -47,7 +145,7 @@ void AProjectileWeapon::Fire(const FVector& HitTarget)
 			{
 				if(InstigatorPawn->IsLocallyControlled()) // Client, Locally controller: Using SSR non-rep
 				{
-					SpawnedProjectile = World->SpawnActor<AProjectile>(ServerSideRewindProjectileClass, SocketTransform.GetLocation(), TargetRotation, SpawnParams);
+					SpawnedProjectile = SpawnProjectile(ServerSideRewindProjectileClass, SocketTransform.GetLocation(), TargetRotation, InstigatorPawn);
 					SpawnedProjectile->bUseSSR = true;
 					SpawnedProjectile->TraceStart = SocketTransform.GetLocation();
 					SpawnedProjectile->InitialVelocity = SpawnedProjectile->GetActorForwardVector() * SpawnedProjectile->InitialSpeed;
@@ -55,7 +153,7 @@ void AProjectileWeapon::Fire(const FVector& HitTarget)
 				}
 				else // Client, Not Locally Controlled: Non-rep, no SSR
 				{
-					SpawnedProjectile = World->SpawnActor<AProjectile>(ServerSideRewindProjectileClass, SocketTransform.GetLocation(), TargetRotation, SpawnParams);
+					SpawnedProjectile = SpawnProjectile(ServerSideRewindProjectileClass, SocketTransform.GetLocation(), TargetRotation, InstigatorPawn);
 					SpawnedProjectile->bUseSSR = false;
 				}
 			}
@@ -64,10 +162,15 @@ void AProjectileWeapon::Fire(const FVector& HitTarget)
 		{
 			if(InstigatorPawn->HasAuthority())
 			{
-				SpawnedProjectile = World->SpawnActor<AProjectile>(WeaponData.ProjectileClass, SocketTransform.GetLocation(), TargetRotation, SpawnParams);
+				SpawnedProjectile = SpawnProjectile(GetWeaponData().ProjectileClass, SocketTransform.GetLocation(), TargetRotation, InstigatorPawn);
 				SpawnedProjectile->bUseSSR = false;
 				SpawnedProjectile->SetInstigatorWeapon(this);
 			}
+			else // Client, Locally controlled: the server projectile does not replicate, cosmetic only
+			{
+				SpawnedProjectile = SpawnProjectile(ServerSideRewindProjectileClass, SocketTransform.GetLocation(), TargetRotation, InstigatorPawn);
+				SpawnedProjectile->bUseSSR = false;
+			}
 		}
 	}
 }
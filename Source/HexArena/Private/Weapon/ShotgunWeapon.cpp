@@ -0,0 +1,120 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Weapon/ShotgunWeapon.h"
+#include "Engine/SkeletalMeshSocket.h"
+#include "Kismet/GameplayStatics.h"
+#include "Character/HABaseCharacter.h"
+#include "PlayerController/HAPlayerController.h"
+#include "HAComponents/LagCompensationComponent.h"
+#include "HAComponents/HitBoxComponent.h"
+#include "HAComponents/CombatComponent.h"
+
+void AShotgunWeapon::Fire(const FVector& HitTarget)
+{
+	// Outside of the fire stream, the pattern of a default shot
+	FireWithSeed(HitTarget, GetFireSeed(FFireShot()), INDEX_NONE);
+}
+
+void AShotgunWeapon::FireShot(const FVector& HitTarget, const FFireShot& Shot, int32 ShotSequence)
+{
+	FireWithSeed(HitTarget, GetFireSeed(Shot), ShotSequence);
+}
+
+void AShotgunWeapon::FireFromEvent(const FFireEvent& FireEvent)
+{
+	// Simulated proxies never request score, the seed of the server is all they need
+	FireWithSeed(FireEvent.GetHitTarget(TRACE_LENGTH), FireEvent.Seed, INDEX_NONE);
+}
+
+void AShotgunWeapon::FireWithSeed(const FVector& HitTarget, int32 Seed, int32 ShotSequence)
+{
+	// Pellets replace the single trace of AHitScanWeapon
+	ABaseWeapon::Fire(HitTarget);
+
+	APawn* OwnerPawn = Cast<APawn>(GetOwner());
+	if (OwnerPawn == nullptr) return;
+
+	const USkeletalMeshSocket* MuzzleFlashSocket = GetWeaponMesh()->GetSocketByName(FName("MuzzleFlash"));
+	if (MuzzleFlashSocket == nullptr) return;
+
+	const FTransform SocketTransform = MuzzleFlashSocket->GetSocketTransform(GetWeaponMesh());
+	const FVector Start = SocketTransform.GetLocation();
+
+	TArray<FVector, TInlineAllocator<16>> PelletEnds;
+	GetPelletTraceEnds(Start, HitTarget, Seed, NumberOfPellets, PelletEnds);
+
+	AController* InstigatorController = OwnerPawn->GetController();
+	const bool bCauseAuthDamage = OwnerPawn->HasAuthority() && (!bUseSSR || OwnerPawn->IsLocallyControlled());
+	const bool bRequestSSR = !OwnerPawn->HasAuthority() && bUseSSR && OwnerPawn->IsLocallyControlled() && ShotSequence != INDEX_NONE;
+
+	// Damage of the whole blast is summed per victim
+	TMap<AHABaseCharacter*, float, TInlineSetAllocator<8>> DamageMap;
+	TArray<AHABaseCharacter*> HitCharacters;
+
+	for (const FVector& PelletEnd : PelletEnds)
+	{
+		FHitResult FireHit;
+		WeaponTraceHit(Start, PelletEnd, FireHit);
+		PlayImpactEffects(FireHit);
+
+		AHABaseCharacter* HitCharacter = Cast<AHABaseCharacter>(FireHit.GetActor());
+		if (HitCharacter == nullptr || InstigatorController == nullptr) continue;
+
+		if (bCauseAuthDamage)
+		{
+			UHitBoxComponent* HitBox = Cast<UHitBoxComponent>(FireHit.GetComponent());
+			if (HitBox)
+			{
+				DamageMap.FindOrAdd(HitCharacter) += ULagCompensationComponent::GetHitBoxDamage(GetWeaponData(), HitBox->HitBoxType);
+			}
+		}
+		else if (bRequestSSR)
+		{
+			HitCharacters.AddUnique(HitCharacter);
+		}
+	}
+
+	for (const auto& DamagePair : DamageMap)
+	{
+		UGameplayStatics::ApplyDamage(DamagePair.Key, DamagePair.Value, InstigatorController, this, UDamageType::StaticClass());
+	}
+
+	if (HitCharacters.Num() > 0)
+	{
+		AHABaseCharacter* OwnerCharacter = Cast<AHABaseCharacter>(OwnerPawn);
+		if (OwnerCharacter && OwnerCharacter->GetLagCompensation())
+		{
+			// Every victim is rewound to the snapshot this client was rendering it at, the pellets are the ones the server fired
+			TArray<FRewindFrame> RewindFrames;
+			RewindFrames.Reserve(HitCharacters.Num());
+			for (const AHABaseCharacter* HitCharacter : HitCharacters)
+			{
+				RewindFrames.Add(HitCharacter->GetRenderedRewindFrame());
+			}
+
+			OwnerCharacter->GetLagCompensation()->ShotgunServerScoreRequest(
+				HitCharacters,
+				RewindFrames,
+				ShotSequence,
+				static_cast<uint8>(NumberOfPellets)
+			);
+		}
+	}
+}
+
+void AShotgunWeapon::GetPelletTraceEnds(const FVector& TraceStart, const FVector& HitTarget, int32 Seed, int32 NumPellets, TArray<FVector, TInlineAllocator<16>>& OutTraceEnds) const
+{
+	FRandomStream PelletStream(Seed);
+
+	const FVector ToTargetNormalized = (HitTarget - TraceStart).GetSafeNormal();
+	const FVector SphereCenter = TraceStart + ToTargetNormalized * GetWeaponData().HipScatterDistance;
+
+	OutTraceEnds.Reset(NumPellets);
+	for (int32 Pellet = 0; Pellet < NumPellets; Pellet++)
+	{
+		const FVector RandVec = PelletStream.VRand() * PelletStream.FRandRange(0.f, PelletSpread);
+		const FVector ToEndLoc = SphereCenter + RandVec - TraceStart;
+		OutTraceEnds.Add(TraceStart + ToEndLoc * TRACE_LENGTH / ToEndLoc.Size());
+	}
+}
@@ -0,0 +1,50 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Weapon/WeaponSpread.h"
+#include "Curves/CurveFloat.h"
+
+void FWeaponSpread::BakeRecoil(const UCurveFloat* YawCurve, const UCurveFloat* PitchCurve, int32 NumShots, const FVector2f& Scale)
+{
+	RecoilTable.Reset();
+	if (YawCurve == nullptr && PitchCurve == nullptr) return;
+
+	RecoilTable.SetNumUninitialized(FMath::Max(NumShots, 1));
+	for (int32 ShotIndex = 0; ShotIndex < RecoilTable.Num(); ++ShotIndex)
+	{
+		RecoilTable[ShotIndex].X = YawCurve ? YawCurve->GetFloatValue(ShotIndex) * Scale.X : 0.f;
+		RecoilTable[ShotIndex].Y = PitchCurve ? PitchCurve->GetFloatValue(ShotIndex) * Scale.Y : 0.f;
+	}
+}
+
+FVector2f FWeaponSpread::GetRecoil(int32 ShotIndex) const
+{
+	if (RecoilTable.Num() == 0) return FVector2f::ZeroVector;
+	return RecoilTable[FMath::Clamp(ShotIndex, 0, RecoilTable.Num() - 1)];
+}
+
+FVector FWeaponSpread::GetShotTarget(const FVector& TraceStart, const FVector& AimTarget, float ScatterDistance, float TraceLength, int32 TriggerSeed, int32 ShotIndex, float Spread) const
+{
+	const FVector2f Recoil = GetRecoil(ShotIndex);
+	FRotator ShotRotation = (AimTarget - TraceStart).Rotation();
+	ShotRotation.Yaw += Recoil.X;
+	ShotRotation.Pitch += Recoil.Y;
+
+	// Scatter sphere ahead of the muzzle as hip fire always used, drawn from the seeded stream instead of the global random
+	FRandomStream SpreadStream(static_cast<int32>(HashCombine(static_cast<uint32>(TriggerSeed), static_cast<uint32>(ShotIndex))));
+	const FVector SphereCenter = TraceStart + ShotRotation.Vector() * ScatterDistance;
+	const FVector RandVec = SpreadStream.VRand() * SpreadStream.FRandRange(0.f, Spread);
+	const FVector ToEndLoc = SphereCenter + RandVec - TraceStart;
+
+	return TraceStart + ToEndLoc * TraceLength / ToEndLoc.Size();
+}
+
+uint8 FWeaponSpread::QuantizeSpread(float Spread)
+{
+	return static_cast<uint8>(FMath::Clamp(FMath::RoundToInt(Spread * 16.f), 0, 255));
+}
+
+float FWeaponSpread::DequantizeSpread(uint8 QuantizedSpread)
+{
+	return QuantizedSpread / 16.f;
+}
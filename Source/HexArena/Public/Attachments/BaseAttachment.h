@@ -35,8 +35,8 @@ struct FAttachmentData : public FTableRowBase
 	UPROPERTY(EditAnywhere, Category = "AttachmentType")
 	TSubclassOf<ABaseAttachment> AttachmentClass;
 	
-	UPROPERTY(EditAnywhere, meta = (EditCondition = "A"), Category = "AttachmentMesh")
-	UStaticMesh* AttachmentMesh;
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "A", AssetBundles = "Client"), Category = "AttachmentMesh")
+	TSoftObjectPtr<UStaticMesh> AttachmentMesh;
 
 	UPROPERTY(EditAnywhere, Category = "Aim")
 	bool AffectAiming = false;
@@ -9,6 +9,10 @@
 class USceneCaptureComponent2D;
 class UTextureRenderTArget2D;
 
+/**
+ * Defaults of a sight with a scope. The weapon of the locally controlled character creates its scope capture from
+ * ScopeCamera the first time it equips the sight, nobody else gets one.
+ */
 UCLASS()
 class HEXARENA_API AScopeAttachment : public ABaseAttachment
 {
@@ -19,24 +23,14 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Aim")
 	float ScopeFOV = 30.f;
 
-	UFUNCTION(Client, Reliable)
-	void ClinetSetRenderPlayer();
-	void ResetRenderTarget();
-
 protected:
-	virtual void BeginPlay() override;
-	virtual void SetOwner( AActor* NewOwner ) override;
-
 	UPROPERTY(EditAnywhere, Category = "Aim")
 	USceneCaptureComponent2D* ScopeCamera;
 
 	UPROPERTY(EditAnywhere, Category = "Aim")
 	UTextureRenderTarget2D* RenderTarget;
 
-private:
-
 public:
-	void SetScopeFOV(float NewFov);
-
-	
+	FORCEINLINE USceneCaptureComponent2D* GetScopeCamera() const { return ScopeCamera; }
+	FORCEINLINE UTextureRenderTarget2D* GetRenderTarget() const { return RenderTarget; }
 };
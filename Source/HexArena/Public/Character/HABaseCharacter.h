@@ -13,6 +13,7 @@
 #include "HATypes/CombatState.h"
 #include "HAComponents/HitBoxComponent.h"
 #include <Engine/DataTable.h>
+#include "Engine/StreamableManager.h"
 #include "HABaseCharacter.generated.h"
 
 class UCombatComponent;
@@ -31,6 +32,7 @@ class UHitBoxComponent;
 class UHAMovementComponent;
 class UInventory;
 class UMaterialInstanceDynamic;
+struct FRewindFrame;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnLeftGame);
 
@@ -39,19 +41,19 @@ struct FTeamColorsData : public FTableRowBase
 {
 	GENERATED_BODY()
 
-	UPROPERTY(EditAnywhere, Category = "Death")
-	UMaterialInstance* BodyMaterialInstance;
-	UPROPERTY(EditAnywhere, Category = "Death")
-	UMaterialInstance* ArmMaterialInstance;
-	UPROPERTY(EditAnywhere, Category = "Death")
-	UMaterialInstance* UpperarmMaterialInstance;
-
-	UPROPERTY(EditAnywhere, Category = "Death")
-	UMaterialInstance* BodyDissolveMaterialInstance;
-	UPROPERTY(EditAnywhere, Category = "Death")
-	UMaterialInstance* ArmDissolveMaterialInstance;
-	UPROPERTY(EditAnywhere, Category = "Death")
-	UMaterialInstance* UpperarmDissolveMaterialInstance;
+	UPROPERTY(EditAnywhere, Category = "Death", meta = (AssetBundles = "Client"))
+	TSoftObjectPtr<UMaterialInstance> BodyMaterialInstance;
+	UPROPERTY(EditAnywhere, Category = "Death", meta = (AssetBundles = "Client"))
+	TSoftObjectPtr<UMaterialInstance> ArmMaterialInstance;
+	UPROPERTY(EditAnywhere, Category = "Death", meta = (AssetBundles = "Client"))
+	TSoftObjectPtr<UMaterialInstance> UpperarmMaterialInstance;
+
+	UPROPERTY(EditAnywhere, Category = "Death", meta = (AssetBundles = "Client"))
+	TSoftObjectPtr<UMaterialInstance> BodyDissolveMaterialInstance;
+	UPROPERTY(EditAnywhere, Category = "Death", meta = (AssetBundles = "Client"))
+	TSoftObjectPtr<UMaterialInstance> ArmDissolveMaterialInstance;
+	UPROPERTY(EditAnywhere, Category = "Death", meta = (AssetBundles = "Client"))
+	TSoftObjectPtr<UMaterialInstance> UpperarmDissolveMaterialInstance;
 };
 
 UCLASS()
@@ -88,6 +90,10 @@ public:
 	UPROPERTY()
 	TMap<FName, UHitBoxComponent*> HitBoxes;
 
+	// Same boxes as HitBoxes, addressed by index for the rewind history. HeadBox is added first, RegisterCharacter checks it
+	UPROPERTY()
+	TArray<UHitBoxComponent*> HitBoxArray;
+
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite, Category = "Mesh")
 	USkeletalMeshComponent* ClientMesh;
 
@@ -288,14 +294,20 @@ private:
 	* TeamColors and Dissolve effects
 	*/	
 
-	UDataTable* TeamColorsDT;
-	FTeamColorsData TeamColors;
+	// UHADataRegistry team colors of TeamName, resolved when the team is set
+	int32 TeamColorsId = INDEX_NONE;
 
 	UFUNCTION()
 	void SetTeamColor(FName Team);
 
+	// Keeps the streamed in team materials loaded, clients only
+	TSharedPtr<FStreamableHandle> TeamColorsAssetsHandle;
+
+	void OnTeamColorsAssetsLoaded();
+
+	// Dissolve materials of the current team colors
 	UFUNCTION()
-	void SetDissolveMaterials(FName Team);
+	void SetDissolveMaterials();
 
 	UPROPERTY(EditAnywhere, Category = "Team")
 	FName TeamName = "NoTeam";
@@ -320,6 +332,22 @@ private:
 	void StartDissolve();
 
 	AHaPlayerState* HAPlayerState;
+
+	/*
+	*	Server side rewind
+	*/
+
+	// Rewind frame of the snapshot this update belongs to, stamped by UHARewindSubsystem after every capture
+	UPROPERTY(ReplicatedUsing = OnRep_RewindFrame)
+	int32 RewindFrame = INDEX_NONE;
+
+	UFUNCTION()
+	void OnRep_RewindFrame(int32 LastRewindFrame);
+
+	// Frame the smoothed mesh is moving away from, and when the newest one arrived
+	int32 PreviousRewindFrame = INDEX_NONE;
+	float RewindFrameReceivedTime = 0.f;
+
 public:
 	void SetOverlappingPickup(AInteractable* Pickup);
 	bool IsWeaponEquipped();
@@ -349,4 +377,8 @@ public:
 	FORCEINLINE UInventory* GetInventory () const { return Inventory; }
 
 	void SetTeamName(FName NewName);
+
+	// Frame of the rewind history this client is currently rendering the character at
+	FRewindFrame GetRenderedRewindFrame() const;
+	FORCEINLINE void SetRewindFrame(int32 Frame) { RewindFrame = Frame; }
 };
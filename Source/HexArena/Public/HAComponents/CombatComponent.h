@@ -8,6 +8,7 @@
 #include "HUD/HAHUD.h"
 #include "Weapon/AmmoTypes.h"
 #include "HATypes/CombatState.h"
+#include "Weapon/FireEvent.h"
 #include "CombatComponent.generated.h"
 
 #define TRACE_LENGTH 80000.f
@@ -48,6 +49,9 @@ public:
 	UPROPERTY(ReplicatedUsing = OnRep_CarriedAmmo)
 	int32 CarriedAmmo;
 
+	// Simulated proxies only, the server and the shooter already fired with the exact target
+	void SimulatedFire(const FFireEvent& FireEvent);
+
 
 protected:
 	virtual void BeginPlay() override;
@@ -64,13 +68,21 @@ protected:
 	void FireButtonPressed(bool bPressed);
 	void Fire();
 
-	void LocalFire(const FVector_NetQuantize& TraceHitTarget);
+	// False if the shot could not be fired in the current combat state
+	bool LocalFire(const FVector_NetQuantize& TraceHitTarget, const FFireShot& Shot, int32 ShotSequence);
 
-	UFUNCTION(Server, Reliable)
-	void ServerFire(const FVector_NetQuantize& TraceHitTarget);
+	// Unacknowledged shots of the owning client, the server queues the ones it has not seen
+	UFUNCTION(Server, Unreliable)
+	void ServerFireStream(const FFireStream& FireStream);
+
+	// Fires queued shots of the owner, at most one per fire delay of the weapon
+	void ReleaseServerShots();
+
+	// Fires on the server and acknowledges the shot to the owner, if the weapon can fire it
+	void AuthorityFire(int32 ShotSequence, const FFireShot& Shot);
 
-	UFUNCTION(NetMulticast, Reliable)
-	void MulticastFire(const FVector_NetQuantize& TraceHitTarget);
+	// Sends the shot to every other client the shooter is relevant to, HA.Net.FireFanOut
+	void FanOutFireEvent(const FFireEvent& FireEvent);
 
 	UFUNCTION()
 	void TimelineProgress(const float Value);
@@ -160,6 +172,68 @@ private:
 	
 	bool CanFire();
 
+	// CanFire on the server, the fire timer and local reload only run on the shooting machine
+	bool CanAuthorityFire();
+
+	// Least spread the server fires Shot with. Hip fire never gets tighter than the scatter of the weapon, less the aim factor while aiming recovers
+	uint8 GetMinShotSpread(const FFireShot& Shot) const;
+
+	// Server time ADSWeight was last above zero
+	float LastAimedTime = -1.f;
+
+	/*
+	* Fire stream
+	*/
+
+	// Given to the next shot of this component
+	int32 NextShotSequence = 1;
+
+	// Seed and shot count of the current trigger pull
+	uint16 TriggerSeed = 0;
+	int32 TriggerShotIndex = 0;
+
+	FFireStream UnackedShots;
+
+	float LastFireStreamSendTime = 0.f;
+
+	// Last shot of the owner the server processed
+	UPROPERTY(ReplicatedUsing = OnRep_AckedShotSequence)
+	int32 AckedShotSequence = 0;
+
+	UFUNCTION()
+	void OnRep_AckedShotSequence();
+
+	// Shots of the owner received by the server and not fired yet
+	FFireShotQueue ServerShotQueue;
+
+	FTimerHandle ServerShotTimer;
+
+	// Server time of the last shot fired by AuthorityFire
+	float LastAuthorityFireTime = -1.f;
+
+	void QueueShot(int32 ShotSequence, const FFireShot& Shot);
+	void SendFireStream();
+
+	/*
+	* Firing state
+	*/
+
+	// Set while the shooter fired within HA.Net.FiringStateHold, clients without fire events play the fire animation from it
+	UPROPERTY(ReplicatedUsing = OnRep_Firing)
+	bool bFiring = false;
+
+	UFUNCTION()
+	void OnRep_Firing();
+
+	FTimerHandle FiringStateTimer;
+	void FiringStateExpired();
+
+	FTimerHandle DistantFireTimer;
+	void DistantFireTimerFinished();
+
+	// Client time of the last fire event of this shooter
+	float LastFireEventTime = -1.f;
+
 	/*
 	* Ammo
 	*/
@@ -0,0 +1,109 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UHitBoxComponent;
+
+// Box position relative to the actor root, quantized to 16 bits within HitBoxHistory::MaxBoxOffset
+struct FQuantizedBoxOffset
+{
+	int16 X = 0;
+	int16 Y = 0;
+	int16 Z = 0;
+};
+
+/**
+ * Preallocated, compressed ring buffers of hit box poses for every rewindable character.
+ * Every entry has its own ring, frames where the character did not move are not stored.
+ * Root transform is kept at full precision, boxes relative to it with quantized positions and smallest three rotations.
+ * Frames are addressed from 0 (oldest) to Num(Entry) - 1 (newest).
+ * Server frames are the capture counter of UHARewindSubsystem, every one of the last Capacity maps straight to its stored frame.
+ * Boxes are addressed by their index in AHABaseCharacter::HitBoxArray.
+ */
+struct HEXARENA_API FHitBoxHistory
+{
+public:
+	void Init(int32 InCapacity, int32 InNumBoxes);
+
+	// Grows the table to hold at least InNumEntries characters. Allocates, call outside of capture
+	void SetNumEntries(int32 InNumEntries);
+
+	// Forgets previous owner's frames and stores the extents of the new one
+	void ResetEntry(int32 Entry, const TArray<UHitBoxComponent*>& HitBoxes);
+
+	// Compresses the pose of ServerFrame into the entry ring, overwriting its oldest frame once full. Never allocates.
+	// Pose within MoveThreshold of the newest frame reuses the newest frame.
+	// Safe to call from worker threads for different entries
+	void CaptureEntry(int32 Entry, int32 ServerFrame, const FTransform& RootTransform, const TArray<UHitBoxComponent*>& HitBoxes, float MoveThreshold);
+
+	// Stored frame holding the pose of ServerFrame, INDEX_NONE if it was not captured or already overwritten. O(1)
+	int32 FindFrame(int32 Entry, int32 ServerFrame) const;
+
+	// World space pose of one frame. Out arrays must hold GetNumBoxes() elements
+	void DecompressFrame(int32 Entry, int32 Frame, FVector3f* OutLocations, FQuat4f* OutRotations) const;
+
+	// Interpolates every box between two frames at once. Out arrays must hold GetNumBoxes() elements
+	void InterpBetweenFrames(int32 Entry, int32 OlderFrame, int32 YoungerFrame, float Alpha, FVector3f* OutLocations, FQuat4f* OutRotations) const;
+
+	// Pose of the entry Alpha of the way from ServerFrame to ServerFrame + 1. False if ServerFrame is not in the entry history
+	bool GetPoseAtFrame(int32 Entry, int32 ServerFrame, float Alpha, FVector3f* OutLocations, FQuat4f* OutRotations) const;
+
+	SIZE_T GetAllocatedSize() const;
+
+	// Largest box offset from the actor root that quantization can represent, in cm
+	static constexpr float MaxBoxOffset = 256.f;
+
+private:
+	struct FEntryRing
+	{
+		int32 Oldest = 0;
+		int32 NumFrames = 0;
+
+		// Newest frame is a copy of a still pose that keeps standing in for the following server frames
+		bool bNewestIsHold = false;
+	};
+
+	// Stored frame of one server frame. ServerFrame tells apart the server frames sharing the lookup slot
+	struct FServerFrameSlot
+	{
+		int32 ServerFrame = INDEX_NONE;
+		int32 Slot = INDEX_NONE;
+	};
+
+	FORCEINLINE int32 ToSlot(int32 Entry, int32 Frame) const { return Entry * Capacity + (Rings[Entry].Oldest + Frame) % Capacity; }
+	FORCEINLINE int32 ToFrame(int32 Entry, int32 Slot) const { return (Slot - Entry * Capacity - Rings[Entry].Oldest + Capacity) % Capacity; }
+
+	bool IsSamePose(int32 Slot, const FVector3f& RootLocation, const FQuat4f& RootRotation, const FQuantizedBoxOffset* Offsets, const uint32* BoxRotations, float MoveThreshold) const;
+
+	// [Entry * Capacity + Slot], first server frame stored in the slot
+	TArray<int32> ServerFrames;
+	TArray<FVector3f> RootLocations;
+	TArray<FQuat4f> RootRotations;
+
+	// [(Entry * Capacity + Slot) * NumBoxes + BoxIndex], history of one character is contiguous
+	TArray<FQuantizedBoxOffset> BoxOffsets;
+	TArray<uint32> BoxRotations;
+
+	// Extents never change during the game, stored once per entry. [Entry * NumBoxes + BoxIndex]
+	TArray<FVector3f> Extents;
+
+	TArray<FEntryRing> Rings;
+
+	// [Entry * Capacity + ServerFrame % Capacity]
+	TArray<FServerFrameSlot> ServerFrameSlots;
+
+	int32 Capacity = 0;
+	int32 NumBoxes = 0;
+	int32 NumEntries = 0;
+
+public:
+	FORCEINLINE int32 Num(int32 Entry) const { return Rings[Entry].NumFrames; }
+	FORCEINLINE bool IsEmpty(int32 Entry) const { return Rings[Entry].NumFrames == 0; }
+	FORCEINLINE int32 GetCapacity() const { return Capacity; }
+	FORCEINLINE int32 GetNumBoxes() const { return NumBoxes; }
+	FORCEINLINE int32 GetNumEntries() const { return NumEntries; }
+	FORCEINLINE int32 GetServerFrame(int32 Entry, int32 Frame) const { return ServerFrames[ToSlot(Entry, Frame)]; }
+	FORCEINLINE const FVector3f* GetExtents(int32 Entry) const { return Extents.GetData() + Entry * NumBoxes; }
+};
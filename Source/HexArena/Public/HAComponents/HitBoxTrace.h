@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Projectile arc, sampled the same way as UGameplayStatics::PredictProjectilePath
+ */
+struct FHitBoxTraceParams
+{
+	FVector3f Start = FVector3f::ZeroVector;
+	FVector3f Velocity = FVector3f::ZeroVector;
+	float GravityZ = 0.f;
+	float Radius = 0.f;
+	float SimFrequency = 15.f;
+	float MaxSimTime = 2.f;
+};
+
+/**
+ * Oriented boxes of one character, laid out like FHitBoxHistory
+ */
+struct FHitBoxTracePose
+{
+	const FVector3f* Locations = nullptr;
+	const FQuat4f* Rotations = nullptr;
+	const FVector3f* Extents = nullptr;
+	int32 NumBoxes = 0;
+};
+
+struct FHitBoxTraceResult
+{
+	int32 BoxIndex = INDEX_NONE;
+
+	// Flight time of the projectile at the hit
+	float Time = 0.f;
+	FVector3f Location = FVector3f::ZeroVector;
+};
+
+/**
+ * Pure math hit confirmation, never touches the physics scene
+ */
+struct HEXARENA_API FHitBoxTrace
+{
+	// Earliest hit of the arc against boxes [FirstBox, FirstBox + NumBoxesToTest)
+	static bool TraceBallistic(const FHitBoxTraceParams& Params, const FHitBoxTracePose& Pose, int32 FirstBox, int32 NumBoxesToTest, FHitBoxTraceResult& OutResult);
+
+	// Earliest hit of a straight trace from Start to End. Result time is the fraction of the trace
+	static bool TraceSegment(const FVector3f& Start, const FVector3f& End, float Radius, const FHitBoxTracePose& Pose, int32 FirstBox, int32 NumBoxesToTest, FHitBoxTraceResult& OutResult);
+
+	// Slab test of the segment Start + Delta * T, T in [0, 1], against one box grown by Radius
+	static bool SegmentHitsBox(const VectorRegister4Float& Start, const VectorRegister4Float& Delta, const VectorRegister4Float& Radius, const FHitBoxTracePose& Pose, int32 BoxIndex, float& OutT);
+};
@@ -5,11 +5,15 @@
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
 #include "Weapon/HitBoxTypes.h"
+#include "HAComponents/HitBoxHistory.h"
+#include "Subsystems/HARewindSubsystem.h"
 #include "Kismet/GameplayStaticsTypes.h"
 #include "LagCompensationComponent.generated.h"
 
 class AHAPlayerController;
 class AHABaseCharacter;
+class ABaseWeapon;
+struct FWeaponData;
 
 USTRUCT(BlueprintType)
 struct FBoxParams
@@ -34,8 +38,9 @@ struct FFramePackage
 	UPROPERTY()
 	float Time;
 
+	// Indexed like AHABaseCharacter::HitBoxArray
 	UPROPERTY()
-	TMap<FName, FBoxParams> HitBoxParams;
+	TArray<FBoxParams> HitBoxParams;
 
 	UPROPERTY()
 	AHABaseCharacter* Character;
@@ -54,6 +59,26 @@ struct FServerSideRewindResult
 
 };
 
+// Shot of the owner as the server fired it, score requests are traced from it
+struct FFiredShot
+{
+	int32 ShotSequence = 0;
+	TWeakObjectPtr<ABaseWeapon> Weapon;
+	FVector TraceStart = FVector::ZeroVector;
+	FVector ShotTarget = FVector::ZeroVector;
+	int32 Seed = 0;
+	bool bScored = false;
+};
+
+// Hitscan or shotgun score request of the owner, NumPellets is zero for hitscan
+struct FShotScoreRequest
+{
+	int32 ShotSequence = 0;
+	uint8 NumPellets = 0;
+	TArray<TWeakObjectPtr<AHABaseCharacter>, TInlineAllocator<4>> HitCharacters;
+	TArray<FRewindFrame, TInlineAllocator<4>> RewindFrames;
+};
+
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
 class HEXARENA_API ULagCompensationComponent : public UActorComponent
 {
@@ -62,7 +87,6 @@ class HEXARENA_API ULagCompensationComponent : public UActorComponent
 public:	
 	ULagCompensationComponent();
 	friend class AHABaseCharacter;
-	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 	void ShowFramePackage (const FFramePackage& Package, FColor Color);
 
 	/**
@@ -74,39 +98,79 @@ public:
 			AHABaseCharacter* HitCharacter,
 			const FVector_NetQuantize& TraceStart,
 			const FVector_NetQuantize100& Initialvelocity,
-			float HitTime
+			const FRewindFrame& RewindFrame
 		);
 
 	FServerSideRewindResult ProjectileServerSideRewind(
 		AHABaseCharacter* HitCharacter,
 		const FVector_NetQuantize& TraceStart,
 		const FVector_NetQuantize100& Initialvelocity,
-		float HitTime
+		const FRewindFrame& RewindFrame
 	);
 
+	/**
+	* HitScan
+	*/
+
+	// Hit of the shot with ShotSequence, traced from the muzzle and shot target the server fired it with.
+	// Queued on the server and confirmed with every other hitscan request of the tick
+	UFUNCTION(Server, Reliable)
+		void HitScanServerScoreRequest(
+			AHABaseCharacter* HitCharacter,
+			const FRewindFrame& RewindFrame,
+			int32 ShotSequence
+		);
+
+	/**
+	* Shotgun
+	*/
+
+	// Whole blast in one request, pellets are rebuilt from the shot with ShotSequence as the server fired it. RewindFrames[i] is where HitCharacters[i] was rendered
+	UFUNCTION(Server, Reliable)
+		void ShotgunServerScoreRequest(
+			const TArray<AHABaseCharacter*>& HitCharacters,
+			const TArray<FRewindFrame>& RewindFrames,
+			int32 ShotSequence,
+			uint8 NumPellets
+		);
+
+	// Server, every shot of the remote owner UCombatComponent fired. Score requests are only confirmed against these, once per shot
+	void ShotFired(int32 ShotSequence, ABaseWeapon* Weapon, const FVector& TraceStart, const FVector& ShotTarget, int32 Seed);
+
+	static float GetHitBoxDamage(const FWeaponData& WeaponData, EHitBoxType HitBoxType);
+
 protected:
 	virtual void BeginPlay() override;
-	void SaveFramePackage(FFramePackage& Package);
-	FFramePackage InterpBetweenFrames(const FFramePackage& OlderFrame, const FFramePackage& YoungerFrame, float HitTime);
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	// False if RewindFrame is not in the history of the entry
+	bool MakeFramePackage(const FHitBoxHistory& History, int32 Entry, const FRewindFrame& RewindFrame, FFramePackage& OutPackage);
 	
-	FFramePackage GetFrameToCheck(AHABaseCharacter* HitCharacter, float HitTime);
+	FFramePackage GetFrameToCheck(AHABaseCharacter* HitCharacter, const FRewindFrame& RewindFrame);
 
 	void CacheBoxPositions(AHABaseCharacter* HitCharacter, FFramePackage& OutFramePackage);
 	void MoveBoxes(AHABaseCharacter* HitCharacter, const FFramePackage& Package);
 	void ResetHitBoxes(AHABaseCharacter* HitCharacter, const FFramePackage& Package);
 	void EnableCharacterMeshCollision(AHABaseCharacter* HitCharacter, ECollisionEnabled::Type CollisionEnabled);
-	bool CheckIfBoxHitted(AHABaseCharacter* HitCharacter, FPredictProjectilePathParams& PathParams, FPredictProjectilePathResult& PathResult, FName BoxName);
 
 	/**
 	* Projectile
 	*/
 
+	// Intersects the arc with the rewound boxes straight from the history, never touches the physics scene
+	FServerSideRewindResult ProjectileConfirmHitAnalytic(
+		AHABaseCharacter* HitCharacter,
+		const FVector_NetQuantize& TraceStart,
+		const FVector_NetQuantize100& Initialvelocity,
+		const FRewindFrame& RewindFrame
+	);
+
+	// Moves the hit boxes and traces the physics scene. Reference for HA.SSR.CompareWithPhysics
 	FServerSideRewindResult ProjectileConfirmHit(
 		const FFramePackage& Package,
 		AHABaseCharacter* HitCharacter,
 		const FVector_NetQuantize& TraceStart,
 		const FVector_NetQuantize100& Initialvelocity,
-		float HitTime
+		const FRewindFrame& RewindFrame
 	);
 
 private:
@@ -116,13 +180,41 @@ private:
 	UPROPERTY()
 	AHAPlayerController* Controller;
 
-	TDoubleLinkedList<FFramePackage> FrameHistroy;
+	// Frames are captured by the subsystem, this component only queries them
+	UPROPERTY()
+	UHARewindSubsystem* RewindSubsystem;
+
+	int32 HistoryEntry = INDEX_NONE;
 
 	UPROPERTY(EditAnywhere)
 	float MaxRecordTime = 4.f;
 
-public:	
-	
+	// Projectile path used to confirm hits
+	float PathSimFrequency = 15.f;
+	float PathProjectileRadius = 5.f;
+
+	// Frames recorded per second. Zero uses NetServerMaxTickRate
+	UPROPERTY(EditAnywhere)
+	float RecordRate = 0.f;
+
+	/**
+	* Fired shots
+	*/
+
+	// Newest last, at most MaxTrackedShots
+	TArray<FFiredShot> FiredShots;
 
-		
+	// Sent right after the client fired, a request can arrive before the server fires its shot
+	TArray<FShotScoreRequest> PendingScoreRequests;
+
+	int32 LastFiredSequence = 0;
+
+	// Matches the request to its fired shot or holds it until the shot is fired
+	void ReceiveScoreRequest(FShotScoreRequest&& Request);
+
+	// Queues the request on the subsystem, traced from the muzzle and target of the fired shot
+	void QueueShotScoreRequest(const FShotScoreRequest& Request, const FFiredShot& Shot);
+
+public:	
+	FORCEINLINE int32 GetHistoryEntry() const { return HistoryEntry; }
 };
@@ -91,4 +91,5 @@ private:
 	FVector MoveToLocation;
 
 public:	
+	FORCEINLINE UStaticMeshComponent* GetHexMesh() const { return HexMeshComponent; }
 };
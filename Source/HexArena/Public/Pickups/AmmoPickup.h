@@ -6,6 +6,7 @@
 #include "Pickups/BasePickup.h"
 #include "Weapon/AmmoTypes.h"
 #include "Engine/DataTable.h"
+#include "Engine/StreamableManager.h"
 #include "AmmoPickup.generated.h"
 
 
@@ -20,8 +21,8 @@ struct FAmmoPickupData : public FTableRowBase
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
 	EAmmoType AmmoType = EAmmoType::EAT_Rifle;
 
-	UPROPERTY(EditAnywhere, Category = "Mesh")
-	UStaticMesh* Mesh;
+	UPROPERTY(EditAnywhere, Category = "Mesh", meta = (AssetBundles = "Client"))
+	TSoftObjectPtr<UStaticMesh> Mesh;
 };
 
 UCLASS()
@@ -32,13 +33,18 @@ class HEXARENA_API AAmmoPickup : public ABasePickup
 public:
 	AAmmoPickup();
 
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	// Copy of the registry row for blueprints, set when the id is applied
 	UPROPERTY(BlueprintReadWrite)
 	FAmmoPickupData AmmoPickupData;
 
 	UPROPERTY(EditAnywhere, Category = "Table Data")
 	FName AmmoName = "RifleAmmo";
 
+	// Server, before or after the pickup begins play. By name for authored pickups only, loot passes the id
 	void SetAmmoDataByName(FName NewName);
+	void SetAmmoPickupId(int32 NewAmmoPickupId);
 
 protected:
 	virtual void BeginPlay() override;
@@ -48,10 +54,19 @@ protected:
 	UStaticMeshComponent* StaticMeshComponent;
 private:
 	
-	UFUNCTION(NetMulticast, Reliable)
-	void MulticastSetAmmoDataByName(FName NewName);
+	// UHADataRegistry ammo pickup id, every machine resolves the data from it
+	UPROPERTY(ReplicatedUsing = OnRep_AmmoPickupId)
+	uint8 AmmoPickupId = MAX_uint8;
+
+	UFUNCTION()
+	void OnRep_AmmoPickupId();
+
+	void ApplyAmmoPickupId();
+
+	// Keeps the streamed in mesh loaded
+	TSharedPtr<FStreamableHandle> AmmoPickupAssetsHandle;
 
-	UDataTable* AmmoTable;
+	void OnAmmoPickupAssetsLoaded();
 
 	UPROPERTY(EditAnywhere)
 	int32 AmmoAmount = 30;
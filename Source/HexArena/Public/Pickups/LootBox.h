@@ -56,8 +56,8 @@ private:
 	UPROPERTY(EditAnywhere, Category = "LootParams")
 	int32 MaxLootCount = 3;
 
-	TArray<FLootData*> Loot;
-	UDataTable* LootTable;
+	// UHADataRegistry loot ids of the next opening
+	TArray<int32> Loot;
 
 	UPROPERTY(EditAnywhere, Category = "LootParams")
 	float RefilTime = 30.f;
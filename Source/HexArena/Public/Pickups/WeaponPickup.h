@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Pickups/BasePickup.h"
+#include "WeaponPickup.generated.h"
+
+class ABaseWeapon;
+
+/**
+ * Physics body, pickup sphere and widget of a weapon lying on the ground. Weapons themselves carry none of these, the
+ * server takes a pickup from UHAWeaponPickupSubsystem when a weapon is dropped or spawned without an owner, attaches the
+ * weapon to it and hands it back when the weapon is picked up. Pooled pickups are hidden, without collision and dormant.
+ */
+UCLASS()
+class HEXARENA_API AWeaponPickup : public ABasePickup
+{
+	GENERATED_BODY()
+
+public:
+	AWeaponPickup();
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/**
+	 * Pooling, called by UHAWeaponPickupSubsystem on the server
+	 */
+
+	// Moves to where NewWeapon is and carries it
+	void ActivateFromPool(ABaseWeapon* NewWeapon);
+	void DeactivateToPool();
+
+protected:
+	virtual void BeginPlay() override;
+
+private:
+	UPROPERTY(ReplicatedUsing = OnRep_Weapon)
+	ABaseWeapon* Weapon;
+
+	UFUNCTION()
+	void OnRep_Weapon();
+
+	// Physics and collision on while carrying a weapon, on every machine
+	void SetPickupActive(bool bActive);
+
+	void AttachWeapon();
+
+public:
+	FORCEINLINE ABaseWeapon* GetWeapon() const { return Weapon; }
+	FORCEINLINE bool IsInPool() const { return Weapon == nullptr; }
+};
@@ -5,6 +5,7 @@
 #include "CoreMinimal.h"
 #include "GameFramework/PlayerController.h"
 #include "HATypes/Team.h"
+#include "Weapon/FireEvent.h"
 #include "HAPlayerController.generated.h"
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FHighPingDelegate, bool, bPingToHigh);
@@ -15,6 +16,7 @@ class UCharacterOverlay;
 class UUserWidget;
 class UInGameMenu;
 class UHAInventory;
+class AHABaseCharacter;
 
 UCLASS()
 class HEXARENA_API AHAPlayerController : public APlayerController
@@ -49,6 +51,10 @@ public:
 
 	float SingleTripTime = 0.f;
 	FHighPingDelegate HighPingDelegate;
+
+	// Shot of another player this client is close enough to see or hear, sent by UCombatComponent::FanOutFireEvent
+	UFUNCTION(Client, Unreliable)
+	void ClientFireEvent(AHABaseCharacter* Shooter, const FFireEvent& FireEvent);
 protected:
 	virtual void BeginPlay() override;
 	virtual void SetupInputComponent() override;
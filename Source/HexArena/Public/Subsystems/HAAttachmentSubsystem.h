@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "HAAttachmentSubsystem.generated.h"
+
+class ABaseAttachment;
+class UStaticMesh;
+class UStaticMeshComponent;
+class USceneComponent;
+
+USTRUCT()
+struct FAttachmentComponentPool
+{
+	GENERATED_BODY()
+
+	// Unregistered components ready to be handed out
+	UPROPERTY()
+	TArray<UStaticMeshComponent*> Free;
+};
+
+/**
+ * Weapon attachment meshes of every weapon, clients only.
+ * Attachment classes are never spawned. Their defaults are the template of a static mesh component that is attached
+ * to the weapon mesh while the weapon carries the attachment, and goes back to the pool of its class after.
+ * Dedicated servers never create the subsystem, Get returns null on them and weapons keep the attachment stats only.
+ */
+UCLASS()
+class HEXARENA_API UHAAttachmentSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	// Null where nothing is shown
+	static UHAAttachmentSubsystem* Get(const UObject* WorldContextObject);
+
+	// Registered component of AttachmentClass showing Mesh at Socket of Parent
+	UStaticMeshComponent* AcquireAttachment(TSubclassOf<ABaseAttachment> AttachmentClass, UStaticMesh* Mesh, USceneComponent* Parent, FName Socket);
+	void ReleaseAttachment(UStaticMeshComponent* AttachmentComponent);
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+
+private:
+	UPROPERTY()
+	TMap<UClass*, FAttachmentComponentPool> Pools;
+
+	// Class each handed out component returns to
+	UPROPERTY()
+	TMap<UStaticMeshComponent*, UClass*> LiveAttachments;
+
+	bool bEnabled = false;
+};
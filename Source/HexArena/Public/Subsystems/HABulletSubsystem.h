@@ -0,0 +1,134 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "HABulletSubsystem.generated.h"
+
+class AProjectile;
+class ABaseWeapon;
+class AHABaseCharacter;
+class UParticleSystemComponent;
+class UHABulletSubsystem;
+
+USTRUCT()
+struct FHABulletTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	UHABulletSubsystem* Target = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FHABulletTickFunction> : public TStructOpsTypeTraitsBase2<FHABulletTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
+// What the machine that fired a bullet does when it hits, set from the same role branches AProjectileWeapon used for actors
+enum class EBulletFlags : uint8
+{
+	None = 0,
+	// Authority applies weapon damage to what it hits
+	ApplyDamage = 1 << 0,
+	// Locally controlled client sends a projectile score request for a hit character
+	RequestSSR = 1 << 1,
+	// Tracer while flying and impact effects
+	Cosmetic = 1 << 2
+};
+ENUM_CLASS_FLAGS(EBulletFlags);
+
+struct FBulletSpawnParams
+{
+	// Tracer, impact effects, speed and gravity scale are read from its default object
+	TSubclassOf<AProjectile> BulletClass;
+	AHABaseCharacter* Shooter = nullptr;
+	ABaseWeapon* Weapon = nullptr;
+	FVector Location = FVector::ZeroVector;
+	FVector Direction = FVector::ForwardVector;
+	EBulletFlags Flags = EBulletFlags::None;
+};
+
+/**
+ * Simulates every bullet in flight as plain data instead of one projectile actor per round.
+ * Bullets are moved at a fixed step and swept against the world and hit boxes in one parallel batch per step,
+ * hit boxes of characters take damage on the authority and go to ProjectileServerScoreRequest on the shooting client.
+ * Off by default, HA.Bullets.Enabled switches projectile weapons over from actors.
+ */
+UCLASS()
+class HEXARENA_API UHABulletSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	// False while HA.Bullets.Enabled is off, AProjectileWeapon then spawns projectile actors
+	static bool IsEnabled();
+
+	// Index of the bullet until it is removed, INDEX_NONE when it would do nothing on this machine
+	int32 FireBullet(const FBulletSpawnParams& Params);
+
+	// Advances by the fixed steps owed for DeltaTime
+	void Simulate(float DeltaTime);
+
+	FORCEINLINE int32 GetNumBullets() const { return Positions.Num(); }
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+
+private:
+	void Step(float StepTime);
+	void SweepBullets(float StepTime);
+	void HandleHit(int32 Bullet, const FHitResult& Hit);
+	void PlayImpactEffects(int32 Bullet, const FHitResult& Hit);
+	void UpdateTracers();
+	void RemoveBullet(int32 Bullet);
+
+	FHABulletTickFunction SimulateTickFunction;
+
+	/**
+	 * One element per bullet in flight, removed with RemoveAtSwap in every array
+	 */
+
+	TArray<FVector> Positions;
+	TArray<FVector> Velocities;
+	// Collision box of the projectile class, swept along the velocity
+	TArray<FVector> Extents;
+	TArray<float> GravityZ;
+	TArray<double> SpawnTimes;
+	TArray<EBulletFlags> Flags;
+	TArray<TWeakObjectPtr<AHABaseCharacter>> Shooters;
+	TArray<TWeakObjectPtr<ABaseWeapon>> Weapons;
+
+	UPROPERTY()
+	TArray<TSubclassOf<AProjectile>> BulletClasses;
+
+	// Muzzle and launch velocity sent with score requests
+	TArray<FVector> TraceStarts;
+	TArray<FVector> InitialVelocities;
+
+	// Null for bullets without Cosmetic or past the tracer budget of UHAFXSubsystem
+	UPROPERTY()
+	TArray<UParticleSystemComponent*> Tracers;
+
+	/**
+	 * Scratch of SweepBullets, kept to avoid allocating every step
+	 */
+
+	TArray<FVector> SweepEnds;
+	TArray<const AActor*> SweepIgnoredActors;
+	TArray<FHitResult> SweepHits;
+	TArray<uint8> SweepBlocked;
+	TArray<int32> FinishedBullets;
+
+	float StepAccumulator = 0.f;
+};
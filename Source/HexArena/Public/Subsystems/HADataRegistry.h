@@ -0,0 +1,204 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Engine/DataTable.h"
+#include "Engine/StreamableManager.h"
+#include "Engine/World.h"
+#include "HADataRegistry.generated.h"
+
+struct FWeaponData;
+struct FAttachmentData;
+struct FAmmoPickupData;
+struct FLootData;
+struct FTeamColorsData;
+struct FWeaponStats;
+
+/**
+ * Soft references of the rows by who needs them, matching the AssetBundles metadata of the row properties
+ */
+enum class EHAAssetBundle : uint8
+{
+	// Every machine, e.g. weapon meshes for their muzzle sockets
+	Game,
+	// Cosmetics, never loaded on dedicated servers
+	Client
+};
+
+/**
+ * Rows of one data table by dense id, ids follow the order rows are stored in the asset.
+ * Row pointers point into the table, which the registry keeps loaded.
+ */
+template<typename RowType>
+struct THADataTableIndex
+{
+	void Build(const UDataTable* Table)
+	{
+		Rows.Reset();
+		Names.Reset();
+		IdsByName.Reset();
+		if (Table == nullptr || Table->GetRowStruct() == nullptr || !Table->GetRowStruct()->IsChildOf(RowType::StaticStruct())) return;
+
+		for (const TPair<FName, uint8*>& Row : Table->GetRowMap())
+		{
+			IdsByName.Add(Row.Key, Rows.Num());
+			Rows.Add(reinterpret_cast<const RowType*>(Row.Value));
+			Names.Add(Row.Key);
+		}
+	}
+
+	// Authoring only, hashes the name
+	FORCEINLINE int32 FindId(FName RowName) const
+	{
+		const int32* Id = IdsByName.Find(RowName);
+		return Id ? *Id : INDEX_NONE;
+	}
+
+	FORCEINLINE bool IsValidId(int32 Id) const { return Rows.IsValidIndex(Id); }
+	FORCEINLINE const RowType& Get(int32 Id) const { return *Rows[Id]; }
+	FORCEINLINE FName GetName(int32 Id) const { return Names.IsValidIndex(Id) ? Names[Id] : NAME_None; }
+	FORCEINLINE int32 Num() const { return Rows.Num(); }
+
+private:
+	TArray<const RowType*> Rows;
+	TArray<FName> Names;
+	TMap<FName, int32> IdsByName;
+};
+
+/**
+ * Every gameplay data table, loaded once per game instance and indexed by dense integer ids.
+ * Names are only resolved where data is authored (level placed actors, table rows naming other rows), everything
+ * at runtime passes ids around and reads rows by const reference.
+ * Rows hold soft references. Once the actors of a game world are initialized, the bundles of the weapons and ammo
+ * it can contain (level placed or in the loot table when it has loot boxes) are streamed in through the asset
+ * manager and kept until the next world, and the stats of those weapons with all their attachments are built.
+ * Actors load the bundles of their own row too, which is instant when the preload has them.
+ */
+UCLASS()
+class HEXARENA_API UHADataRegistry : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UHADataRegistry();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	static UHADataRegistry* Get(const UObject* WorldContextObject);
+
+	/**
+	 * Weapons
+	 */
+
+	FORCEINLINE int32 FindWeaponId(FName WeaponName) const { return Weapons.FindId(WeaponName); }
+	FORCEINLINE bool IsValidWeaponId(int32 WeaponId) const { return Weapons.IsValidId(WeaponId); }
+	FORCEINLINE const FWeaponData& GetWeapon(int32 WeaponId) const { return Weapons.Get(WeaponId); }
+	FORCEINLINE FName GetWeaponName(int32 WeaponId) const { return Weapons.GetName(WeaponId); }
+	FORCEINLINE int32 GetNumWeapons() const { return Weapons.Num(); }
+
+	// FWeaponData::Attachments resolved to attachment ids, unknown names are left out
+	FORCEINLINE const TArray<int32>& GetWeaponAttachmentIds(int32 WeaponId) const { return WeaponAttachmentIds[WeaponId]; }
+
+	// FWeaponHandle::AttachmentMask of every attachment, what loot and level placed weapons carry
+	FORCEINLINE uint16 GetAllAttachmentsMask(int32 WeaponId) const { return static_cast<uint16>((1 << FMath::Min(WeaponAttachmentIds[WeaponId].Num(), 16)) - 1); }
+
+	// Built on first use of a weapon and attachment combination, then shared by every weapon carrying it. Default stats for invalid ids
+	TSharedRef<const FWeaponStats> GetWeaponStats(int32 WeaponId, uint16 AttachmentMask);
+
+	/**
+	 * Attachments
+	 */
+
+	FORCEINLINE bool IsValidAttachmentId(int32 AttachmentId) const { return Attachments.IsValidId(AttachmentId); }
+	FORCEINLINE const FAttachmentData& GetAttachment(int32 AttachmentId) const { return Attachments.Get(AttachmentId); }
+
+	/**
+	 * Ammo pickups
+	 */
+
+	FORCEINLINE int32 FindAmmoPickupId(FName AmmoName) const { return AmmoPickups.FindId(AmmoName); }
+	FORCEINLINE bool IsValidAmmoPickupId(int32 AmmoPickupId) const { return AmmoPickups.IsValidId(AmmoPickupId); }
+	FORCEINLINE const FAmmoPickupData& GetAmmoPickup(int32 AmmoPickupId) const { return AmmoPickups.Get(AmmoPickupId); }
+	FORCEINLINE FName GetAmmoPickupName(int32 AmmoPickupId) const { return AmmoPickups.GetName(AmmoPickupId); }
+
+	/**
+	 * Loot
+	 */
+
+	FORCEINLINE int32 GetNumLoot() const { return Loot.Num(); }
+	FORCEINLINE const FLootData& GetLoot(int32 LootId) const { return Loot.Get(LootId); }
+
+	// FLootData::LootName resolved to a weapon or ammo pickup id by the pickup type of the row, INDEX_NONE when unknown
+	FORCEINLINE int32 GetLootPickupId(int32 LootId) const { return LootPickupIds[LootId]; }
+
+	/**
+	 * Team colors
+	 */
+
+	FORCEINLINE int32 FindTeamColorsId(FName TeamName) const { return TeamColors.FindId(TeamName); }
+	FORCEINLINE bool IsValidTeamColorsId(int32 TeamColorsId) const { return TeamColors.IsValidId(TeamColorsId); }
+	FORCEINLINE const FTeamColorsData& GetTeamColors(int32 TeamColorsId) const { return TeamColors.Get(TeamColorsId); }
+
+	/**
+	 * Assets
+	 */
+
+	// False on dedicated servers, which skip the client bundle
+	static bool WantsCosmetics(const UObject* WorldContextObject);
+
+	void GetWeaponAssets(int32 WeaponId, EHAAssetBundle Bundle, TArray<FSoftObjectPath>& OutAssets) const;
+	void GetAmmoPickupAssets(int32 AmmoPickupId, EHAAssetBundle Bundle, TArray<FSoftObjectPath>& OutAssets) const;
+	void GetTeamColorsAssets(int32 TeamColorsId, EHAAssetBundle Bundle, TArray<FSoftObjectPath>& OutAssets) const;
+
+	// Streams in the bundles WorldContextObject needs. OnLoaded runs before returning when they are resident already,
+	// the handle keeps them loaded
+	TSharedPtr<FStreamableHandle> LoadWeaponAssets(int32 WeaponId, const UObject* WorldContextObject, FStreamableDelegate OnLoaded) const;
+	TSharedPtr<FStreamableHandle> LoadAmmoPickupAssets(int32 AmmoPickupId, const UObject* WorldContextObject, FStreamableDelegate OnLoaded) const;
+	TSharedPtr<FStreamableHandle> LoadTeamColorsAssets(int32 TeamColorsId, const UObject* WorldContextObject, FStreamableDelegate OnLoaded) const;
+
+private:
+	void BuildIndices();
+
+	static TSharedPtr<FStreamableHandle> LoadAssets(TArray<FSoftObjectPath>&& Assets, FStreamableDelegate OnLoaded, const FString& DebugName);
+
+	// Bundles of everything the world can spawn
+	void OnWorldInitializedActors(const UWorld::FActorsInitializedParams& Params);
+
+	TSharedPtr<FStreamableHandle> WorldPreloadHandle;
+	FDelegateHandle WorldInitializedActorsHandle;
+
+#if WITH_EDITOR
+	void OnTableChanged();
+#endif
+
+	UPROPERTY()
+	UDataTable* WeaponTable;
+
+	UPROPERTY()
+	UDataTable* AttachmentTable;
+
+	UPROPERTY()
+	UDataTable* AmmoPickupTable;
+
+	UPROPERTY()
+	UDataTable* LootTable;
+
+	UPROPERTY()
+	UDataTable* TeamColorsTable;
+
+	THADataTableIndex<FWeaponData> Weapons;
+	THADataTableIndex<FAttachmentData> Attachments;
+	THADataTableIndex<FAmmoPickupData> AmmoPickups;
+	THADataTableIndex<FLootData> Loot;
+	THADataTableIndex<FTeamColorsData> TeamColors;
+
+	TArray<TArray<int32>> WeaponAttachmentIds;
+	TArray<int32> LootPickupIds;
+
+	// By weapon id in the high and attachment mask in the low 16 bits. Cleared when tables change, OnTableChanged
+	// applies the handle of every weapon of the world again
+	TMap<uint32, TSharedRef<const FWeaponStats>> WeaponStatsCache;
+};
@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "HAFXSubsystem.generated.h"
+
+class UParticleSystem;
+class UParticleSystemComponent;
+class USoundBase;
+class UHAFXSubsystem;
+
+USTRUCT()
+struct FHAFXTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	UHAFXSubsystem* Target = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FHAFXTickFunction> : public TStructOpsTypeTraitsBase2<FHAFXTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
+/**
+ * Impact effects and tracers of every weapon, clients only.
+ * Impacts are queued through the frame and played once at its end: nearest first, impacts close to one already played
+ * are merged into it, impacts past the cull distance or the per frame budget are dropped. Impact emitters and tracers
+ * are pooled components. Dedicated servers never create the subsystem, Get returns null on them.
+ */
+UCLASS()
+class HEXARENA_API UHAFXSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	// Null where nothing is shown, callers skip their effects then
+	static UHAFXSubsystem* Get(const UObject* WorldContextObject);
+
+	// Either may be null
+	void PlayImpact(UParticleSystem* Particles, USoundBase* Sound, const FTransform& Transform);
+
+	// Null past HA.FX.MaxTracers
+	UParticleSystemComponent* AcquireTracer(UParticleSystem* Template, const FVector& Location, const FRotator& Rotation);
+	void ReleaseTracer(UParticleSystemComponent* TracerComponent);
+
+	void FlushImpacts();
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+
+private:
+	UParticleSystemComponent* AcquireEmitter(UParticleSystem* Template, const FTransform& Transform);
+
+	UFUNCTION()
+	void OnEmitterFinished(UParticleSystemComponent* EmitterComponent);
+
+	bool GetViewLocation(FVector& OutViewLocation) const;
+
+	FHAFXTickFunction FlushTickFunction;
+
+	struct FImpactRequest
+	{
+		UParticleSystem* Particles = nullptr;
+		USoundBase* Sound = nullptr;
+		FTransform Transform;
+		float DistanceSquared = 0.f;
+	};
+
+	// Flushed every frame, templates are kept alive by the class defaults that requested them
+	TArray<FImpactRequest> PendingImpacts;
+
+	// Played this flush, later impacts near them are merged
+	TArray<FImpactRequest> PlayedImpacts;
+
+	UPROPERTY()
+	TArray<UParticleSystemComponent*> FreeEmitters;
+
+	UPROPERTY()
+	TArray<UParticleSystemComponent*> FreeTracers;
+
+	int32 NumLiveTracers = 0;
+	bool bEnabled = false;
+};
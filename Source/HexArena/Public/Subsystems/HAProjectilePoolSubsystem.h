@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "HAProjectilePoolSubsystem.generated.h"
+
+class AProjectile;
+
+USTRUCT()
+struct FProjectilePool
+{
+	GENERATED_BODY()
+
+	// Hidden projectiles ready to be handed out
+	UPROPERTY()
+	TArray<AProjectile*> Free;
+
+	// Handed out and free projectiles of the class
+	int32 NumSpawned = 0;
+};
+
+/**
+ * Keeps fired projectiles alive and hidden instead of spawning and destroying one per round.
+ * Projectiles never replicate, clients spawn their own from the fire events of UCombatComponent.
+ */
+UCLASS()
+class HEXARENA_API UHAProjectilePoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	// Spawns projectiles of the class up front until the pool holds Count
+	void Prewarm(TSubclassOf<AProjectile> ProjectileClass, int32 Count);
+
+	// Projectile ready to fly from Transform. Spawns one when pooling is off or the pool is empty
+	AProjectile* AcquireProjectile(TSubclassOf<AProjectile> ProjectileClass, const FTransform& Transform, AActor* Owner, APawn* Instigator);
+
+	// Called by the projectile when it hits or times out
+	void ReleaseProjectile(AProjectile* Projectile);
+
+	static bool CanPool(TSubclassOf<AProjectile> ProjectileClass);
+
+	void DumpStats() const;
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+
+private:
+	AProjectile* SpawnLocalProjectile(UClass* ProjectileClass, const FTransform& Transform, AActor* Owner, APawn* Instigator);
+	AProjectile* SpawnPooledProjectile(UClass* ProjectileClass, FProjectilePool& Pool);
+
+	UPROPERTY()
+	TMap<UClass*, FProjectilePool> Pools;
+
+	// Lifetime totals for DumpStats, the stats system only shows them per frame
+	int64 TotalHits = 0;
+	int64 TotalMisses = 0;
+};
@@ -0,0 +1,196 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "HAComponents/HitBoxHistory.h"
+#include "HAComponents/HitBoxTrace.h"
+#include "HARewindSubsystem.generated.h"
+
+class AHABaseCharacter;
+class ABaseWeapon;
+class UHARewindSubsystem;
+
+USTRUCT()
+struct FHARewindTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	UHARewindSubsystem* Target = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FHARewindTickFunction> : public TStructOpsTypeTraitsBase2<FHARewindTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
+/**
+ * Point in the rewind history a client was rendering, Alpha of the way from Frame to Frame + 1.
+ * Frame is the capture counter of UHARewindSubsystem, stamped on every replicated character snapshot.
+ */
+USTRUCT()
+struct FRewindFrame
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 Frame = INDEX_NONE;
+
+	// Quantized to 1/255
+	UPROPERTY()
+	uint8 Alpha = 0;
+
+	FORCEINLINE float GetAlpha() const { return Alpha / 255.f; }
+	FORCEINLINE bool IsValid() const { return Frame != INDEX_NONE; }
+	FORCEINLINE bool operator==(const FRewindFrame& Other) const { return Frame == Other.Frame && Alpha == Other.Alpha; }
+	FORCEINLINE bool operator!=(const FRewindFrame& Other) const { return !(*this == Other); }
+	FORCEINLINE bool operator<(const FRewindFrame& Other) const { return Frame != Other.Frame ? Frame < Other.Frame : Alpha < Other.Alpha; }
+};
+
+enum class EScoreRequestType : uint8
+{
+	HitScan,
+	Projectile,
+	Shotgun
+};
+
+/**
+ * Hit reported by a client, confirmed together with the rest of the tick.
+ * Everything the worker threads need is copied in when queued, they never touch UObjects.
+ */
+struct FScoreRequest
+{
+	EScoreRequestType Type = EScoreRequestType::HitScan;
+
+	TWeakObjectPtr<AHABaseCharacter> Shooter;
+	TWeakObjectPtr<ABaseWeapon> Weapon;
+
+	// One victim, or every victim of a shotgun blast. Entries are their history entries
+	TArray<TWeakObjectPtr<AHABaseCharacter>, TInlineAllocator<4>> HitCharacters;
+	TArray<int32, TInlineAllocator<4>> Entries;
+	TArray<FRewindFrame, TInlineAllocator<4>> RewindFrames;
+
+	// Rewound pose of every victim in the per-tick pose cache, filled when resolved
+	TArray<int32, TInlineAllocator<4>> PoseIndices;
+
+	FVector TraceStart = FVector::ZeroVector;
+
+	// Shot target for hitscan, every pellet end for shotgun, both as the server fired the shot
+	TArray<FVector, TInlineAllocator<16>> TraceEnds;
+
+	// Arc of the projectile, Start and Velocity included
+	FHitBoxTraceParams ProjectileParams;
+
+	double QueuedSeconds = 0.0;
+};
+
+// Hit box BoxIndex of HitCharacters[VictimIndex] of the request. Shotgun requests have one per pellet that hit
+struct FScoreHit
+{
+	int32 VictimIndex = INDEX_NONE;
+	int32 BoxIndex = INDEX_NONE;
+};
+
+using FScoreHits = TArray<FScoreHit, TInlineAllocator<16>>;
+
+/**
+ * Server side owner of the hit box history of every character.
+ * Captures all registered characters once per frame after their pose is final.
+ */
+UCLASS()
+class HEXARENA_API UHARewindSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	// Returns the history entry of the character. The first registration sizes the history
+	int32 RegisterCharacter(AHABaseCharacter* Character, float MaxRecordTime, float RecordRate);
+	void UnregisterCharacter(int32 Entry);
+
+	// Called by the capture tick function in TG_PostUpdateWork. Stamps every character with the new frame
+	void CaptureFrame();
+
+	/**
+	* Score requests
+	*/
+
+	void QueueScoreRequest(FScoreRequest&& Request);
+
+	// Confirms queued requests on worker threads and applies damage, within HA.Rewind.ResolveBudgetMs.
+	// Runs before the capture so the history is not written while workers read it
+	void ResolveScoreRequests();
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+
+private:
+	void InitHistory(int32 NumBoxes, float MaxRecordTime, float RecordRate);
+
+	// Points every victim of the requests at a cached pose, then rewinds the poses not cached yet in parallel. Returns cache hits
+	int32 CacheRequestPoses(int32 FirstRequest, int32 NumRequests);
+
+	// Worker thread part, reads only the request and the pose cache
+	void ConfirmScoreRequest(const FScoreRequest& Request, FScoreHits& OutHits) const;
+
+	// Game thread part, merges the hits into one damage event per victim
+	void ApplyScoreHits(const FScoreRequest& Request, const FScoreHits& Hits);
+
+	// Reconstructs the newest frame of every character and compares it with the live hit boxes
+	void ValidateCompression(float MoveThreshold);
+
+	FHitBoxHistory History;
+
+	// Indexed by history entry, free entries are null
+	UPROPERTY()
+	TArray<AHABaseCharacter*> Characters;
+
+	TArray<int32> FreeEntries;
+
+	// Oldest first, requests over the budget are carried over to the next tick
+	TArray<FScoreRequest> ScoreRequests;
+	TArray<FScoreHits> ScoreHits;
+
+	/**
+	* Pose cache, shooters hitting the same victim at the same frame in one tick rewind it once. Cleared every tick
+	*/
+
+	struct FCachedPose
+	{
+		int32 Entry = INDEX_NONE;
+		FRewindFrame RewindFrame;
+		bool bValid = false;
+	};
+
+	// Entry, frame and alpha packed into one key
+	static uint64 MakePoseKey(int32 Entry, const FRewindFrame& RewindFrame);
+
+	TMap<uint64, int32> PoseIndexByKey;
+	TArray<FCachedPose> CachedPoses;
+
+	// [PoseIndex * NumBoxes + BoxIndex]
+	TArray<FVector3f> CachedLocations;
+	TArray<FQuat4f> CachedRotations;
+
+	FHARewindTickFunction CaptureTickFunction;
+
+	bool bHistoryInitialized = false;
+	float MinRecordInterval = 0.f;
+	float LastCaptureTime = -MAX_flt;
+
+	// Monotonic capture counter, the server frame the history is addressed by
+	int32 CurrentFrame = INDEX_NONE;
+
+public:
+	FORCEINLINE const FHitBoxHistory& GetHistory() const { return History; }
+	FORCEINLINE int32 GetCurrentFrame() const { return CurrentFrame; }
+};
@@ -0,0 +1,139 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "HAShellSubsystem.generated.h"
+
+class ABulletShell;
+class AHexBlock;
+class UInstancedStaticMeshComponent;
+class USoundCue;
+class UHAShellSubsystem;
+
+USTRUCT()
+struct FHAShellTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	UHAShellSubsystem* Target = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FHAShellTickFunction> : public TStructOpsTypeTraitsBase2<FHAShellTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
+// Instances of one shell mesh, hidden instances are scaled to zero and reused
+USTRUCT()
+struct FShellMeshPool
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UInstancedStaticMeshComponent* Instances = nullptr;
+
+	UPROPERTY()
+	USoundCue* ImpactSound = nullptr;
+
+	float LifeTime = 5.f;
+	float EjectionSpeed = 250.f;
+
+	TArray<FTransform> Transforms;
+	TArray<int32> FreeSlots;
+
+	// Transforms changed since the last upload
+	bool bDirty = false;
+};
+
+/**
+ * Cosmetic shell ejection of every weapon, clients only.
+ * Shells are instances of one instanced static mesh per shell class, moved by a ballistic integrator that only knows
+ * hex tops and the arena floor. Live shells are capped, the oldest is reused when a new one would go past the cap.
+ * Dedicated servers never create the subsystem and server builds compile the simulation out.
+ */
+UCLASS()
+class HEXARENA_API UHAShellSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	// Shell of ShellClass leaving Transform along its forward vector, on top of the velocity of the weapon
+	void EjectShell(TSubclassOf<ABulletShell> ShellClass, const FTransform& Transform, const FVector& InheritedVelocity);
+
+	void Simulate(float DeltaTime);
+
+	FORCEINLINE int32 GetNumShells() const { return NumShells; }
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+
+private:
+	int32 FindOrAddPool(TSubclassOf<ABulletShell> ShellClass);
+	void ReleaseShell(int32 Shell);
+	void CacheHexTops();
+	float GetGroundZ(const FVector& Location) const;
+	bool TryPlayImpactSound(int32 Pool, const FVector& Location);
+
+	FHAShellTickFunction SimulateTickFunction;
+
+	UPROPERTY()
+	TMap<UClass*, int32> PoolIndexByClass;
+
+	UPROPERTY()
+	TArray<FShellMeshPool> Pools;
+
+	/**
+	 * Ring of live shells, oldest at Tail. Sized to HA.Shells.MaxLive
+	 */
+
+	TArray<FVector> Positions;
+	TArray<FVector3f> Velocities;
+	TArray<FQuat4f> Rotations;
+	// Axis times radians per second
+	TArray<FVector3f> Spins;
+	TArray<float> Ages;
+	TArray<uint8> PoolIndices;
+	TArray<int32> InstanceSlots;
+	// Ground without hex tops, traced at ejection on maps without hex blocks
+	TArray<float> FloorZs;
+	TArray<bool> bResting;
+
+	int32 Tail = 0;
+	int32 NumShells = 0;
+
+	/**
+	 * Hex tops, blocks only move up and down so the grid is built once
+	 */
+
+	struct FHexTop
+	{
+		TWeakObjectPtr<AHexBlock> Block;
+		FVector2D Center;
+		float RadiusSquared = 0.f;
+		// From the actor location to the top of the hex mesh
+		float TopOffset = 0.f;
+	};
+
+	TArray<FHexTop> HexTops;
+	TMultiMap<FIntPoint, int32> HexTopsByCell;
+	float HexCellSize = 0.f;
+	// Lowest hex top, shells outside every hex fall to it
+	float FloorZ = 0.f;
+	bool bHexTopsCached = false;
+
+	// Impact sounds left this second
+	float SoundBudget = 0.f;
+};
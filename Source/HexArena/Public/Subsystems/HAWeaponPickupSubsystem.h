@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "HAWeaponPickupSubsystem.generated.h"
+
+class ABaseWeapon;
+class AWeaponPickup;
+
+USTRUCT()
+struct FWeaponPickupPool
+{
+	GENERATED_BODY()
+
+	// Hidden pickups ready to be handed out
+	UPROPERTY()
+	TArray<AWeaponPickup*> Free;
+
+	// Handed out and free pickups of the class
+	int32 NumSpawned = 0;
+};
+
+/**
+ * Pickups of the weapons lying on the ground, server only. A weapon is dropped by taking a pickup of its PickupClass and
+ * picked up by handing it back, so the pool grows to the most weapons on the ground at once and no actors are spawned
+ * for drops after that. Pickups replicate, clients only see them come and go.
+ */
+UCLASS()
+class HEXARENA_API UHAWeaponPickupSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	// Null on clients
+	static UHAWeaponPickupSubsystem* Get(const UObject* WorldContextObject);
+
+	// Pickup carrying Weapon where it is
+	AWeaponPickup* AcquirePickup(TSubclassOf<AWeaponPickup> PickupClass, ABaseWeapon* Weapon);
+	void ReleasePickup(AWeaponPickup* Pickup);
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+
+private:
+	UPROPERTY()
+	TMap<UClass*, FWeaponPickupPool> Pools;
+};
@@ -6,8 +6,10 @@
 #include "GameFramework/Actor.h"
 #include "Weapon/AmmoTypes.h"
 #include "Weapon/WeaponTypes.h"
+#include "Weapon/FireEvent.h"
+#include "Weapon/WeaponSpread.h"
 #include "Engine/DataTable.h"
-#include "Pickups/BasePickup.h"
+#include "Engine/StreamableManager.h"
 #include "Attachments.h"
 #include "BaseWeapon.generated.h"
 
@@ -18,6 +20,11 @@ class AHABaseCharacter;
 class AHAPlayerController;
 class ABaseAttachment;
 class AScopeAttachment;
+class AWeaponPickup;
+class UStaticMeshComponent;
+class USceneCaptureComponent2D;
+class UCurveFloat;
+struct FAttachmentData;
 
 
 
@@ -76,8 +83,9 @@ struct FWeaponData : public FTableRowBase
 	* Weapon Mesh and Attachments
 	*/
 
-	UPROPERTY(EditAnywhere, Category = "Weapon")
-	USkeletalMesh* WeaponMesh;
+	// Game bundle, servers need its sockets
+	UPROPERTY(EditAnywhere, Category = "Weapon", meta = (AssetBundles = "Game"))
+	TSoftObjectPtr<USkeletalMesh> WeaponMesh;
 
 	UPROPERTY(EditAnywhere, Category = "Attachments")
 	TArray<FName> Attachments;
@@ -86,8 +94,8 @@ struct FWeaponData : public FTableRowBase
 	 *  Effects and animations
 	 */
 
-	UPROPERTY(EditAnywhere, Category = "Effects and animations")
-	UAnimationAsset* FireAnimation;
+	UPROPERTY(EditAnywhere, Category = "Effects and animations", meta = (AssetBundles = "Client"))
+	TSoftObjectPtr<UAnimationAsset> FireAnimation;
 
 	/*
 	* Ammo and Damage
@@ -99,8 +107,8 @@ struct FWeaponData : public FTableRowBase
 	UPROPERTY(EditAnywhere, Category = "Ammo")
 	int32 MagCapacity = 30;
 
-	UPROPERTY(EditAnywhere, Category = "Ammo")
-	TSubclassOf<class ABulletShell> BulletShellClass;
+	UPROPERTY(EditAnywhere, Category = "Ammo", meta = (AssetBundles = "Client"))
+	TSoftClassPtr<class ABulletShell> BulletShellClass;
 
 	UPROPERTY(EditAnywhere, Category = "Ammo")
 	EAmmoType AmmoType = EAmmoType::EAT_Rifle;
@@ -149,6 +157,16 @@ struct FWeaponData : public FTableRowBase
 	UPROPERTY(EditAnywhere, Category = "Automatic")
 	int32 ShotsInBurst = 3;
 
+	/*
+	* Recoil, degrees by shot index of a trigger pull
+	*/
+
+	UPROPERTY(EditAnywhere, Category = "Recoil", meta = (AssetBundles = "Game"))
+	TSoftObjectPtr<UCurveFloat> RecoilYawCurve;
+
+	UPROPERTY(EditAnywhere, Category = "Recoil", meta = (AssetBundles = "Game"))
+	TSoftObjectPtr<UCurveFloat> RecoilPitchCurve;
+
 	/*
 	* Aim properties
 	*/
@@ -190,26 +208,71 @@ struct FWeaponData : public FTableRowBase
 	* Crosshair
 	*/
 
-	UPROPERTY(EditAnywhere, Category = "Crosshairs")
-	UTexture2D* CrosshairsCenter;
+	UPROPERTY(EditAnywhere, Category = "Crosshairs", meta = (AssetBundles = "Client"))
+	TSoftObjectPtr<UTexture2D> CrosshairsCenter;
+
+	UPROPERTY(EditAnywhere, Category = "Crosshairs", meta = (AssetBundles = "Client"))
+	TSoftObjectPtr<UTexture2D> CrosshairsLeft;
+
+	UPROPERTY(EditAnywhere, Category = "Crosshairs", meta = (AssetBundles = "Client"))
+	TSoftObjectPtr<UTexture2D> CrosshairsRight;
 
-	UPROPERTY(EditAnywhere, Category = "Crosshairs")
-	UTexture2D* CrosshairsLeft;
+	UPROPERTY(EditAnywhere, Category = "Crosshairs", meta = (AssetBundles = "Client"))
+	TSoftObjectPtr<UTexture2D> CrosshairsTop;
 
-	UPROPERTY(EditAnywhere, Category = "Crosshairs")
-	UTexture2D* CrosshairsRight;
+	UPROPERTY(EditAnywhere, Category = "Crosshairs", meta = (AssetBundles = "Client"))
+	TSoftObjectPtr<UTexture2D> CrosshairsBottom;
+};
+
+
+/**
+ * All a weapon replicates about what it is, every machine resolves the weapon data from its own copy of the weapon table
+ */
+USTRUCT()
+struct FWeaponHandle
+{
+	GENERATED_BODY()
+
+	// UHADataRegistry weapon id
+	UPROPERTY()
+	uint8 WeaponId = MAX_uint8;
 
-	UPROPERTY(EditAnywhere, Category = "Crosshairs")
-	UTexture2D* CrosshairsTop;
+	// Bit per entry of UHADataRegistry::GetWeaponAttachmentIds the weapon carries
+	UPROPERTY()
+	uint16 AttachmentMask = 0;
 
-	UPROPERTY(EditAnywhere, Category = "Crosshairs")
-	UTexture2D* CrosshairsBottom;
+	FORCEINLINE bool IsValid() const { return WeaponId != MAX_uint8; }
 };
 
+/**
+ * Weapon row with a set of its attachments applied. UHADataRegistry builds it once per weapon and attachment
+ * combination and every weapon carrying that combination shares it read only.
+ */
+struct HEXARENA_API FWeaponStats
+{
+	FWeaponStats() = default;
+
+	// Attachments apply by EAttachmentType, within a type in the order given, so a later mag sets the capacity
+	FWeaponStats(const FWeaponData& Weapon, TArray<const FAttachmentData*> Attachments);
+
+	// Stats of a weapon with no weapon data yet
+	static const TSharedRef<const FWeaponStats>& GetDefault();
+
+	// MagCapacity, ZoomedFOV, ZoomInterpSpeed and HipScatterDistance include the attachments
+	FWeaponData WeaponData;
+
+	// Seconds between automatic shots
+	float FireDelay = 0.1f;
 
+	// Attachment recoil reduction, yaw (X) and pitch (Y)
+	FVector2f RecoilScale = FVector2f(1.f, 1.f);
+
+	// Baked from the recoil curves for a full magazine
+	FWeaponSpread Spread;
+};
 
 UCLASS()
-class HEXARENA_API ABaseWeapon : public ABasePickup
+class HEXARENA_API ABaseWeapon : public AActor
 {
 	GENERATED_BODY()
 	
@@ -220,41 +283,75 @@ public:
 
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 	virtual void OnRep_Owner() override;
+	virtual void SetOwner(AActor* NewOwner) override;
 	void SetHUDAmmo();
 	virtual void Fire(const FVector& HitTarget);
+
+	// Fire of one shot of the fire stream, weapons with random patterns beyond the shot target seed them from Shot.
+	// Score requests of the shooter carry ShotSequence, the server only confirms them against shots it fired
+	virtual void FireShot(const FVector& HitTarget, const FFireShot& Shot, int32 ShotSequence);
+
+	// Muzzle flash and sound of the fire animation without a shot, for shooters too far away to get fire events
+	void PlayFireAnimation();
+
+	// Cosmetic shot on a simulated proxy, by default fired at the event direction from the local muzzle
+	virtual void FireFromEvent(const FFireEvent& FireEvent);
+
+	// Built on the server after it fired Shot at HitTarget
+	FFireEvent MakeFireEvent(const FVector& HitTarget, const FFireShot& Shot);
+
+	// Seed of the random patterns of a shot, from its trigger seed and shot index so every machine derives the same one
+	static int32 GetFireSeed(const FFireShot& Shot);
+
+	// Owning client, before the shot spends its round
+	void AddPendingShot(int32 ShotSequence);
+
+	// Server, after the shot spent its round
+	void AckShot(int32 ShotSequence);
 	void Dropped();
 	void ToInventory();
 	void AddAmmo(int32 AmmoToAdd);
 
+	// Server, before or after the weapon begins play. By name for authored weapons only, loot passes the id
 	void SetWeaponDataByName(FName NewName);
+	void SetWeaponId(int32 WeaponId);
+
+	// Target after recoil and spread of the shot, the same on the shooter and the server
+	FVector GetShotTarget(const FFireShot& Shot);
 
-	FVector TraceEndWithcSpread(const FVector& HitTarget, float Spread);
+	// MuzzleFlash socket, the actor location for meshes without one
+	FVector GetMuzzleLocation() const;
 
 	/*
 	* WeaponData
 	*/
 
-	UPROPERTY(Replicated, BlueprintReadWrite, EditAnywhere, Category = "WeaponData")
-	FWeaponData WeaponData;
+	// Shared stats of WeaponHandle, resolved on every machine and never replicated
+	FORCEINLINE const FWeaponData& GetWeaponData() const { return Stats->WeaponData; }
 
-	 /*
-	 * Automatic
-	 */
+	// Copy of GetWeaponData for blueprints, edit the weapon table row instead of the weapon
+	UFUNCTION(BlueprintPure, Category = "WeaponData", meta = (DisplayName = "Get Weapon Data"))
+	FWeaponData K2_GetWeaponData() const;
 
-	 float FireDelay;
+#if WITH_EDITOR
+	// Applies WeaponHandle again after UHADataRegistry rebuilt from an edited table, the loaded rounds stay
+	void OnWeaponTableChanged();
+#endif
+	FORCEINLINE float GetFireDelay() const { return Stats->FireDelay; }
 
 	 UFUNCTION(Category = "IK")
 	 FTransform GetsightsWorldTransform() const;
 
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	virtual void OnWeaponStateSet();
 	virtual void OnEquipped();
 	virtual void OnDropped();
 	virtual void OnInventory();
 
-	virtual void EnableCustomDepth(bool bEnable) override;
+	virtual void EnableCustomDepth(bool bEnable);
 
 	UFUNCTION()
 	void OnPingToHigh(bool bPingTooHigh);
@@ -265,14 +362,33 @@ protected:
 	UPROPERTY(Replicated, EditAnywhere)
 	bool bUseSSR = true;
 
-	/*void CreateAndSetupAttachment(FName Name);*/
-	void CreateAttachment(FName Name);
-
 private:	
 
 	UPROPERTY(EditAnywhere, Category = "Weapon Mesh")
 	USkeletalMeshComponent* WeaponMeshComponent;
 
+	/**
+	 * Pickup, server only
+	 */
+
+	// Physics body, pickup sphere and widget while the weapon is on the ground
+	UPROPERTY(EditDefaultsOnly, Category = "Pickup")
+	TSubclassOf<AWeaponPickup> PickupClass;
+
+	// Carries the weapon while nobody owns it
+	UPROPERTY()
+	AWeaponPickup* Pickup;
+
+	void AcquirePickup();
+	void ReleasePickup();
+
+	// Declared before WeaponState so attachments exist when the first state is applied
+	UPROPERTY(ReplicatedUsing = OnRep_WeaponHandle)
+	FWeaponHandle WeaponHandle;
+
+	UFUNCTION()
+	void OnRep_WeaponHandle();
+
 	UPROPERTY(ReplicatedUsing = OnRep_WeaponState, VisibleAnywhere, Category = "Weapon Properties")
 	EWeaponState WeaponState;
 
@@ -285,20 +401,53 @@ private:
 	UPROPERTY(EditAnywhere, Category = "Table Data")
 	FName WeaponName;
 
-	UFUNCTION(Client, Reliable)
-	void ClientUpdateAmmo(int32 ServerAmmo);
+	// Weapon data, attachments, recoil and mesh of WeaponHandle
+	void ApplyWeaponHandle();
+
+	// Keeps the streamed in assets of the weapon data loaded
+	TSharedPtr<FStreamableHandle> WeaponAssetsHandle;
 
-	UFUNCTION(Client, Reliable)
-	void ClientAddAmmo(int32 AmmoToAdd);
+	void OnWeaponAssetsLoaded();
 
-	UFUNCTION(NetMulticast, Reliable)
-	void MulticastSetWeaponDataByName(FName NewName);
+	/**
+	 * Attachments, cosmetic and clients only
+	 */
+
+	// Meshes of the attachments in WeaponHandle from UHAAttachmentSubsystem, after the weapon mesh is loaded
+	void CreateAttachments();
+	void ReleaseAttachments();
+
+	// Captures through the scope only while the locally controlled owner has the weapon equipped
+	void UpdateScopeCapture();
+
+	UPROPERTY()
+	TArray<UStaticMeshComponent*> AttachmentComponents;
+
+	// Owners aim through its "Sights" socket
+	UPROPERTY()
+	UStaticMeshComponent* SightComponent;
+
+	// Class of the sight when it is a scope, its ScopeCamera is the template of ScopeCapture
+	UPROPERTY()
+	TSubclassOf<AScopeAttachment> ScopeClass;
+
+	UPROPERTY()
+	USceneCaptureComponent2D* ScopeCapture;
 
 	void SpendRound();
 
-	//	The number of unprocessed server requses for ammo.
-	//	Incremented in SpendRound, Decremented in FireUpdateAmmo
-	int32 UnprocessedSequence = 0;
+	// Server ammo, the owner subtracts its shots the server has not processed yet
+	UPROPERTY(ReplicatedUsing = OnRep_AmmoAck)
+	FAmmoAck AmmoAck;
+
+	UFUNCTION()
+	void OnRep_AmmoAck();
+
+	// Sequences of shots fired by the owning client and not acknowledged yet
+	TArray<int32> PendingShots;
+
+	// The owner got the server ammo at least once, until then the magazine is full
+	bool bAmmoAckReceived = false;
 
 	UPROPERTY()
 	AHABaseCharacter* HAOwnerCharacter;
@@ -306,26 +455,22 @@ private:
 	UPROPERTY()
 	AHAPlayerController* HAOwnerController;
 
-	UDataTable* WeaponTable;
-	UDataTable* AttachmentsTable;
-
-	TArray<ABaseAttachment*> Attachments;
-	ABaseAttachment* Sight;
+	// From UHADataRegistry::GetWeaponStats, never null
+	TSharedPtr<const FWeaponStats> Stats;
 
 public:
 	void SetWeaponState(EWeaponState State);
 	FORCEINLINE EWeaponState GetWeaonState () { return WeaponState; }
-	FORCEINLINE USphereComponent* GetAreaSphere() const { return AreaSphere; }
+	FORCEINLINE AWeaponPickup* GetPickup() const { return Pickup; }
 	FORCEINLINE USkeletalMeshComponent* GetWeaponMesh() { return WeaponMeshComponent; }
-	FORCEINLINE float GetZoomedFOV() const { return WeaponData.ZoomedFOV; }
-	FORCEINLINE float GetZoomInterpSpeed() const { return WeaponData.ZoomInterpSpeed; }
+	FORCEINLINE float GetZoomedFOV() const { return Stats->WeaponData.ZoomedFOV; }
+	FORCEINLINE float GetZoomInterpSpeed() const { return Stats->WeaponData.ZoomInterpSpeed; }
 	FORCEINLINE int32 GetAmmo() const { return Ammo; }
-	FORCEINLINE int32 GetMagCapacity() const { return WeaponData.MagCapacity; }
+	FORCEINLINE int32 GetMagCapacity() const { return Stats->WeaponData.MagCapacity; }
 	bool IsEmpty();
-	FORCEINLINE EAmmoType GetWeaponAmmoType() const { return WeaponData.AmmoType; }
-	FORCEINLINE EWeaponType GetWeaponType() const { return WeaponData.WeaponType; }
-	FORCEINLINE bool IsFull() { return Ammo == WeaponData.MagCapacity; }
-	FORCEINLINE TArray<ABaseAttachment*>& GetAttachments() { return Attachments;}
+	FORCEINLINE EAmmoType GetWeaponAmmoType() const { return Stats->WeaponData.AmmoType; }
+	FORCEINLINE EWeaponType GetWeaponType() const { return Stats->WeaponData.WeaponType; }
+	FORCEINLINE bool IsFull() { return Ammo == Stats->WeaponData.MagCapacity; }
 
 
 	//FTransform GetsightsWorldTransform() const;
@@ -35,4 +35,14 @@ private:
 
 	UPROPERTY(EditAnywhere)
 	USoundCue* ShellSound;
+
+	// Launch speed of shells simulated by UHAShellSubsystem, which never spawns this actor
+	UPROPERTY(EditAnywhere)
+	float EjectionSpeed = 250.f;
+
+public:
+	FORCEINLINE UStaticMeshComponent* GetShellMesh() const { return BulletShellMesh; }
+	FORCEINLINE USoundCue* GetShellSound() const { return ShellSound; }
+	FORCEINLINE float GetLifeTime() const { return LifeTime; }
+	FORCEINLINE float GetEjectionSpeed() const { return EjectionSpeed; }
 };
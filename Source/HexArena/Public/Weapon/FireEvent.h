@@ -0,0 +1,116 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "FireEvent.generated.h"
+
+/**
+ * One shot as the server broadcasts it to simulated proxies.
+ * Clients rebuild the cosmetic side of the shot from it, the authoritative projectile or trace only exists on the server.
+ */
+USTRUCT()
+struct FFireEvent
+{
+	GENERATED_BODY()
+
+	// Muzzle on the server, rounded to whole units
+	UPROPERTY()
+	FVector_NetQuantize Origin;
+
+	UPROPERTY()
+	FVector_NetQuantizeNormal Direction;
+
+	// EWeaponType of the weapon that fired, events for a weapon swapped out in the meantime are dropped
+	UPROPERTY()
+	uint8 WeaponType = 0;
+
+	// Capture frame of UHARewindSubsystem the shot was fired on
+	UPROPERTY()
+	int32 ServerFrame = INDEX_NONE;
+
+	// Seeds random spread, the same on every machine
+	UPROPERTY()
+	int32 Seed = 0;
+
+	FORCEINLINE FVector GetHitTarget(float Distance) const { return Origin + FVector(Direction) * Distance; }
+};
+
+/**
+ * Input of one shot, every machine derives the same shot target from it with ABaseWeapon::GetShotTarget
+ */
+USTRUCT()
+struct FFireShot
+{
+	GENERATED_BODY()
+
+	// Crosshair target before recoil and spread
+	UPROPERTY()
+	FVector_NetQuantize AimTarget;
+
+	// Drawn when the trigger is pulled, shared by every shot until it is released
+	UPROPERTY()
+	uint16 TriggerSeed = 0;
+
+	// Shot of the trigger pull, indexes the recoil pattern
+	UPROPERTY()
+	uint8 ShotIndex = 0;
+
+	// Hip spread of the shooter, FWeaponSpread::QuantizeSpread
+	UPROPERTY()
+	uint8 Spread = 0;
+
+	// Aim state the shooter fired with, the replicated one can lag behind it on the server
+	UPROPERTY()
+	bool bAiming = false;
+};
+
+/**
+ * Shots of the owning client the server has not acknowledged yet, sent unreliably and resent until acknowledged.
+ * Every shot carries its own input, so a lost packet is covered by the next one.
+ */
+USTRUCT()
+struct FFireStream
+{
+	GENERATED_BODY()
+
+	// Sequence of Shots[0], the following shots count up from it
+	UPROPERTY()
+	int32 FirstSequence = 0;
+
+	UPROPERTY()
+	TArray<FFireShot> Shots;
+
+	// Adds the next shot of the owner, the oldest shots past MaxShots are given up as lost
+	void AddShot(int32 ShotSequence, const FFireShot& Shot, int32 MaxShots);
+
+	// Drops the shots up to AckedSequence
+	void Acknowledge(int32 AckedSequence);
+};
+
+/**
+ * Shots of the owner the server received and has not fired yet, in sequence order.
+ * The server fires them from the front and acknowledges each one it processed.
+ */
+struct FFireShotQueue
+{
+	// Queues the shots of Stream newer than every shot queued or processed, false for streams longer than MaxShots.
+	// Shots the client gave up on before any of them arrived are lost, AckedSequence moves past them
+	bool Receive(const FFireStream& Stream, int32 MaxShots, int32& AckedSequence);
+
+	TArray<TPair<int32, FFireShot>> Shots;
+};
+
+// Ammo of a weapon on the server, after the shot with ShotSequence
+USTRUCT()
+struct FAmmoAck
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 Ammo = 0;
+
+	UPROPERTY()
+	int32 ShotSequence = 0;
+};
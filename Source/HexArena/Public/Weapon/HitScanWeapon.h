@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Weapon/BaseWeapon.h"
+#include "HitScanWeapon.generated.h"
+
+class UParticleSystem;
+class USoundCue;
+
+/**
+ * Weapon that hits instantly with a line trace, no projectile actors are spawned
+ */
+UCLASS()
+class HEXARENA_API AHitScanWeapon : public ABaseWeapon
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Fire(const FVector& HitTarget) override;
+	virtual void FireShot(const FVector& HitTarget, const FFireShot& Shot, int32 ShotSequence) override;
+
+protected:
+	// Traces hit boxes and level geometry from the muzzle towards HitTarget
+	void WeaponTraceHit(const FVector& TraceStart, const FVector& HitTarget, FHitResult& OutHit);
+	void PlayImpactEffects(const FHitResult& FireHit);
+
+private:
+	// Hits of shots outside of the fire stream, INDEX_NONE, are never reported to the server
+	void FireWithSequence(const FVector& HitTarget, int32 ShotSequence);
+
+	UPROPERTY(EditAnywhere)
+	UParticleSystem* ImpactParticles;
+
+	UPROPERTY(EditAnywhere)
+	USoundCue* HitSound;
+};
@@ -37,6 +37,16 @@ public:
 
 	float Damage = 25.f;
 
+	/**
+	 * Pooling, called by UHAProjectilePoolSubsystem
+	 */
+
+	// Resets every per round member and starts flying from Transform
+	void ActivateFromPool(const FTransform& Transform, AActor* NewOwner, APawn* NewInstigator);
+
+	// Hides the projectile and stops movement, collision and tracer
+	void DeactivateToPool();
+
 protected:
 
 	virtual void BeginPlay() override;
@@ -50,6 +60,9 @@ protected:
 	UPROPERTY()
 	ABaseWeapon* InstigatorWeapon;
 
+	// End of the flight, back to the pool when pooled, destroyed otherwise
+	void FinishFlight();
+
 private:
 	UPROPERTY(EditAnywhere)
 	UBoxComponent* CollisionBox;
@@ -57,6 +70,8 @@ private:
 	UPROPERTY(EditAnywhere)
 	UParticleSystem* Tracer;
 
+	// Borrowed from UHAFXSubsystem while flying, null on dedicated servers and past the tracer budget
+	UPROPERTY()
 	UParticleSystemComponent* TracerComponent;
 
 	UPROPERTY(EditAnywhere)
@@ -65,8 +80,34 @@ private:
 	UPROPERTY(EditAnywhere)
 	USoundCue* ImpactSound;
 
+	void PlayImpactEffects();
+	void AcquireTracer();
+	void ReleaseTracer();
+
+	// Without impact effects, for projectiles that flew out of PooledLifeTime
+	void ReturnToPool();
+
+	// Pooled projectiles that never hit go back to the pool after this long
+	UPROPERTY(EditAnywhere)
+	float PooledLifeTime = 5.f;
+
+	FTimerHandle PooledLifeTimer;
+
+	bool bPooled = false;
+	bool bInPool = false;
+
 public:	
 	FORCEINLINE void SetInstigatorWeapon (ABaseWeapon* Weapon) { InstigatorWeapon = Weapon; }
+	FORCEINLINE void SetPooled(bool bNewPooled) { bPooled = bNewPooled; }
+	FORCEINLINE bool IsPooled() const { return bPooled; }
+	FORCEINLINE bool IsInPool() const { return bInPool; }
+
+	// Read from the class default object by UHABulletSubsystem, which simulates rounds without spawning the actor
+	FORCEINLINE UParticleSystem* GetTracer() const { return Tracer; }
+	FORCEINLINE UParticleSystem* GetImpactParticles() const { return ImpactParticles; }
+	FORCEINLINE USoundCue* GetImpactSound() const { return ImpactSound; }
+	FORCEINLINE UProjectileMovementComponent* GetProjectileMovement() const { return ProjectileMovementComponent; }
+	FORCEINLINE UBoxComponent* GetCollisionBox() const { return CollisionBox; }
 	
 
 };
@@ -16,7 +16,22 @@ class HEXARENA_API AProjectileWeapon : public ABaseWeapon
 	
 public:
 	virtual void Fire (const FVector& HitTarget) override;
+	virtual void FireFromEvent(const FFireEvent& FireEvent) override;
+
+protected:
+	virtual void BeginPlay() override;
+
 private:
+	// Round simulated by UHABulletSubsystem, flags follow the same roles as the projectile actors
+	void FireBullet(const FVector& Location, const FRotator& Rotation, APawn* InstigatorPawn);
+
+	// Taken from the projectile pool when the class can be pooled, never replicated
+	AProjectile* SpawnProjectile(TSubclassOf<AProjectile> Class, const FVector& Location, const FRotator& Rotation, APawn* InstigatorPawn);
+
+	// Projectiles of each class spawned into the pool when the weapon begins play
+	UPROPERTY(EditAnywhere)
+	int32 PooledProjectiles = 16;
+
 	UPROPERTY(EditAnywhere)
 	TSubclassOf<AProjectile> ProjectileClass;
 
@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Weapon/HitScanWeapon.h"
+#include "ShotgunWeapon.generated.h"
+
+/**
+ * Hitscan weapon firing several pellets per shot.
+ * Pellet directions come from the seed of the shot, so a whole blast is reported to the server as one request.
+ */
+UCLASS()
+class HEXARENA_API AShotgunWeapon : public AHitScanWeapon
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Fire(const FVector& HitTarget) override;
+	virtual void FireShot(const FVector& HitTarget, const FFireShot& Shot, int32 ShotSequence) override;
+	virtual void FireFromEvent(const FFireEvent& FireEvent) override;
+
+	// Same seed, start and target give the same pellets on every machine
+	void GetPelletTraceEnds(const FVector& TraceStart, const FVector& HitTarget, int32 Seed, int32 NumPellets, TArray<FVector, TInlineAllocator<16>>& OutTraceEnds) const;
+
+private:
+	// ShotSequence goes with the score request of the blast, INDEX_NONE for blasts without one
+	void FireWithSeed(const FVector& HitTarget, int32 Seed, int32 ShotSequence);
+
+	// Sent as a uint8 with the score request of the blast
+	UPROPERTY(EditAnywhere, Category = "Shotgun", meta = (ClampMin = "1", ClampMax = "255"))
+	int32 NumberOfPellets = 8;
+
+	UPROPERTY(EditAnywhere, Category = "Shotgun")
+	float PelletSpread = 12.f;
+
+public:
+	FORCEINLINE int32 GetNumberOfPellets() const { return NumberOfPellets; }
+};
@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UCurveFloat;
+
+/**
+ * Recoil and spread of every shot from the trigger seed and the shot index, the same on every machine.
+ * Recoil curves are sampled once per shot index when the weapon data is set, shots only read the table.
+ */
+struct HEXARENA_API FWeaponSpread
+{
+	// Curves map the shot index of a trigger pull to degrees, Scale multiplies yaw (X) and pitch (Y)
+	void BakeRecoil(const UCurveFloat* YawCurve, const UCurveFloat* PitchCurve, int32 NumShots, const FVector2f& Scale);
+
+	// Degrees of yaw (X) and pitch (Y), shots past the table keep the last entry
+	FVector2f GetRecoil(int32 ShotIndex) const;
+
+	// Shot from TraceStart at AimTarget after recoil and spread, rescaled to TraceLength
+	FVector GetShotTarget(const FVector& TraceStart, const FVector& AimTarget, float ScatterDistance, float TraceLength, int32 TriggerSeed, int32 ShotIndex, float Spread) const;
+
+	// Spread travels in the fire stream as a byte, 1/16 unit steps up to 16 units
+	static uint8 QuantizeSpread(float Spread);
+	static float DequantizeSpread(uint8 QuantizedSpread);
+
+private:
+	TArray<FVector2f> RecoilTable;
+};